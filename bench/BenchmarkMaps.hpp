@@ -0,0 +1,118 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Maps and measurements shared by the benchmarks.
+ *
+ * Header only, so that each benchmark still builds from its own source
+ * file and the game sources.
+ */
+
+#ifndef ANTGAME_BENCHMARKMAPS_HPP
+#define ANTGAME_BENCHMARKMAPS_HPP
+
+#include "Pathfinder.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <list>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/Vector2.hpp"
+////////////////////////////////////////////////
+
+typedef std::vector<sf::Vector2f> Polygon;
+
+/**
+ * \brief A side x side grid of pentagons, 300 apart in x and 200 in y.
+ *
+ * Each pentagon is 200 wide and 100 high, with a notch in its top, so
+ * that the gaps below and to the right of it are open.
+ */
+inline std::vector<Polygon> buildPentagons(int side)
+{
+    std::vector<Polygon> polygons;
+    for(int y = 0; y < side; y++)
+        for(int x = 0; x < side; x++)
+        {
+            float left = x * 300.f;
+            float top = y * 200.f;
+            polygons.push_back(
+            {
+                sf::Vector2f(left, top),
+                sf::Vector2f(left + 100.f, top + 50.f),
+                sf::Vector2f(left + 200.f, top),
+                sf::Vector2f(left + 150.f, top + 100.f),
+                sf::Vector2f(left + 50.f, top + 50.f),
+            });
+        }
+
+    return polygons;
+}
+
+/**
+ * \brief Write polygons to the polygon file Map loads for filePath.
+ *
+ * comment goes on the first line, behind a #.
+ */
+inline void writePolygons(const std::string& filePath, const std::string& comment, const std::vector<Polygon>& polygons)
+{
+    std::ofstream file(filePath + ".poly");
+    file << "# " << comment << std::endl;
+
+    for(const Polygon& polygon : polygons)
+    {
+        for(unsigned int i = 0; i < polygon.size(); i++)
+            file << (i > 0 ? " " : "") << polygon[i].x << " " << polygon[i].y;
+
+        file << std::endl;
+    }
+}
+
+/**
+ * \brief Write the grid of buildPentagons() for filePath.
+ */
+inline void writePentagons(const std::string& filePath, int side, const std::string& writer)
+{
+    std::ostringstream comment;
+    comment << side << "x" << side << " pentagons, written by " << writer << ".";
+
+    writePolygons(filePath, comment.str(), buildPentagons(side));
+}
+
+inline double getLength(const std::list<Pathfinder::Waypoint>& path)
+{
+    double total = 0.0;
+    for(const Pathfinder::Waypoint& waypoint : path)
+        total += waypoint.distance;
+
+    return total;
+}
+
+#endif // ANTGAME_BENCHMARKMAPS_HPP
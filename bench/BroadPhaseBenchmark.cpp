@@ -0,0 +1,194 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Broad phases of collission detection on a crowd of moving ants.
+ *
+ * Scatters ants over an open map and orders them about in groups, the
+ * way a player does, then steps them tick by tick. Every tick the broad
+ * phase catches up with them and finds the pairs that may collide; both
+ * steps are timed for each broad phase in turn, over the same moves.
+ * Their pair counts are compared, as any two broad phases must agree.
+ * For sweep and prune, the swaps its insertion sort takes are counted
+ * too. Does not open a window.
+ *
+ * Usage: BroadPhaseBenchmark [ants] [ticks]
+ */
+
+#include "Map.hpp"
+#include "EntitiesManager.hpp"
+#include "EntityNode.hpp"
+#include "CommandQueue.hpp"
+#include "Team.hpp"
+#include "Quadtree.hpp"
+#include "SpatialHash.hpp"
+#include "SweepAndPrune.hpp"
+#include "Utility.hpp"
+#include "TIME_PER_FRAME.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+struct Result
+{
+    double              updateTime; ///< Milliseconds, summed over all ticks.
+    double              pairTime;
+    unsigned long long  pairCount;
+    unsigned long long  swapCount; ///< Sweep and prune only.
+};
+
+static Result run(BroadPhase& broadPhase, Map& map, sf::FloatRect area, int antCount, int tickCount)
+{
+    const int GROUP_SIZE = 32;
+    const int ORDER_INTERVAL = 120; ///< Ticks between orders.
+
+    CommandQueue commandQueue;
+    EntitiesManager entitiesManager(map, commandQueue);
+    Team team(0);
+
+    // The same ants and orders for every broad phase.
+    std::mt19937 random(antCount);
+    std::uniform_real_distribution<float> x(area.left, area.left + area.width);
+    std::uniform_real_distribution<float> y(area.top, area.top + area.height);
+    std::uniform_int_distribution<int> size(8, 12);
+
+    std::vector<std::unique_ptr<EntityNode>> ants;
+    for(int i = 0; i < antCount; i++)
+    {
+        ants.emplace_back(new EntityNode(10, sf::Vector2f(x(random), y(random)), team, entitiesManager));
+
+        sf::Sprite sprite;
+        int side = size(random);
+        sprite.setTextureRect(sf::IntRect(0, 0, side, side));
+        ants.back()->setSprite(sprite);
+
+        broadPhase.insertEntity(ants.back().get());
+    }
+
+    const SweepAndPrune* pSweepAndPrune = dynamic_cast<const SweepAndPrune*>(&broadPhase);
+
+    std::vector<BroadPhase::Pair> pairs;
+    Result result = {0.0, 0.0, 0, 0};
+    for(int tick = 0; tick < tickCount; tick++)
+    {
+        if(tick % ORDER_INTERVAL == 0)
+            for(int first = 0; first < antCount; first += GROUP_SIZE)
+            {
+                std::vector<EntityNode*> group;
+                for(int i = first; i < std::min(first + GROUP_SIZE, antCount); i++)
+                    group.push_back(ants[i].get());
+
+                EntityNode::groupGoTo(group, sf::Vector2f(x(random), y(random)));
+            }
+
+        for(std::unique_ptr<EntityNode>& pAnt : ants)
+            pAnt->update(commandQueue);
+        entitiesManager.getEntityStore().move(TIME_PER_FRAME::S);
+
+        while(!commandQueue.isEmpty())
+            commandQueue.pop();
+
+        Clock::time_point start = Clock::now();
+        broadPhase.update();
+        Clock::time_point updated = Clock::now();
+        broadPhase.getNearbyEntities(pairs);
+        result.pairCount += pairs.size();
+        Clock::time_point paired = Clock::now();
+
+        if(pSweepAndPrune)
+            result.swapCount += pSweepAndPrune->getSwapCount();
+
+        result.updateTime += std::chrono::duration<double, std::milli>(updated - start).count();
+        result.pairTime += std::chrono::duration<double, std::milli>(paired - updated).count();
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    const float ANT_SPACING = 24.f; ///< Side of the square of ground per ant.
+
+    const int antCount = argc > 1 ? std::atoi(argv[1]) : 2000;
+    const int tickCount = argc > 2 ? std::atoi(argv[2]) : 600;
+    if(antCount < 1 || tickCount < 1)
+    {
+        std::cerr << "Usage: BroadPhaseBenchmark [ants] [ticks]" << std::endl;
+        return 1;
+    }
+
+    TIME_PER_FRAME::setAsSeconds(1 / 60.f);
+
+    // A single rock outside of the area the ants walk in.
+    const std::string filePath = "BroadPhaseBenchmark";
+    {
+        std::ofstream file(filePath + ".poly");
+        file << "# Written by BroadPhaseBenchmark." << std::endl;
+        file << "-20 -20 -10 -20 -20 -10" << std::endl;
+    }
+
+    float side = std::sqrt((float)antCount) * ANT_SPACING;
+    sf::FloatRect area(0.f, 0.f, side, side);
+    Map map(filePath, sf::Vector2f(side, side));
+
+    Quadtree quadtree(map.getBounds());
+    SpatialHash spatialHash;
+    SweepAndPrune sweepAndPrune;
+    const char* names[] = {"quadtree", "spatial hash", "sweep & prune"};
+    BroadPhase* broadPhases[] = {&quadtree, &spatialHash, &sweepAndPrune};
+
+    std::cout << antCount << " ants on " << side << "x" << side << ", " << tickCount << " ticks" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+
+    unsigned long long pairCount = 0;
+    for(int i = 0; i < BroadPhase::TypeCount; i++)
+    {
+        Result result = run(*broadPhases[i], map, area, antCount, tickCount);
+        std::cout << std::setw(14) << std::left << names[i] << std::right
+                  << " update " << std::setw(8) << result.updateTime / tickCount << " ms/tick"
+                  << "  pairs " << std::setw(8) << result.pairTime / tickCount << " ms/tick"
+                  << "  " << (double)result.pairCount / tickCount << " pairs/tick";
+        if(broadPhases[i] == &sweepAndPrune)
+            std::cout << "  " << (double)result.swapCount / tickCount << " swaps/tick";
+        std::cout << std::endl;
+
+        if(i > 0 && result.pairCount != pairCount)
+            std::cout << "Pair counts differ" << std::endl;
+        pairCount = result.pairCount;
+    }
+
+    std::cout << "spatial hash cell size " << spatialHash.getCellSize() << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,159 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Re-planning for a unit chasing a moving target.
+ *
+ * Writes a grid of pentagons to a polygon file and loads it as a map.
+ * A target walks between random spots of it while a slower chaser
+ * follows. Every tick the chaser's path is found both by a full search
+ * and by repairing its Chase, and the two are timed and compared. Does
+ * not open a window.
+ *
+ * The map and its cached NavGraph are written to the working
+ * directory, so later runs skip building the visibility graph.
+ *
+ * Usage: ChaseBenchmark [pentagons per side]
+ */
+
+#include "Map.hpp"
+#include "Pathfinder.hpp"
+#include "Utility.hpp"
+#include "BenchmarkMaps.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <cstdlib>
+////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+/**
+ * \brief Move pos step along path, dropping the waypoints passed.
+ */
+static sf::Vector2f walk(std::list<Pathfinder::Waypoint>& path, sf::Vector2f pos, float step)
+{
+    while(!path.empty() && path.front().distance < step)
+    {
+        step -= path.front().distance;
+        pos = path.front().destination;
+        path.pop_front();
+    }
+
+    if(path.empty())
+        return pos;
+
+    path.front().distance -= step;
+    return pos + path.front().direction * step;
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned int TICK_COUNT = 2000;
+    const float TARGET_STEP = 3.f;
+    const float CHASER_STEP = 2.f;
+    const float DIAMETER = 6.f;
+
+    const int side = argc > 1 ? std::atoi(argv[1]) : 16;
+    if(side < 2)
+    {
+        std::cerr << "Usage: ChaseBenchmark [pentagons per side, at least 2]" << std::endl;
+        return 1;
+    }
+
+    const std::string filePath = "ChaseBenchmark_" + toString(side);
+    writePentagons(filePath, side, "ChaseBenchmark");
+    Map map(filePath);
+
+    // Without a path cache or the hierarchy, so that every full search is an A* search.
+    Pathfinder pathfinder(map, 0);
+    pathfinder.setHierarchyDistance(std::numeric_limits<float>::max());
+
+    std::mt19937 random(side);
+    std::uniform_int_distribution<int> cell(0, side - 1);
+    auto randomPosition = [&]()
+    {
+        return sf::Vector2f(cell(random) * 300.f + 250.f, cell(random) * 200.f + 150.f);
+    };
+
+    sf::Vector2f target = randomPosition();
+    sf::Vector2f chaser = randomPosition();
+    std::list<Pathfinder::Waypoint> targetPath;
+    std::list<Pathfinder::Waypoint> chaserPath;
+    Pathfinder::Chase chase(DIAMETER);
+
+    double fullTime = 0.0;
+    double chaseTime = 0.0;
+    double lengthOverhead = 0.0;
+    unsigned int fullExpansions = 0;
+    unsigned int chaseExpansions = 0;
+    unsigned int searchTicks = 0;
+    unsigned int mismatches = 0;
+
+    for(unsigned int tick = 0; tick < TICK_COUNT; tick++)
+    {
+        if(targetPath.empty())
+            targetPath = pathfinder.getPath(DIAMETER, target, randomPosition());
+
+        target = walk(targetPath, target, TARGET_STEP);
+        chaser = walk(chaserPath, chaser, CHASER_STEP);
+
+        Clock::time_point start = Clock::now();
+        std::list<Pathfinder::Waypoint> fullPath = pathfinder.getPath(DIAMETER, chaser, target, &fullExpansions);
+        fullTime += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+        start = Clock::now();
+        chaserPath = pathfinder.getPath(chase, chaser, target, &chaseExpansions);
+        chaseTime += std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+        if(fullPath.empty() != chaserPath.empty())
+            mismatches++;
+
+        // Ticks in sight of the target take the same shortcut either way.
+        if(fullPath.size() > 1)
+        {
+            searchTicks++;
+            lengthOverhead += getLength(chaserPath) / getLength(fullPath) - 1.0;
+        }
+    }
+
+    std::cout << "vertices              " << map.getNavGraph().getVertexCount() << std::endl
+              << "ticks                 " << TICK_COUNT << std::endl
+              << "ticks out of sight    " << searchTicks << std::endl
+              << "mismatches            " << mismatches << std::endl << std::endl
+              << std::fixed << std::setprecision(1)
+              << "full search (us)      " << fullTime / TICK_COUNT << std::endl
+              << "chase (us)            " << chaseTime / TICK_COUNT << std::endl
+              << "speedup               " << fullTime / chaseTime << std::endl
+              << "full expansions       " << (double)fullExpansions / TICK_COUNT << std::endl
+              << "chase expansions      " << (double)chaseExpansions / TICK_COUNT << std::endl
+              << "length overhead (%)   " << std::setprecision(2) << (searchTicks ? 100.0 * lengthOverhead / searchTicks : 0.0) << std::endl;
+
+    return 0;
+}
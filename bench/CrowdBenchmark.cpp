@@ -0,0 +1,219 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Crowd steering of a large number of ants, headless.
+ *
+ * Two crowds start on opposite sides of an open map and are ordered, in
+ * groups, across to the other side, so that they have to pass through
+ * each other on the way. Reports the time per tick against the 16 ms of
+ * a 60 Hz frame and how many ants overlap, then runs again with a single
+ * thread to check that the ants end up in exactly the same places no
+ * matter how many threads steered them. Does not open a window.
+ *
+ * Usage: CrowdBenchmark [ants] [ticks] [threads, 0 for one per core]
+ */
+
+#include "Map.hpp"
+#include "EntitiesManager.hpp"
+#include "EntityNode.hpp"
+#include "CommandQueue.hpp"
+#include "Team.hpp"
+#include "TIME_PER_FRAME.hpp"
+#include "Utility.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+static const float ANT_SPACING = 14.f;  ///< Side of the square of ground per ant.
+static const unsigned int GROUP_SIZE = 50;
+
+struct Result
+{
+    double                      meanTime;
+    double                      maxTime;
+    int                         overlapCount;
+    int                         movingCount;
+    std::vector<sf::Vector2f>   positions;
+};
+
+static int countOverlaps(const std::vector<EntityNode*>& ants)
+{
+    // Sorted on x so that only ants that may touch are compared.
+    std::vector<EntityNode*> sorted(ants);
+    std::sort(sorted.begin(), sorted.end(), [](EntityNode* lhs, EntityNode* rhs)
+    {
+        return lhs->getPosition().x < rhs->getPosition().x;
+    });
+
+    int overlapCount = 0;
+    for(unsigned int i = 0; i < sorted.size(); i++)
+    {
+        float radius = sorted[i]->getBoundingRect().width / 2;
+        for(unsigned int j = i + 1; j < sorted.size(); j++)
+        {
+            float radiusSum = radius + sorted[j]->getBoundingRect().width / 2;
+            sf::Vector2f dVec = sorted[j]->getPosition() - sorted[i]->getPosition();
+            if(dVec.x >= radiusSum)
+                break;
+
+            // Allow for the rounding of a resting contact.
+            if(length(dVec) < radiusSum - 0.5f)
+                overlapCount++;
+        }
+    }
+
+    return overlapCount;
+}
+
+static Result run(const std::string& filePath, int antCount, int tickCount, unsigned int threadCount)
+{
+    float side = std::sqrt((float)antCount) * ANT_SPACING;
+    Map map(filePath, sf::Vector2f(side * 2, side));
+    CommandQueue commandQueue;
+    EntitiesManager entitiesManager(map, commandQueue);
+    entitiesManager.setThreadCount(threadCount);
+    Team team(0);
+
+    // The crowds stand in the outer quarters of a map twice as wide as it is high.
+    std::mt19937 random(antCount);
+    std::uniform_real_distribution<float> x(0.f, side / 2);
+    std::uniform_real_distribution<float> y(0.f, side);
+
+    std::vector<EntityNode*> ants;
+    for(int i = 0; i < antCount; i++)
+    {
+        bool isLeft = i < antCount / 2;
+        sf::Vector2f position(isLeft ? x(random) : side * 2 - x(random), y(random));
+        std::unique_ptr<EntityNode> ant(new EntityNode(10, position, team, entitiesManager));
+
+        sf::Sprite sprite;
+        sprite.setTextureRect(sf::IntRect(0, 0, 10, 10));
+        ant->setSprite(sprite);
+
+        ants.push_back(ant.get());
+        entitiesManager.insertEntity(std::move(ant));
+    }
+
+    // Send every group to the mirror of where it stands.
+    for(unsigned int i = 0; i < ants.size(); i += GROUP_SIZE)
+    {
+        std::vector<EntityNode*> group(ants.begin() + i, ants.begin() + std::min<unsigned int>(ants.size(), i + GROUP_SIZE));
+
+        sf::Vector2f centre;
+        for(EntityNode* ant : group)
+            centre += ant->getPosition();
+        centre /= (float)group.size();
+
+        EntityNode::groupGoTo(group, sf::Vector2f(side * 2 - centre.x, centre.y));
+    }
+
+    Result result;
+    result.meanTime = 0.0;
+    result.maxTime = 0.0;
+    for(int i = 0; i < tickCount; i++)
+    {
+        Clock::time_point start = Clock::now();
+        entitiesManager.update();
+        double time = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        result.meanTime += time / tickCount;
+        result.maxTime = std::max(result.maxTime, time);
+    }
+
+    result.overlapCount = countOverlaps(ants);
+    result.movingCount = 0;
+    for(EntityNode* ant : ants)
+    {
+        result.movingCount += ant->isMoving();
+        result.positions.push_back(ant->getPosition());
+    }
+
+    return result;
+}
+
+static void print(const std::string& label, const Result& result)
+{
+    std::cout << label
+              << std::setw(8) << result.meanTime << " ms/tick, worst "
+              << std::setw(8) << result.maxTime << " ms, "
+              << result.overlapCount << " overlaps, "
+              << result.movingCount << " still moving" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    const int antCount = argc > 1 ? std::atoi(argv[1]) : 5000;
+    const int tickCount = argc > 2 ? std::atoi(argv[2]) : 600;
+    const int threadCount = argc > 3 ? std::atoi(argv[3]) : 0;
+    if(antCount < 2 || tickCount < 1 || threadCount < 0)
+    {
+        std::cerr << "Usage: CrowdBenchmark [ants, at least 2] [ticks] [threads, 0 for one per core]" << std::endl;
+        return 1;
+    }
+
+    TIME_PER_FRAME::setAsSeconds(1.f / 60.f);
+
+    // A single rock outside of the area the ants walk in.
+    const std::string filePath = "CrowdBenchmark";
+    {
+        std::ofstream file(filePath + ".poly");
+        file << "# Written by CrowdBenchmark." << std::endl;
+        file << "-20 -20 -10 -20 -20 -10" << std::endl;
+    }
+
+    const unsigned int threads = threadCount > 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+    std::cout << antCount << " ants, " << tickCount << " ticks, " << threads << " threads" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+
+    Result threaded = run(filePath, antCount, tickCount, threads);
+    print("threaded  ", threaded);
+
+    Result single = run(filePath, antCount, tickCount, 1);
+    print("1 thread  ", single);
+
+    if(threaded.positions != single.positions)
+    {
+        std::cerr << "The ants end up in different places with different thread counts" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Same positions with either thread count" << std::endl;
+    if(threaded.meanTime > 16.0)
+        std::cout << "Over the 16 ms of a 60 Hz frame" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,141 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Line of sight queries against terrain, with and without EdgeIndex.
+ *
+ * Builds a grid of pentagons for a range of obstacle counts and times
+ * the same random queries against the brute force loop over every
+ * node and against the edge index. Does not open a window.
+ *
+ * Build from the repository root, e.g.
+ *   g++ -std=c++11 -O2 -Iincl bench/EdgeIndexBenchmark.cpp src/EdgeIndex.cpp
+ *       src/TerrainCollissionNode.cpp src/PolygonShape.cpp src/SceneNode.cpp
+ *       src/Utility.cpp src/Command.cpp -lsfml-graphics -lsfml-system
+ */
+
+#include "EdgeIndex.hpp"
+#include "TerrainCollissionNode.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <cmath>
+////////////////////////////////////////////////
+
+typedef std::unique_ptr<TerrainCollissionNode> NodePtr;
+
+static std::list<NodePtr> buildTerrain(int side)
+{
+    const std::vector<sf::Vector2f> pentagon =
+    {
+        sf::Vector2f(0, 0),
+        sf::Vector2f(100, 50),
+        sf::Vector2f(200, 0),
+        sf::Vector2f(150, 100),
+        sf::Vector2f(50, 50),
+    };
+
+    std::list<NodePtr> nodes;
+    for(int y = 0; y < side; y++)
+        for(int x = 0; x < side; x++)
+        {
+            std::vector<sf::Vector2f> points(pentagon);
+            for(sf::Vector2f& p : points)
+                p += sf::Vector2f(x * 300.f, y * 200.f);
+
+            nodes.push_back(NodePtr(new TerrainCollissionNode(points)));
+        }
+
+    return nodes;
+}
+
+static bool bruteForceIntersects(const std::list<NodePtr>& nodes, sf::Vector2f a, sf::Vector2f b)
+{
+    for(const NodePtr& pNode : nodes)
+        if(pNode->isLineIntersecting(a, b))
+            return true;
+
+    return false;
+}
+
+int main()
+{
+    const int QUERY_COUNT = 20000;
+    const float QUERY_LENGTH = 600.f;
+
+    std::cout << std::setw(10) << "obstacles"
+              << std::setw(10) << "edges"
+              << std::setw(14) << "brute (us)"
+              << std::setw(14) << "index (us)"
+              << std::setw(10) << "speedup" << std::endl;
+
+    for(int side = 2; side <= 64; side *= 2)
+    {
+        std::list<NodePtr> nodes = buildTerrain(side);
+
+        EdgeIndex edgeIndex;
+        edgeIndex.build(nodes);
+
+        std::mt19937 random(side);
+        std::uniform_real_distribution<float> x(0.f, side * 300.f);
+        std::uniform_real_distribution<float> y(0.f, side * 200.f);
+        std::uniform_real_distribution<float> angle(0.f, 6.2831853f);
+
+        std::vector<std::pair<sf::Vector2f, sf::Vector2f>> queries;
+        for(int i = 0; i < QUERY_COUNT; i++)
+        {
+            sf::Vector2f a(x(random), y(random));
+            float theta = angle(random);
+            queries.push_back(std::make_pair(a, a + sf::Vector2f(std::cos(theta), std::sin(theta)) * QUERY_LENGTH));
+        }
+
+        typedef std::chrono::steady_clock Clock;
+        int bruteHits = 0;
+        int indexHits = 0;
+
+        Clock::time_point start = Clock::now();
+        for(const auto& query : queries)
+            bruteHits += bruteForceIntersects(nodes, query.first, query.second);
+        double bruteTime = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+        start = Clock::now();
+        for(const auto& query : queries)
+            indexHits += edgeIndex.isLineIntersecting(query.first, query.second);
+        double indexTime = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+
+        if(bruteHits != indexHits)
+            std::cerr << "Mismatch: " << bruteHits << " vs " << indexHits << " hits" << std::endl;
+
+        std::cout << std::setw(10) << side * side
+                  << std::setw(10) << edgeIndex.getSegmentCount()
+                  << std::setw(14) << std::fixed << std::setprecision(3) << bruteTime / QUERY_COUNT
+                  << std::setw(14) << indexTime / QUERY_COUNT
+                  << std::setw(10) << std::setprecision(1) << bruteTime / indexTime << std::endl;
+    }
+
+    return 0;
+}
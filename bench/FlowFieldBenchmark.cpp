@@ -0,0 +1,169 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Mass orders onto one target, by flow field and by per-unit paths.
+ *
+ * Writes a grid of pentagons to a polygon file and loads it as a map.
+ * Units are scattered over random spots of it and all ordered to the
+ * same target. Their routes are found once by an A* search each, and
+ * once by building a single flow field and steering every unit along
+ * it until it arrives. Both are timed, the steered routes are checked
+ * for crossing the terrain and their lengths compared to the paths.
+ * Does not open a window.
+ *
+ * The map and its cached NavGraph are written to the working
+ * directory, so later runs skip building the visibility graph.
+ *
+ * Usage: FlowFieldBenchmark [pentagons per side] [units]
+ */
+
+#include "Map.hpp"
+#include "Pathfinder.hpp"
+#include "FlowField.hpp"
+#include "Utility.hpp"
+#include "BenchmarkMaps.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <cstdlib>
+////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+int main(int argc, char** argv)
+{
+    const float STEP = 4.f;
+    const float DIAMETER = 6.f;
+
+    const int side = argc > 1 ? std::atoi(argv[1]) : 16;
+    const int unitCount = argc > 2 ? std::atoi(argv[2]) : 500;
+    if(side < 2 || unitCount < 1)
+    {
+        std::cerr << "Usage: FlowFieldBenchmark [pentagons per side, at least 2] [units, at least 1]" << std::endl;
+        return 1;
+    }
+
+    const std::string filePath = "FlowFieldBenchmark_" + toString(side);
+    writePentagons(filePath, side, "FlowFieldBenchmark");
+
+    // The map is drawn eight times its size, 500 units up and to the left of the origin.
+    Map map(filePath, sf::Vector2f(side * 300.f + 1000.f, side * 200.f + 1000.f) / 8.f);
+
+    // Without a path cache or the hierarchy, so that every path is an A* search.
+    Pathfinder pathfinder(map, 0);
+    pathfinder.setHierarchyDistance(std::numeric_limits<float>::max());
+
+    std::mt19937 random(side);
+    std::uniform_int_distribution<int> cell(0, side - 1);
+    auto randomPosition = [&]()
+    {
+        return sf::Vector2f(cell(random) * 300.f + 250.f, cell(random) * 200.f + 150.f);
+    };
+
+    const sf::Vector2f target = randomPosition();
+    std::vector<sf::Vector2f> units(unitCount);
+    for(sf::Vector2f& unit : units)
+        unit = randomPosition();
+
+    // One search per unit.
+    std::vector<double> pathLengths(unitCount);
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < unitCount; i++)
+        pathLengths[i] = getLength(pathfinder.getPath(DIAMETER, units[i], target));
+    double pathTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    // One field for all of them.
+    start = Clock::now();
+    Pathfinder::FlowFieldPtr field = pathfinder.getFlowField(DIAMETER, target);
+    double buildTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    bool isShared = pathfinder.getFlowField(DIAMETER, target + sf::Vector2f(1.f, 1.f)) == field;
+
+    const unsigned int maxTicks = 4.f * (side * 300.f + side * 200.f) / STEP;
+    unsigned int samples = 0;
+    unsigned int arrived = 0;
+    unsigned int unreached = 0;
+    unsigned int crossings = 0;
+    double lengthOverhead = 0.0;
+    double steerTime = 0.0;
+
+    for(int i = 0; i < unitCount; i++)
+    {
+        sf::Vector2f pos = units[i];
+        double travelled = 0.0;
+
+        start = Clock::now();
+        for(unsigned int tick = 0; tick < maxTicks; tick++)
+        {
+            float distance = length(target - pos);
+            if(distance <= STEP)
+            {
+                travelled += distance;
+                arrived++;
+                break;
+            }
+
+            sf::Vector2f direction;
+            samples++;
+            if(!field->sample(pos, direction))
+            {
+                unreached++;
+                break;
+            }
+
+            sf::Vector2f next = pos + direction * STEP;
+            if(map.getEdgeIndex().isLineIntersecting(pos, next))
+                crossings++;
+
+            pos = next;
+            travelled += STEP;
+        }
+        steerTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+        if(pathLengths[i] > 0.0 && length(target - pos) <= STEP)
+            lengthOverhead += travelled / pathLengths[i] - 1.0;
+    }
+
+    sf::Vector2i gridSize = field->getGridSize();
+    std::cout << "vertices              " << map.getNavGraph().getVertexCount() << std::endl
+              << "units                 " << unitCount << std::endl
+              << "cells                 " << gridSize.x << "x" << gridSize.y << " (" << field->getReachedCount() << " reached)" << std::endl
+              << "field shared          " << (isShared ? "yes" : "no") << std::endl
+              << "arrived               " << arrived << std::endl
+              << "not reached by field  " << unreached << std::endl
+              << "terrain crossings     " << crossings << std::endl << std::endl
+              << std::fixed << std::setprecision(2)
+              << "A* paths (ms)         " << pathTime << std::endl
+              << "field build (ms)      " << buildTime << std::endl
+              << "steering (ms)         " << steerTime << " over " << samples << " samples" << std::endl
+              << "length overhead (%)   " << (arrived ? 100.0 * lengthOverhead / arrived : 0.0) << std::endl;
+
+    return 0;
+}
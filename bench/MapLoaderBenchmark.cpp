@@ -0,0 +1,95 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Polygon extraction from map images.
+ *
+ * Traces the image given on the command line, or a generated image with
+ * randomly placed round obstacles, and prints the polygon and vertex
+ * counts along with the time it took. Does not open a window.
+ *
+ * Usage: MapLoaderBenchmark [image file | image size]
+ */
+
+#include "MapLoader.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <random>
+#include <string>
+#include <cstdlib>
+#include <algorithm>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/Graphics/Image.hpp"
+////////////////////////////////////////////////
+
+static void generateImage(sf::Image& image, unsigned int size)
+{
+    image.create(size, size, sf::Color::White);
+
+    std::mt19937 random(size);
+    std::uniform_int_distribution<int> position(0, size - 1);
+    std::uniform_int_distribution<int> radius(2, 24);
+
+    const unsigned int obstacleCount = size * size / 4000;
+    for(unsigned int i = 0; i < obstacleCount; i++)
+    {
+        int centerX = position(random);
+        int centerY = position(random);
+        int r = radius(random);
+
+        for(int y = std::max(0, centerY - r); y <= std::min<int>(size - 1, centerY + r); y++)
+            for(int x = std::max(0, centerX - r); x <= std::min<int>(size - 1, centerX + r); x++)
+                if((x - centerX) * (x - centerX) + (y - centerY) * (y - centerY) <= r * r)
+                    image.setPixel(x, y, sf::Color::Black);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    sf::Image image;
+    std::string source = argc > 1 ? argv[1] : "4096";
+
+    if(source.find_first_not_of("0123456789") == std::string::npos)
+        generateImage(image, std::atoi(source.c_str()));
+    else if(!image.loadFromFile(source))
+    {
+        std::cerr << "Failed to load " << source << std::endl;
+        return 1;
+    }
+
+    MapLoader loader((sf::Transform()));
+    loader.traceImage(image);
+
+    const MapLoader::Stats& stats = loader.getStats();
+    std::cout << "image     " << image.getSize().x << "x" << image.getSize().y << std::endl
+              << "polygons  " << stats.polygonCount << std::endl
+              << "vertices  " << stats.vertexCount << std::endl
+              << "time (ms) " << stats.loadTime.asMicroseconds() / 1000.f << std::endl;
+
+    return 0;
+}
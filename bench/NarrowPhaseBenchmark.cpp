@@ -0,0 +1,166 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Narrow phase of collission detection, one pair at a time and batched.
+ *
+ * Scatters ants over an open map, finds the pairs that may collide with
+ * a spatial hash, then tests those same pairs over and over: the way
+ * CollissionFinder used to, reading both rects of every pair and adding
+ * hits to a list; with CollissionFinder one pair at a time; and with
+ * CollissionFinder in SIMD batches, where the build has SSE2 or AVX.
+ * The three must find as many collissions. Does not open a window.
+ *
+ * Usage: NarrowPhaseBenchmark [ants] [repeats]
+ */
+
+#include "Map.hpp"
+#include "EntitiesManager.hpp"
+#include "EntityNode.hpp"
+#include "CommandQueue.hpp"
+#include "Team.hpp"
+#include "SpatialHash.hpp"
+#include "CollissionFinder.hpp"
+#include "Utility.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <list>
+#include <string>
+#include <cmath>
+#include <cstdlib>
+////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+static std::list<CollissionFinder::CollissionData> getCollissionsPerPair(const std::vector<BroadPhase::Pair>& pairs)
+{
+    std::list<CollissionFinder::CollissionData> collissions;
+    for(const BroadPhase::Pair& pair : pairs)
+    {
+        float radiusSum = pair.first->getBoundingRect().width / 2 + pair.second->getBoundingRect().width / 2;
+        sf::Vector2f dVec = pair.first->getPosition() - pair.second->getPosition();
+
+        if(dVec.x * dVec.x + dVec.y * dVec.y < radiusSum * radiusSum)
+        {
+            CollissionFinder::CollissionData collission;
+            collission.lNode = pair.first;
+            collission.rNode = pair.second;
+
+            float d = length(dVec);
+            collission.penetrationDepth = radiusSum - d;
+            collission.unitVector = dVec / d;
+
+            collissions.push_back(collission);
+        }
+    }
+
+    return collissions;
+}
+
+int main(int argc, char** argv)
+{
+    const float ANT_SPACING = 12.f; ///< Side of the square of ground per ant.
+
+    const int antCount = argc > 1 ? std::atoi(argv[1]) : 8000;
+    const int repeatCount = argc > 2 ? std::atoi(argv[2]) : 200;
+    if(antCount < 2 || repeatCount < 1)
+    {
+        std::cerr << "Usage: NarrowPhaseBenchmark [ants, at least 2] [repeats]" << std::endl;
+        return 1;
+    }
+
+    // A single rock outside of the area the ants stand in.
+    const std::string filePath = "NarrowPhaseBenchmark";
+    {
+        std::ofstream file(filePath + ".poly");
+        file << "# Written by NarrowPhaseBenchmark." << std::endl;
+        file << "-20 -20 -10 -20 -20 -10" << std::endl;
+    }
+
+    float side = std::sqrt((float)antCount) * ANT_SPACING;
+    Map map(filePath, sf::Vector2f(side, side));
+    CommandQueue commandQueue;
+    EntitiesManager entitiesManager(map, commandQueue);
+    Team team(0);
+
+    std::mt19937 random(antCount);
+    std::uniform_real_distribution<float> position(0.f, side);
+    std::uniform_int_distribution<int> size(8, 12);
+
+    SpatialHash spatialHash;
+    std::vector<std::unique_ptr<EntityNode>> ants;
+    for(int i = 0; i < antCount; i++)
+    {
+        ants.emplace_back(new EntityNode(10, sf::Vector2f(position(random), position(random)), team, entitiesManager));
+
+        sf::Sprite sprite;
+        int side = size(random);
+        sprite.setTextureRect(sf::IntRect(0, 0, side, side));
+        ants.back()->setSprite(sprite);
+
+        spatialHash.insertEntity(ants.back().get());
+    }
+
+    std::vector<BroadPhase::Pair> pairs;
+    spatialHash.update();
+    spatialHash.getNearbyEntities(pairs);
+
+    std::cout << antCount << " ants on " << side << "x" << side << ", " << pairs.size() << " pairs, " << repeatCount << " repeats" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+
+    std::size_t collissionCount = 0;
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < repeatCount; i++)
+        collissionCount = getCollissionsPerPair(pairs).size();
+    double perPairTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeatCount;
+    std::cout << "per pair, list        " << std::setw(8) << perPairTime << " ms  " << collissionCount << " collissions" << std::endl;
+
+    CollissionFinder finder;
+    finder.setVectorized(false);
+    start = Clock::now();
+    for(int i = 0; i < repeatCount; i++)
+        collissionCount = finder.getCollissions(pairs).size();
+    double scalarTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeatCount;
+    std::cout << "batched, scalar       " << std::setw(8) << scalarTime << " ms  " << collissionCount << " collissions" << std::endl;
+
+    if(!CollissionFinder::isVectorizable())
+    {
+        std::cout << "Built without SSE2 or AVX, no SIMD batches to compare" << std::endl;
+        return 0;
+    }
+
+    finder.setVectorized(true);
+    start = Clock::now();
+    for(int i = 0; i < repeatCount; i++)
+        collissionCount = finder.getCollissions(pairs).size();
+    double vectorizedTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count() / repeatCount;
+    std::cout << "batched, SIMD         " << std::setw(8) << vectorizedTime << " ms  " << collissionCount << " collissions" << std::endl;
+
+    return 0;
+}
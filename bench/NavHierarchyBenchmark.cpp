@@ -0,0 +1,203 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Long path queries, with and without the NavHierarchy.
+ *
+ * Writes a grid of pentagons to a polygon file, loads it as a map and
+ * times the same random long queries through the flat A* search and
+ * through the hierarchy. For the hierarchy, the time until the first
+ * waypoints are known is reported along with the time to refine the
+ * whole path. Does not open a window.
+ *
+ * The map and its cached NavGraph are written to the working
+ * directory, so later runs skip building the visibility graph.
+ *
+ * Usage: NavHierarchyBenchmark [pentagons per side]
+ */
+
+#include "Map.hpp"
+#include "Pathfinder.hpp"
+#include "Utility.hpp"
+#include "BenchmarkMaps.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <cstdlib>
+////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+struct Query
+{
+    float           diameter;
+    sf::Vector2f    pos;
+    sf::Vector2f    destination;
+};
+
+struct Result
+{
+    Result();
+    double          time; ///< Microseconds per query.
+    double          length; ///< Average path length.
+    double          expansions; ///< Average vertices or portals expanded.
+    unsigned int    failures;
+};
+
+Result::Result()
+: time(0.0)
+, length(0.0)
+, expansions(0.0)
+, failures(0)
+{
+
+}
+
+static std::vector<Query> generateQueries(int side, unsigned int count, float minDistance)
+{
+    std::mt19937 random(side);
+    std::uniform_int_distribution<int> cell(0, side - 1);
+    std::uniform_real_distribution<float> jitter(-20.f, 20.f);
+    std::uniform_int_distribution<int> size(0, 2);
+    const float diameters[] = {2.f, 6.f, 12.f};
+
+    // The gaps below and to the right of each pentagon are open.
+    auto randomPosition = [&]()
+    {
+        return sf::Vector2f(cell(random) * 300.f + 250.f + jitter(random), cell(random) * 200.f + 150.f + jitter(random));
+    };
+
+    std::vector<Query> queries;
+    while(queries.size() < count)
+    {
+        Query query;
+        query.diameter = diameters[size(random)];
+        query.pos = randomPosition();
+        query.destination = randomPosition();
+
+        if(length(query.destination - query.pos) > minDistance)
+            queries.push_back(query);
+    }
+
+    return queries;
+}
+
+static Result run(const Pathfinder& pathfinder, const std::vector<Query>& queries, bool isFirstOnly)
+{
+    Result result;
+    unsigned int expansions = 0;
+
+    Clock::time_point start = Clock::now();
+    for(const Query& query : queries)
+    {
+        Pathfinder::AbstractPathPtr pRemainder;
+        std::list<Pathfinder::Waypoint> path = pathfinder.getPath(query.diameter, query.pos, query.destination, &expansions, isFirstOnly ? &pRemainder : nullptr);
+
+        if(path.empty())
+            result.failures++;
+
+        result.length += getLength(path);
+    }
+
+    result.time = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / queries.size();
+    result.length /= queries.size();
+    result.expansions = (double)expansions / queries.size();
+
+    return result;
+}
+
+static void print(const std::string& name, const Result& result)
+{
+    std::cout << std::setw(22) << std::left << name << std::right
+              << std::setw(14) << std::fixed << std::setprecision(1) << result.time
+              << std::setw(14) << result.length
+              << std::setw(14) << result.expansions
+              << std::setw(10) << result.failures << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned int QUERY_COUNT = 200;
+    const float MIN_DISTANCE = 2000.f;
+
+    const int side = argc > 1 ? std::atoi(argv[1]) : 24;
+    if(side < 2)
+    {
+        std::cerr << "Usage: NavHierarchyBenchmark [pentagons per side, at least 2]" << std::endl;
+        return 1;
+    }
+
+    const std::string filePath = "NavHierarchyBenchmark_" + toString(side);
+    writePentagons(filePath, side, "NavHierarchyBenchmark");
+
+    Clock::time_point start = Clock::now();
+    Map map(filePath);
+    double loadTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::vector<Query> queries = generateQueries(side, QUERY_COUNT, MIN_DISTANCE);
+
+    // Without a path cache, so that every query is searched for.
+    Pathfinder flat(map, 0);
+    flat.setHierarchyDistance(std::numeric_limits<float>::max());
+    Pathfinder hierarchical(map, 0);
+    hierarchical.setHierarchyDistance(MIN_DISTANCE / 2.f);
+
+    // The first query builds the hierarchy of its clearance class.
+    start = Clock::now();
+    for(const Query& query : queries)
+        hierarchical.getPath(query.diameter, query.pos, query.destination);
+    double warmUpTime = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+    std::cout << "vertices            " << map.getNavGraph().getVertexCount() << std::endl
+              << "edges               " << map.getNavGraph().getEdgeCount() << std::endl
+              << "map load (ms)       " << loadTime << std::endl
+              << "warm up (ms)        " << warmUpTime << std::endl
+              << "queries             " << queries.size() << std::endl << std::endl;
+
+    std::cout << std::setw(22) << std::left << "search" << std::right
+              << std::setw(14) << "time (us)"
+              << std::setw(14) << "length"
+              << std::setw(14) << "expansions"
+              << std::setw(10) << "failures" << std::endl;
+
+    Result flatResult = run(flat, queries, false);
+    Result firstResult = run(hierarchical, queries, true);
+    Result fullResult = run(hierarchical, queries, false);
+
+    print("flat A*", flatResult);
+    print("hierarchy, first part", firstResult);
+    print("hierarchy, refined", fullResult);
+
+    std::cout << std::endl
+              << "speedup, first part  " << std::setprecision(1) << flatResult.time / firstResult.time << std::endl
+              << "speedup, refined     " << flatResult.time / fullResult.time << std::endl
+              << "length overhead (%)  " << 100.0 * (fullResult.length / flatResult.length - 1.0) << std::endl;
+
+    return 0;
+}
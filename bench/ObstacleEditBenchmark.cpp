@@ -0,0 +1,211 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Inserting and removing an obstacle on a built map.
+ *
+ * Writes a grid of pentagons to a polygon file, and the same grid with
+ * a small square between the pentagons to another, and builds both from
+ * scratch as references. Then the square is inserted into and removed
+ * from two more maps of the plain grid: one built from scratch, and one
+ * loaded from the NavGraph cache that the first left behind. After each
+ * edit, the NavGraph and every clearance subgraph must match those of
+ * the reference edge for edge. Reports the time of the full build and
+ * of the edits. Does not open a window.
+ *
+ * Usage: ObstacleEditBenchmark [pentagons per side]
+ */
+
+#include "Map.hpp"
+#include "NavGraph.hpp"
+#include "Utility.hpp"
+#include "BenchmarkMaps.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+static Polygon getSquare(int side)
+{
+    // In the gap below and right of the middle pentagon.
+    float left = side / 2 * 300.f + 240.f;
+    float top = side / 2 * 200.f + 140.f;
+
+    return {sf::Vector2f(left, top), sf::Vector2f(left + 20.f, top), sf::Vector2f(left + 20.f, top + 20.f), sf::Vector2f(left, top + 20.f)};
+}
+
+static void writeMap(const std::string& filePath, int side, bool hasSquare)
+{
+    std::vector<Polygon> polygons = buildPentagons(side);
+
+    // Last, so that its points are numbered the way an inserted obstacle's are.
+    if(hasSquare)
+        polygons.push_back(getSquare(side));
+
+    writePolygons(filePath, toString(side) + "x" + toString(side) + " pentagons, written by ObstacleEditBenchmark.", polygons);
+
+    // A stale cache would hide what is being tested.
+    std::remove((filePath + ".nav").c_str());
+}
+
+static double getMilliseconds(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * \brief Describe how graph differs from reference, or return an empty string if it does not.
+ *
+ * The edges of a vertex may come in any order.
+ */
+static std::string compare(const NavGraph& graph, const NavGraph& reference)
+{
+    if(graph.getVertexCount() != reference.getVertexCount())
+        return toString(graph.getVertexCount()) + " vertices instead of " + toString(reference.getVertexCount());
+
+    if(graph.getEdgeCount() != reference.getEdgeCount())
+        return toString(graph.getEdgeCount()) + " edges instead of " + toString(reference.getEdgeCount());
+
+    typedef std::tuple<int, bool, float, unsigned short, bool> EdgeKey;
+    auto getEdges = [](const NavGraph& navGraph, int vertex)
+    {
+        std::vector<EdgeKey> edges;
+        for(const NavGraph::Edge* pEdge = navGraph.edgesBegin(vertex); pEdge != navGraph.edgesEnd(vertex); pEdge++)
+            edges.push_back(EdgeKey(pEdge->to, pEdge->isEdge, pEdge->passWidth, pEdge->clearanceMask, pEdge->reverse >= 0));
+
+        std::sort(edges.begin(), edges.end());
+        return edges;
+    };
+
+    for(int i = 0; i < graph.getVertexCount(); i++)
+    {
+        if(graph.getVertex(i).pos != reference.getVertex(i).pos)
+            return "vertex " + toString(i) + " is somewhere else";
+
+        if(getEdges(graph, i) != getEdges(reference, i))
+            return "the edges of vertex " + toString(i) + " differ";
+
+        for(const NavGraph::Edge* pEdge = graph.edgesBegin(i); pEdge != graph.edgesEnd(i); pEdge++)
+            if(pEdge->reverse >= 0 && graph.getEdge(pEdge->reverse).to != i)
+                return "an edge of vertex " + toString(i) + " has the wrong reverse";
+    }
+
+    return std::string();
+}
+
+static bool check(const std::string& label, const Map& map, const Map& reference)
+{
+    std::string difference = compare(map.getNavGraph(), reference.getNavGraph());
+    for(int i = 0; i < NavGraph::CLEARANCE_CLASS_COUNT && difference.empty(); i++)
+    {
+        difference = compare(map.getNavGraph(i), reference.getNavGraph(i));
+        if(!difference.empty())
+            difference = "clearance class " + toString(i) + ": " + difference;
+    }
+
+    if(!difference.empty())
+    {
+        std::cerr << label << ": " << difference << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Insert the square into map and remove it again, checking the graphs after each.
+ */
+static bool edit(const std::string& label, Map& map, const Map& plain, const Map& withSquare, int side)
+{
+    Clock::time_point start = Clock::now();
+    TerrainCollissionNode* pSquare = map.insertObstacle(Map::NodePtr(new TerrainCollissionNode(getSquare(side))));
+    double insertTime = getMilliseconds(start);
+
+    if(!check(label + " after insert", map, withSquare))
+        return false;
+
+    start = Clock::now();
+    map.removeObstacle(pSquare);
+    double removeTime = getMilliseconds(start);
+
+    if(!check(label + " after remove", map, plain))
+        return false;
+
+    std::cout << label
+              << "insert " << std::setw(9) << insertTime << " ms, "
+              << "remove " << std::setw(9) << removeTime << " ms, "
+              << map.getNavGraph().getEdgeCount() << " edges" << std::endl;
+
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    const int side = argc > 1 ? std::atoi(argv[1]) : 12;
+    if(side < 2)
+    {
+        std::cerr << "Usage: ObstacleEditBenchmark [pentagons per side, at least 2]" << std::endl;
+        return 1;
+    }
+
+    const std::string plainPath = "ObstacleEditBenchmark_" + toString(side);
+    const std::string squarePath = plainPath + "_square";
+    writeMap(plainPath, side, false);
+    writeMap(squarePath, side, true);
+
+    std::cout << std::fixed << std::setprecision(3);
+
+    Clock::time_point start = Clock::now();
+    const Map plain(plainPath);
+    std::cout << side * side << " pentagons, full build " << getMilliseconds(start) << " ms, "
+              << plain.getNavGraph().getEdgeCount() << " edges" << std::endl;
+
+    const Map withSquare(squarePath);
+    std::cout << "with the square, " << withSquare.getNavGraph().getEdgeCount() << " edges" << std::endl;
+
+    // Built again from scratch, leaving the cache the next map loads.
+    std::remove((plainPath + ".nav").c_str());
+    Map built(plainPath);
+
+    start = Clock::now();
+    Map cached(plainPath);
+    std::cout << "cached load " << getMilliseconds(start) << " ms" << std::endl;
+
+    if(!edit("built   ", built, plain, withSquare, side) || !edit("cached  ", cached, plain, withSquare, side))
+        return 1;
+
+    std::cout << "Every graph matches a full build" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,508 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Pathfinder::getPath over a corpus of reproducible scenarios.
+ *
+ * Each procedural scenario is written to a polygon file and loaded as a
+ * map, the same way the game loads one:
+ *   pentagons  the grid of pentagons the other benchmarks use
+ *   random     a jittered grid of random star shaped polygons
+ *   maze       the corridors of a perfect maze, dug out by a depth first walk
+ * A map of the game can be given instead, by the path of its image,
+ * as long as a polygon file is found next to it.
+ *
+ * The same seeded queries, between random free spots and with random
+ * unit diameters, are answered by two pathfinders: one doing a plain A*
+ * search for every query, which is taken as the optimal path, and one
+ * as the game sets it up, with its path cache and hierarchy. For each,
+ * the throughput, latency percentiles and vertices expanded are
+ * reported, along with how much longer the paths are than the optimal
+ * ones. Does not open a window.
+ *
+ * The maps and their cached NavGraphs are written to the working
+ * directory, so later runs skip building the visibility graphs.
+ *
+ * Usage: PathfinderBenchmark [--scenario pentagons|random|maze|all]
+ *                            [--size n] [--queries n] [--seed n]
+ *                            [--map image path]
+ */
+
+#include "Map.hpp"
+#include "Pathfinder.hpp"
+#include "Utility.hpp"
+#include "BenchmarkMaps.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+static const float MIN_DIAMETER = 4.f;
+static const float MAX_DIAMETER = 24.f;
+
+struct Query
+{
+    sf::Vector2f    from;
+    sf::Vector2f    to;
+    float           diameter;
+};
+
+struct Result
+{
+    std::vector<double>     latencies; ///< Microseconds, one per query.
+    std::vector<double>     lengths; ///< One per query. Negative if no path was found.
+    unsigned long long      expansions;
+    double                  totalTime; ///< Seconds.
+};
+
+/**
+ * \brief One star shaped polygon in most cells of a side x side grid.
+ *
+ * The polygons stay far enough inside their cells never to touch, but
+ * close enough to leave passes narrower than the widest units.
+ */
+static std::vector<Polygon> buildRandomField(int side, std::mt19937& random)
+{
+    const float CELL_SIZE = 160.f;
+
+    std::uniform_real_distribution<float> unit(0.f, 1.f);
+    std::vector<Polygon> polygons;
+    for(int y = 0; y < side; y++)
+        for(int x = 0; x < side; x++)
+        {
+            if(unit(random) > 0.75f)
+                continue;
+
+            sf::Vector2f centre((x + 0.5f) * CELL_SIZE + (unit(random) - 0.5f) * 40.f,
+                                (y + 0.5f) * CELL_SIZE + (unit(random) - 0.5f) * 40.f);
+            float radius = 25.f + unit(random) * 30.f;
+            int pointCount = 3 + random() % 6;
+            float phase = unit(random) * 2.f * PI;
+
+            Polygon polygon;
+            for(int i = 0; i < pointCount; i++)
+            {
+                float angle = phase + (i + (unit(random) - 0.5f) * 0.6f) * 2.f * PI / pointCount;
+                float r = radius * (0.7f + 0.3f * unit(random));
+                polygon.push_back(centre + sf::Vector2f(std::cos(angle), std::sin(angle)) * r);
+            }
+
+            polygons.push_back(polygon);
+        }
+
+    return polygons;
+}
+
+/**
+ * \brief Walls of a perfect maze of side x side cells.
+ *
+ * The maze is laid out as a grid of blocks, with the cells on odd rows
+ * and columns and the walls and the pillars between them on even ones.
+ * The outline of each group of joined wall blocks is traced into one
+ * polygon, so that no two polygons overlap or share an edge. The outer
+ * wall is left out: it would enclose the whole maze in a single
+ * polygon, and the maze would be inside its own terrain.
+ */
+static std::vector<Polygon> buildMaze(int side, std::mt19937& random)
+{
+    const float CELL_SIZE = 120.f;
+    const float WALL_THICKNESS = 32.f; // Rounding the end of a wall takes a pass as wide as the wall, so it must fit the widest unit.
+    const int blocks = 2 * side + 1;
+
+    std::vector<bool> isWall(blocks * blocks, false);
+    for(int y = 1; y < blocks - 1; y++)
+        for(int x = 1; x < blocks - 1; x++)
+            isWall[y * blocks + x] = x % 2 == 0 || y % 2 == 0;
+
+    // Dig out a spanning tree of the cells with a depth first walk.
+    std::vector<bool> isVisited(side * side, false);
+    std::vector<int> stack(1, 0);
+    isVisited[0] = true;
+    while(!stack.empty())
+    {
+        int cell = stack.back();
+        int x = cell % side;
+        int y = cell / side;
+
+        int neighbours[4];
+        int neighbourCount = 0;
+        if(x > 0 && !isVisited[cell - 1])
+            neighbours[neighbourCount++] = cell - 1;
+        if(x + 1 < side && !isVisited[cell + 1])
+            neighbours[neighbourCount++] = cell + 1;
+        if(y > 0 && !isVisited[cell - side])
+            neighbours[neighbourCount++] = cell - side;
+        if(y + 1 < side && !isVisited[cell + side])
+            neighbours[neighbourCount++] = cell + side;
+
+        if(neighbourCount == 0)
+        {
+            stack.pop_back();
+            continue;
+        }
+
+        int next = neighbours[random() % neighbourCount];
+        int nx = next % side;
+        int ny = next / side;
+        isWall[(y + ny + 1) * blocks + (x + nx + 1)] = false;
+
+        isVisited[next] = true;
+        stack.push_back(next);
+    }
+
+    // Block line k lies at getLine(k). Wall lines are thin, cell lines wide.
+    auto getLine = [CELL_SIZE, WALL_THICKNESS](int k)
+    {
+        return (k / 2) * CELL_SIZE + (k % 2 == 0 ? -WALL_THICKNESS / 2.f : WALL_THICKNESS / 2.f);
+    };
+
+    auto isWallAt = [&](int x, int y)
+    {
+        return x >= 0 && y >= 0 && x < blocks && y < blocks && isWall[y * blocks + x];
+    };
+
+    /*
+     * Every side of a wall block facing a free one is an edge of the
+     * outline, directed to keep the wall on its right. Corners are
+     * numbered y * (blocks + 1) + x. A corner only ever starts one edge,
+     * since no two wall blocks touch by their corners alone.
+     */
+    const int corners = blocks + 1;
+    std::vector<int> nextCorner(corners * corners, -1);
+    for(int y = 0; y < blocks; y++)
+        for(int x = 0; x < blocks; x++)
+        {
+            if(!isWallAt(x, y))
+                continue;
+
+            if(!isWallAt(x, y - 1))
+                nextCorner[y * corners + x] = y * corners + x + 1;
+            if(!isWallAt(x + 1, y))
+                nextCorner[y * corners + x + 1] = (y + 1) * corners + x + 1;
+            if(!isWallAt(x, y + 1))
+                nextCorner[(y + 1) * corners + x + 1] = (y + 1) * corners + x;
+            if(!isWallAt(x - 1, y))
+                nextCorner[(y + 1) * corners + x] = y * corners + x;
+        }
+
+    std::vector<Polygon> polygons;
+    for(int first = 0; first < corners * corners; first++)
+    {
+        if(nextCorner[first] < 0)
+            continue;
+
+        // Walk the outline, keeping only the corners where it turns.
+        Polygon polygon;
+        const int second = nextCorner[first];
+        int corner = first;
+        do
+        {
+            int previous = corner;
+            corner = nextCorner[corner];
+            nextCorner[previous] = -1;
+
+            int next = corner == first ? second : nextCorner[corner];
+            bool isTurn = (corner % corners - previous % corners) * (next / corners - corner / corners)
+                       != (corner / corners - previous / corners) * (next % corners - corner % corners);
+            if(isTurn)
+                polygon.push_back(sf::Vector2f(getLine(corner % corners), getLine(corner / corners)));
+        }
+        while(corner != first);
+
+        polygons.push_back(polygon);
+    }
+
+    return polygons;
+}
+
+/**
+ * \brief Is p outside the terrain, and at least radius away from it?
+ */
+static bool isFree(const Map& map, sf::Vector2f p, float radius)
+{
+    std::vector<EdgeIndex::Segment> segments;
+    map.getEdgeIndex().getSegments(sf::FloatRect(p.x - radius, p.y - radius, 2.f * radius, 2.f * radius), segments);
+    for(const EdgeIndex::Segment& segment : segments)
+    {
+        sf::Vector2f ab = segment.b - segment.a;
+        float t = lengthSqrd(ab) > 0.f ? std::max(0.f, std::min(1.f, dot(p - segment.a, ab) / lengthSqrd(ab))) : 0.f;
+        if(lengthSqrd(p - (segment.a + ab * t)) < radius * radius)
+            return false;
+    }
+
+    // Inside a polygon if a ray from p crosses its edges an odd number of times.
+    for(const Map::NodePtr& pNode : map.getImpassableTerrain())
+    {
+        const std::vector<sf::Vector2f>& points = pNode->getPoints();
+        bool isInside = false;
+        for(unsigned int i = 0; i + 1 < points.size(); i++)
+        {
+            sf::Vector2f a = points[i];
+            sf::Vector2f b = points[i + 1];
+            if((a.y <= p.y) != (b.y <= p.y) && p.x < a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y))
+                isInside = !isInside;
+        }
+
+        if(isInside)
+            return false;
+    }
+
+    return true;
+}
+
+static std::vector<Query> generateQueries(const Map& map, unsigned int count, std::mt19937& random)
+{
+    sf::Vector2f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    sf::Vector2f max(-min);
+    for(const Map::NodePtr& pNode : map.getImpassableTerrain())
+        for(sf::Vector2f p : pNode->getPoints())
+        {
+            min.x = std::min(min.x, p.x);
+            min.y = std::min(min.y, p.y);
+            max.x = std::max(max.x, p.x);
+            max.y = std::max(max.y, p.y);
+        }
+
+    std::uniform_real_distribution<float> x(min.x, max.x);
+    std::uniform_real_distribution<float> y(min.y, max.y);
+    std::uniform_real_distribution<float> diameter(MIN_DIAMETER, MAX_DIAMETER);
+
+    // Every spot fits the widest unit, so that any query may use it.
+    auto randomSpot = [&]()
+    {
+        sf::Vector2f p;
+        do
+            p = sf::Vector2f(x(random), y(random));
+        while(!isFree(map, p, MAX_DIAMETER / 2.f + 1.f));
+
+        return p;
+    };
+
+    std::vector<Query> queries(count);
+    for(Query& query : queries)
+    {
+        query.from = randomSpot();
+        query.to = randomSpot();
+        query.diameter = diameter(random);
+    }
+
+    return queries;
+}
+
+static Result run(const Pathfinder& pathfinder, const std::vector<Query>& queries)
+{
+    Result result;
+    result.expansions = 0;
+    result.latencies.reserve(queries.size());
+    result.lengths.reserve(queries.size());
+
+    Clock::time_point runStart = Clock::now();
+    for(const Query& query : queries)
+    {
+        unsigned int expansions = 0;
+
+        Clock::time_point start = Clock::now();
+        std::list<Pathfinder::Waypoint> path = pathfinder.getPath(query.diameter, query.from, query.to, &expansions);
+        result.latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+
+        result.lengths.push_back(path.empty() ? -1.0 : getLength(path));
+        result.expansions += expansions;
+    }
+    result.totalTime = std::chrono::duration<double>(Clock::now() - runStart).count();
+
+    return result;
+}
+
+static double getPercentile(std::vector<double> values, double percentile)
+{
+    std::sort(values.begin(), values.end());
+    unsigned int index = std::min<unsigned int>(values.size() - 1, percentile / 100.0 * values.size());
+    return values[index];
+}
+
+static void report(const std::string& name, const Map& map, const std::vector<Query>& queries)
+{
+    // Without a path cache or the hierarchy, so that every path is an A* search.
+    Pathfinder optimalPathfinder(map, 0);
+    optimalPathfinder.setHierarchyDistance(std::numeric_limits<float>::max());
+    Pathfinder defaultPathfinder(map);
+
+    Result results[2] = {run(optimalPathfinder, queries), run(defaultPathfinder, queries)};
+
+    double straightLength = 0.0;
+    double optimalLength = 0.0;
+    for(unsigned int i = 0; i < queries.size(); i++)
+        if(results[0].lengths[i] >= 0.0)
+        {
+            straightLength += length(queries[i].to - queries[i].from);
+            optimalLength += results[0].lengths[i];
+        }
+
+    std::cout << "scenario              " << name << std::endl
+              << "polygons              " << map.getLoadStats().polygonCount << std::endl
+              << "vertices              " << map.getNavGraph().getVertexCount() << std::endl
+              << "queries               " << queries.size() << std::endl
+              << "optimal / straight    " << std::fixed << std::setprecision(3) << (straightLength > 0.0 ? optimalLength / straightLength : 0.0) << std::endl
+              << std::endl
+              << "                      " << std::setw(12) << "A*" << std::setw(12) << "default" << std::endl;
+
+    auto row = [&](const std::string& label, int precision, std::function<double(const Result&)> value)
+    {
+        std::cout << label << std::string(22 - label.size(), ' ') << std::setprecision(precision);
+        for(const Result& result : results)
+            std::cout << std::setw(12) << value(result);
+
+        std::cout << std::endl;
+    };
+
+    row("found", 0, [](const Result& result)
+    {
+        return (double)std::count_if(result.lengths.begin(), result.lengths.end(), [](double l){return l >= 0.0;});
+    });
+    row("throughput (q/s)", 0, [](const Result& result){return result.latencies.size() / result.totalTime;});
+    row("p50 (us)", 1, [](const Result& result){return getPercentile(result.latencies, 50.0);});
+    row("p90 (us)", 1, [](const Result& result){return getPercentile(result.latencies, 90.0);});
+    row("p99 (us)", 1, [](const Result& result){return getPercentile(result.latencies, 99.0);});
+    row("max (us)", 1, [](const Result& result){return getPercentile(result.latencies, 100.0);});
+    row("expansions", 1, [](const Result& result){return (double)result.expansions / result.latencies.size();});
+
+    // Only over the queries both pathfinders found a path for.
+    auto overhead = [&](const Result& result, bool isMax)
+    {
+        double total = 0.0;
+        double worst = 0.0;
+        unsigned int compared = 0;
+        for(unsigned int i = 0; i < queries.size(); i++)
+            if(result.lengths[i] >= 0.0 && results[0].lengths[i] > 0.0)
+            {
+                double ratio = result.lengths[i] / results[0].lengths[i] - 1.0;
+                total += ratio;
+                worst = std::max(worst, ratio);
+                compared++;
+            }
+
+        return 100.0 * (isMax ? worst : (compared ? total / compared : 0.0));
+    };
+    row("vs. optimal (%)", 2, [&](const Result& result){return overhead(result, false);});
+    row("worst vs. optimal (%)", 2, [&](const Result& result){return overhead(result, true);});
+
+    std::cout << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    std::string scenario = "all";
+    std::string mapPath;
+    int size = 16;
+    unsigned int queryCount = 2000;
+    unsigned int seed = 1;
+
+    for(int i = 1; i < argc; i++)
+    {
+        std::string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if(argument == "--scenario" && hasValue)
+            scenario = argv[++i];
+        else if(argument == "--size" && hasValue)
+            size = std::atoi(argv[++i]);
+        else if(argument == "--queries" && hasValue)
+            queryCount = std::atoi(argv[++i]);
+        else if(argument == "--seed" && hasValue)
+            seed = std::atoi(argv[++i]);
+        else if(argument == "--map" && hasValue)
+            mapPath = argv[++i];
+        else
+        {
+            std::cerr << "Usage: PathfinderBenchmark [--scenario pentagons|random|maze|all] [--size n] [--queries n] [--seed n] [--map image path]" << std::endl;
+            return 1;
+        }
+    }
+
+    if(size < 2 || queryCount < 1)
+    {
+        std::cerr << "--size must be at least 2 and --queries at least 1." << std::endl;
+        return 1;
+    }
+
+    if(!mapPath.empty())
+    {
+        Map map(mapPath);
+        if(map.getImpassableTerrain().empty())
+        {
+            std::cerr << "No terrain found in " << mapPath << "." << std::endl;
+            return 1;
+        }
+
+        std::mt19937 random(seed);
+        report(mapPath, map, generateQueries(map, queryCount, random));
+        return 0;
+    }
+
+    const std::string scenarios[3] = {"pentagons", "random", "maze"};
+    bool isKnown = scenario == "all";
+    for(const std::string& name : scenarios)
+    {
+        if(scenario != "all" && scenario != name)
+            continue;
+
+        isKnown = true;
+
+        // The map and the queries each get their own generator, so that changing one leaves the other as it was.
+        std::mt19937 mapRandom(seed);
+        std::vector<Polygon> polygons;
+        if(name == "pentagons")
+            polygons = buildPentagons(size);
+        else if(name == "random")
+            polygons = buildRandomField(size, mapRandom);
+        else
+            polygons = buildMaze(size, mapRandom);
+
+        const std::string description = name + " " + toString(size) + " seed " + toString(seed);
+        const std::string filePath = "PathfinderBenchmark_" + name + "_" + toString(size) + "_" + toString(seed);
+        writePolygons(filePath, description + ", written by PathfinderBenchmark.", polygons);
+
+        Map map(filePath);
+        std::mt19937 queryRandom(seed + 1);
+        report(description, map, generateQueries(map, queryCount, queryRandom));
+    }
+
+    if(!isKnown)
+    {
+        std::cerr << "Unknown scenario " << scenario << "." << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
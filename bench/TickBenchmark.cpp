@@ -0,0 +1,237 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+/*
+ * Scaling of the simulation tick with the number of threads, headless.
+ *
+ * Two hostile armies share a map with a field of rocks at the far side.
+ * The attackers come in groups. Some each attack a few of the defenders
+ * in turn, some march straight through the defenders and past the
+ * rocks, and in the rest every ant is ordered on its own, to attack a
+ * defender or to go somewhere behind the rocks. So state updates, path
+ * requests, both collission phases, damage and crowd steering all carry
+ * load. The same battle is run with 1, 2, 4, ... threads up to the given
+ * count, reporting the time per tick and the speedup over a single
+ * thread, and every run must leave each ant in exactly the same place
+ * with exactly the same hp. Does not open a window.
+ *
+ * Usage: TickBenchmark [ants] [ticks] [--threads N, 0 for one per core]
+ */
+
+#include "Map.hpp"
+#include "EntitiesManager.hpp"
+#include "EntityNode.hpp"
+#include "EntityStore.hpp"
+#include "CommandQueue.hpp"
+#include "Team.hpp"
+#include "TIME_PER_FRAME.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <random>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <thread>
+////////////////////////////////////////////////
+
+typedef std::chrono::steady_clock Clock;
+
+static const float ANT_SPACING = 14.f;  ///< Side of the square of ground per ant.
+static const unsigned int GROUP_SIZE = 50;
+static const unsigned int TARGETS_PER_GROUP = 4;
+static const int DEFENDER_HP = 200;
+static const float ROCK_SIZE = 3.f * ANT_SPACING;
+static const int ROCK_COLUMNS = 4;
+
+struct Result
+{
+    double                      meanTime;
+    unsigned int                survivorCount;
+    std::vector<sf::Vector2f>   positions; ///< In store order.
+    std::vector<int>            hps;
+};
+
+static Result run(const std::string& filePath, int antCount, int tickCount, unsigned int threadCount)
+{
+    float side = std::sqrt((float)antCount) * ANT_SPACING;
+    Map map(filePath, sf::Vector2f(side * 2, side));
+    CommandQueue commandQueue;
+    EntitiesManager entitiesManager(map, commandQueue);
+    entitiesManager.setThreadCount(threadCount);
+
+    Team attackers(1 << 0);
+    Team defenders(1 << 1);
+    attackers.addHostile(defenders.getId());
+    defenders.addHostile(attackers.getId());
+
+    // Attackers stand in the left quarter, defenders across the middle half.
+    std::mt19937 random(antCount);
+    std::uniform_real_distribution<float> x(0.f, side / 2);
+    std::uniform_real_distribution<float> y(0.f, side);
+
+    sf::Sprite sprite;
+    sprite.setTextureRect(sf::IntRect(0, 0, 10, 10));
+
+    std::vector<EntityNode*> attackerAnts;
+    std::vector<EntityNode*> defenderAnts;
+    for(int i = 0; i < antCount; i++)
+    {
+        bool isAttacker = i < antCount / 2;
+        sf::Vector2f position(isAttacker ? x(random) : side / 2 + x(random) * 2, y(random));
+        std::unique_ptr<EntityNode> ant(isAttacker
+            ? new EntityNode(10, position, attackers, entitiesManager)
+            : new EntityNode(DEFENDER_HP, position, defenders, entitiesManager));
+        ant->setSprite(sprite);
+
+        (isAttacker ? attackerAnts : defenderAnts).push_back(ant.get());
+        entitiesManager.insertEntity(std::move(ant));
+    }
+
+    // A third of the groups march through, a third attack defenders in turn, and the rest get single orders.
+    std::uniform_int_distribution<unsigned int> defender(0, defenderAnts.size() - 1);
+    std::uniform_real_distribution<float> behindRocks(side * 1.8f, side * 2.f);
+    for(unsigned int i = 0; i < attackerAnts.size(); i += GROUP_SIZE)
+    {
+        std::vector<EntityNode*> group(attackerAnts.begin() + i, attackerAnts.begin() + std::min<unsigned int>(attackerAnts.size(), i + GROUP_SIZE));
+
+        if((i / GROUP_SIZE) % 3 == 2)
+        {
+            for(unsigned int j = 0; j < group.size(); j++)
+            {
+                if(j % 2 == 0)
+                    group[j]->interact(defenderAnts[defender(random)]);
+                else
+                    group[j]->goTo(sf::Vector2f(behindRocks(random), y(random)));
+            }
+        }
+        else if((i / GROUP_SIZE) % 3 == 0)
+        {
+            sf::Vector2f centre;
+            for(EntityNode* ant : group)
+                centre += ant->getPosition();
+            centre /= (float)group.size();
+
+            EntityNode::groupGoTo(group, sf::Vector2f(side * 2 - centre.x, centre.y));
+        }
+        else
+            for(unsigned int j = 0; j < TARGETS_PER_GROUP; j++)
+                EntityNode::groupInteract(group, defenderAnts[defender(random)], j > 0);
+    }
+
+    Result result;
+    result.meanTime = 0.0;
+    for(int i = 0; i < tickCount; i++)
+    {
+        Clock::time_point start = Clock::now();
+        entitiesManager.update();
+        entitiesManager.removeWrecks();
+        result.meanTime += std::chrono::duration<double, std::milli>(Clock::now() - start).count() / tickCount;
+    }
+
+    // Wrecks were removed in the same order every run, so the store order is comparable.
+    const EntityStore& store = entitiesManager.getEntityStore();
+    result.survivorCount = store.getEntityCount();
+    for(unsigned int i = 0; i < store.getEntityCount(); i++)
+    {
+        EntityNode* ant = store.getEntity(i);
+        result.positions.push_back(ant->getPosition());
+        result.hps.push_back(ant->getAttributes().hp);
+    }
+
+    return result;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<int> values;
+    int threadCount = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        if(std::string(argv[i]) == "--threads" && i + 1 < argc)
+            threadCount = std::atoi(argv[++i]);
+        else
+            values.push_back(std::atoi(argv[i]));
+    }
+
+    const int antCount = values.size() > 0 ? values[0] : 5000;
+    const int tickCount = values.size() > 1 ? values[1] : 600;
+    if(antCount < 2 * (int)GROUP_SIZE || tickCount < 1 || threadCount < 0 || values.size() > 2)
+    {
+        std::cerr << "Usage: TickBenchmark [ants, at least " << 2 * GROUP_SIZE << "] [ticks] [--threads N, 0 for one per core]" << std::endl;
+        return 1;
+    }
+
+    TIME_PER_FRAME::setAsSeconds(1.f / 60.f);
+
+    // Staggered columns of rocks between the defenders and the far side, with gaps as wide as the rocks.
+    const std::string filePath = "TickBenchmark";
+    {
+        float side = std::sqrt((float)antCount) * ANT_SPACING;
+        std::ofstream file(filePath + ".poly");
+        file << "# Written by TickBenchmark." << std::endl;
+        for(int column = 0; column < ROCK_COLUMNS; column++)
+            for(float top = (column % 2 + 1) * ROCK_SIZE; top + ROCK_SIZE < side; top += 2.f * ROCK_SIZE)
+            {
+                float left = side * 1.55f + column * 2.f * ROCK_SIZE;
+                file << left << " " << top << " " << left + ROCK_SIZE << " " << top << " "
+                     << left + ROCK_SIZE << " " << top + ROCK_SIZE << " " << left << " " << top + ROCK_SIZE << std::endl;
+            }
+    }
+
+    const unsigned int maxThreadCount = threadCount > 0 ? threadCount : std::max(std::thread::hardware_concurrency(), 1u);
+    std::cout << antCount << " ants, " << tickCount << " ticks, up to " << maxThreadCount << " threads" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+
+    Result single;
+    for(unsigned int threads = 1; ; threads = std::min(threads * 2, maxThreadCount))
+    {
+        Result result = run(filePath, antCount, tickCount, threads);
+        if(threads == 1)
+            single = result;
+
+        std::cout << std::setw(3) << threads << " threads "
+                  << std::setw(9) << result.meanTime << " ms/tick, speedup "
+                  << std::setw(6) << single.meanTime / result.meanTime << ", "
+                  << result.survivorCount << " ants left" << std::endl;
+
+        if(result.positions != single.positions || result.hps != single.hps)
+        {
+            std::cerr << "The battle ends differently with " << threads << " threads than with 1" << std::endl;
+            return 1;
+        }
+
+        if(threads == maxThreadCount)
+            break;
+    }
+
+    std::cout << "Same battle with every thread count" << std::endl;
+
+    return 0;
+}
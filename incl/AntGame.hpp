@@ -49,7 +49,7 @@ class AntGame
 {
 
     public:
-        AntGame(unsigned int sizeX, unsigned int sizeY);
+        AntGame(unsigned int sizeX, unsigned int sizeY, unsigned int threadCount = 0);
 
         void processInput();
         void update();
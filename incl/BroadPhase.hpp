@@ -0,0 +1,99 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+#ifndef ANTGAME_BROADPHASE_HPP
+#define ANTGAME_BROADPHASE_HPP
+
+////////////////////////////////////////////////
+// C++ Standard Library
+#include <vector>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/Graphics/Rect.hpp"
+////////////////////////////////////////////////
+
+class EntityNode;
+
+/**
+ * \brief Broad phase of collission detection.
+ *
+ * Keeps track of the bounding rects of entities and finds the pairs
+ * of them that may collide, leaving the exact test to the narrow phase.
+ * A broad phase keeps the index it stores an entity at as the entity's
+ * collission handle, so an entity is in at most one broad phase.
+ */
+class BroadPhase
+{
+    public:
+        typedef std::pair<EntityNode*, EntityNode*> Pair;
+
+        struct Proxy
+        {
+            EntityNode*     entity;
+            sf::FloatRect   rect; ///< Bounding rect of entity as of the last update.
+        };
+
+        enum Type
+        {
+            QuadtreeType,
+            SpatialHashType,
+            SweepAndPruneType,
+            TypeCount,
+        };
+
+    public:
+        virtual ~BroadPhase();
+
+        virtual void    update() = 0; ///< Catch up with the entities that moved since the last update.
+        virtual void    insertEntity(EntityNode* entity) = 0; ///< Does nothing if entity is already in a broad phase.
+        virtual void    eraseEntity(EntityNode* entity) = 0;
+        virtual void    removeWrecks() = 0;
+
+        /**
+         * \brief Get the pairs of entities whose rects touch.
+         *
+         * Rects are as of the last update. Every pair is written once,
+         * so there are no duplicates to weed out. pairs is cleared
+         * first; passing the same vector every tick reuses its memory.
+         */
+        virtual void    getNearbyEntities(std::vector<Pair>& pairs) const = 0;
+
+        /**
+         * \brief Get the entities whose rects touch area.
+         *
+         * Rects are as of the last update. proxies is cleared first.
+         * Only reads the broad phase, so it may be called from several
+         * threads at once between updates.
+         */
+        virtual void    getEntitiesIn(sf::FloatRect area, std::vector<Proxy>& proxies) const = 0;
+
+        virtual int     getEntityCount() const = 0;
+
+        /////////////////////////////////////////////////////////
+        // For testing purposes
+        virtual void    getCells(std::vector<sf::FloatRect>& cells) const = 0; ///< Cells the world is divided into.
+        /////////////////////////////////////////////////////////
+};
+
+#endif //ANTGAME_BROADPHASE_HPP
@@ -1,5 +1,5 @@
-#ifndef ANTGAME_COLLISSIONFINDER_HPP
-#define ANTGAME_COLLISSIONFINDER_HPP
+#ifndef ANTGAME_COLLISSIONFINDER_HPP
+#define ANTGAME_COLLISSIONFINDER_HPP
 
 /****************************************************************
 ****************************************************************
@@ -25,9 +25,8 @@
 
 
 ////////////////////////////////////////////////
-// STD - C++ Standard Library
-#include <list>
-#include <set>
+// STD - C++ Standard Library
+#include <vector>
 ////////////////////////////////////////////////
 
 ////////////////////////////////////////////////
@@ -37,19 +36,85 @@
 
 class EntityNode;
 
+/**
+ * \brief Narrow phase of collission detection.
+ *
+ * Tests the pairs found by the broad phase for overlapping circles, in
+ * batches. The position and radius of every entity in a pair are read
+ * once per tick into arrays indexed by its collission handle, and the
+ * pairs laid out as arrays of offsets and radius sums. They are then
+ * tested eight at a time with AVX, four at a time with SSE2, or one at a
+ * time where neither is available.
+ */
 class CollissionFinder
 {
     public:
+        typedef std::pair<EntityNode*, EntityNode*> Pair;
+
         struct CollissionData
         {
             EntityNode* lNode;
             EntityNode* rNode;
 
             float           penetrationDepth;
-            sf::Vector2f    unitVector;
+            sf::Vector2f    unitVector; ///< From rNode towards lNode.
         };
 
-        std::list<CollissionData> getCollissions(std::set<std::pair<EntityNode*, EntityNode*>>& nearbyEntities);
+    public:
+        CollissionFinder();
+
+        /**
+         * \brief Get the pairs of nearbyEntities whose circles overlap.
+         *
+         * The entities must be in a broad phase, which gives them their
+         * collission handles. The collissions are written into a buffer
+         * kept between calls, valid until the next one.
+         */
+        const std::vector<CollissionData>& getCollissions(const std::vector<Pair>& nearbyEntities);
+
+        /////////////////////////////////////////////////////////
+        // The steps of getCollissions(), for testing in parallel.
+        void    gather(const std::vector<Pair>& pairs); ///< Read the entities of the pairs.
+
+        /**
+         * \brief Test the gathered pairs from first to end - 1.
+         *
+         * Adds the ones that collide to collissions. Ranges may be tested
+         * in parallel, each into a vector of its own.
+         */
+        void    findCollissions(const std::vector<Pair>& pairs, int first, int end, std::vector<CollissionData>& collissions) const;
+        /////////////////////////////////////////////////////////
+
+        static bool isVectorizable(); ///< True if built with SSE2 or AVX.
+        void        setVectorized(bool isVectorized); ///< Test one pair at a time even where SIMD is available. For benchmarking.
+
+    private:
+        int     gatherEntity(EntityNode* entity); ///< Read the position and radius of entity, unless already read this tick. Returns its index.
+        void    testScalar(const std::vector<Pair>& pairs, int first, int end, std::vector<CollissionData>& collissions) const; ///< Test pairs one at a time.
+        void    testVectorized(const std::vector<Pair>& pairs, int first, int end, std::vector<CollissionData>& collissions) const; ///< Test as many whole batches of pairs as there are.
+
+        static void addCollission(const Pair& pair, float dx, float dy, float radiusSum, float distance, std::vector<CollissionData>& collissions);
+
+    private:
+        bool                        mIsVectorized;
+        unsigned int                mTick; ///< Tells which entities have been read this tick.
+
+        ////////////////////////////////////////////////
+        // Entities, indexed by collission handle.
+        std::vector<unsigned int>   mReadTicks;
+        std::vector<float>          mXs;
+        std::vector<float>          mYs;
+        std::vector<float>          mRadii;
+        ////////////////////////////////////////////////
+
+        ////////////////////////////////////////////////
+        // Pairs, in the order of nearbyEntities.
+        std::vector<float>          mDxs; ///< From the second entity towards the first.
+        std::vector<float>          mDys;
+        std::vector<float>          mRadiusSums;
+        ////////////////////////////////////////////////
+
+        std::vector<CollissionData> mCollissions;
 };
 
 #endif //ANTGAME_COLLISSIONFINDER_HPP
@@ -20,23 +20,49 @@
 ****************************************************************
 ****************************************************************/
 
-#ifndef ANTGAME_COLLISSIONHANDLER_HPP
-#define ANTGAME_COLLISSIONHANDLER_HPP
+#ifndef ANTGAME_COLLISSIONHANDLER_HPP
+#define ANTGAME_COLLISSIONHANDLER_HPP
 
 ////////////////////////////////////////////////
-// STD - C++ Standard Library
-#include <list>
+// STD - C++ Standard Library
+#include <vector>
 ////////////////////////////////////////////////
 
 #include "CollissionFinder.hpp"
 
+/**
+ * \brief Pushes colliding entities apart.
+ *
+ * A position based solver: each contact moves both of its entities
+ * half of its overlap apart, straight along the line between them.
+ * Since entities are in several contacts at once, separating one pair
+ * may push another together, so the contacts are swept a few times,
+ * each one seeing the positions left by the ones before it.
+ *
+ * Entities are only moved, not given new orders. The ones that are
+ * moving head for their next waypoint again from where they were
+ * pushed to.
+ */
 class CollissionHandler
 {
     public:
-        void    handleCollissions(std::list<CollissionFinder::CollissionData> collissions);
+        void    handleCollissions(const std::vector<CollissionFinder::CollissionData>& collissions);
 
     private:
         typedef CollissionFinder::CollissionData CollissionData;
+
+        struct Contact
+        {
+            EntityNode*     lNode;
+            EntityNode*     rNode;
+            float           restDistance; ///< Distance between the entities at which they just touch.
+            sf::Vector2f    unitVector; ///< Direction to push lNode in if the entities are on top of each other.
+        };
+
+    private:
+        static const unsigned int SOLVER_ITERATIONS = 4;
+
+        std::vector<Contact> mContacts; ///< Kept between calls to reuse its memory.
 };
 
 #endif //ANTGAME_COLLISSIONHANDLER_HPP
@@ -26,6 +26,7 @@
 ////////////////////////////////////////////////
 // STD - C++ Standard Library
 #include <list>
+#include <vector>
 #include <memory>
 ////////////////////////////////////////////////
 
@@ -37,26 +38,39 @@
 #include "SFML/Graphics/Texture.hpp"
 ////////////////////////////////////////////////
 
-#include "Quadtree.hpp"
+#include "BroadPhase.hpp"
 #include "CollissionFinder.hpp"
 #include "CollissionHandler.hpp"
 
 class CollissionManager
 {
     public:
-        CollissionManager(sf::FloatRect area);
+        CollissionManager(sf::FloatRect area, BroadPhase::Type broadPhase);
 
-        void    update();
+        void    update(); ///< Find and handle the collissions, all on the calling thread.
         void    insertEntity(EntityNode* entity);
         void    removeWrecks();
 
-        std::list<const Quadtree*> getQuadtree() const; ///< For Quadtree debugging.
+        const BroadPhase& getBroadPhase() const;
+        std::vector<sf::FloatRect> getCells() const; ///< For broad phase debugging.
+
+        /////////////////////////////////////////////////////////
+        // The steps of update(), for running the narrow phase in parallel.
+        void            findNearbyEntities(); ///< Update the broad phase and gather the pairs it finds.
+        unsigned int    getRangeCount() const; ///< Ranges of the pairs to test.
+        void            findCollissions(unsigned int range); ///< Ranges may be tested in parallel.
+        void            handleCollissions(); ///< In the order of the pairs, whichever thread found them.
+        /////////////////////////////////////////////////////////
 
     private:
+        static const unsigned int PAIRS_PER_RANGE = 1024;
+
         CollissionFinder    mFinder;
         CollissionHandler   mHandler;
-        Quadtree            mQuadtree;
-        std::list<Quadtree::Node> mQuadtreeNodes;
+        std::unique_ptr<BroadPhase> mBroadPhase;
+        std::vector<BroadPhase::Pair> mNearbyEntities; ///< Kept between updates to reuse its memory.
+        std::vector<std::vector<CollissionFinder::CollissionData>> mRangeCollissions; ///< Found in each range of mNearbyEntities.
+        std::vector<CollissionFinder::CollissionData> mCollissions;
 };
 
 
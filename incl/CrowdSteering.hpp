@@ -0,0 +1,132 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_CROWDSTEERING_HPP
+#define ANTGAME_CROWDSTEERING_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <vector>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/Vector2.hpp"
+////////////////////////////////////////////////
+
+#include "BroadPhase.hpp"
+
+class EntityNode;
+
+/**
+ * \brief Steers moving entities clear of each other by optimal reciprocal collission avoidance.
+ *
+ * Every tick, each moving entity hands in the velocity it would like to
+ * move at, and gets back the velocity solved for it at the end of the
+ * tick before. At the end of the tick, its closest neighbours are looked
+ * up in the broad phase. Each one it could hit within TIME_HORIZON rules
+ * out a half plane of velocities, and a small linear program finds the
+ * allowed velocity closest to the preferred one. Two moving entities
+ * each take half of the evasion. An entity standing still does not
+ * evade, so one moving into it takes all of it.
+ *
+ * Every velocity is solved from where the entities were and how they
+ * moved, none from another velocity solved in the same tick, so they
+ * may be solved in parallel. The entities are solved in the order of
+ * their handles in the EntityStore, so the result depends neither on
+ * the threads nor on the order the entities were steered in.
+ *
+ * A tick goes: resize(), steer() for each moving entity, gatherAgents(),
+ * solve() over all agents, and finish().
+ */
+class CrowdSteering
+{
+    public:
+        CrowdSteering();
+
+        void            resize(unsigned int handleCount); ///< Make room for entities with handles below handleCount, before they are steered.
+
+        /**
+         * \brief Get the velocity to move entity at this tick.
+         *
+         * Call at most once per tick for each moving entity. If it was
+         * steered the tick before, it gets the velocity solved then, and
+         * preferredVelocity otherwise. Different entities may be steered
+         * in parallel.
+         */
+        sf::Vector2f    steer(EntityNode& entity, sf::Vector2f preferredVelocity, float maxSpeed);
+
+        unsigned int    gatherAgents(); ///< Collect the entities steered this tick. Returns how many.
+
+        /**
+         * \brief Solve the velocities of agents first to end - 1.
+         *
+         * Call after broadPhase has caught up with the moves of the tick.
+         * Ranges may be solved in parallel, each with a thread index
+         * below the thread count.
+         */
+        void            solve(const BroadPhase& broadPhase, unsigned int first, unsigned int end, unsigned int thread);
+        void            finish(); ///< Hand out the solved velocities in the next tick.
+
+        void            setThreadCount(unsigned int threadCount); ///< Threads that may solve at once.
+        unsigned int    getAgentCount() const; ///< Entities steered in the last tick.
+
+    private:
+        struct Line
+        {
+            sf::Vector2f    point;
+            sf::Vector2f    direction; ///< Velocities to the left of it are allowed.
+        };
+
+        struct Workspace ///< Scratch memory of one thread.
+        {
+            std::vector<BroadPhase::Proxy>  neighbours;
+            std::vector<Line>               lines;
+            std::vector<Line>               projectedLines;
+        };
+
+        sf::Vector2f    solve(const BroadPhase& broadPhase, unsigned int handle, Workspace& workspace) const;
+        bool            isSteered(EntityNode* entity) const; ///< True if entity was steered this tick.
+
+    private:
+        static const float          TIME_HORIZON; ///< Seconds ahead that collissions are avoided.
+        static const float          NEIGHBOUR_DISTANCE; ///< From the centre of an entity, along either axis.
+        static const unsigned int   MAX_NEIGHBOURS = 10;
+
+        unsigned int                mTick;
+        std::vector<unsigned int>   mAgents; ///< Handles of the entities steered this tick, in order.
+        std::vector<sf::Vector2f>   mSolvedVelocities; ///< Of mAgents.
+        std::vector<Workspace>      mWorkspaces; ///< One per thread.
+
+        ////////////////////////////////////////////////
+        // Entities, indexed by their handle in the EntityStore.
+        std::vector<EntityNode*>    mEntities; ///< Last entity steered with the handle.
+        std::vector<unsigned int>   mSteeredTicks; ///< Last tick the entity was steered in.
+        std::vector<sf::Vector2f>   mVelocities; ///< Velocity the entity moved at in that tick.
+        std::vector<sf::Vector2f>   mPreferredVelocities;
+        std::vector<float>          mMaxSpeeds;
+        std::vector<sf::Vector2f>   mNextVelocities; ///< Solved at the end of that tick, for the next.
+        ////////////////////////////////////////////////
+};
+
+#endif //ANTGAME_CROWDSTEERING_HPP
@@ -0,0 +1,108 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_EDGEINDEX_HPP
+#define ANTGAME_EDGEINDEX_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <vector>
+#include <list>
+#include <memory>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/Vector2.hpp"
+#include "SFML/Graphics/Rect.hpp"
+////////////////////////////////////////////////
+
+class TerrainCollissionNode;
+
+/**
+ * \brief Uniform grid over the polygon edges of the terrain.
+ *
+ * Every edge is stored in each cell it passes through. A line of sight
+ * query walks the cells covered by the segment and only tests the edges
+ * stored in those, instead of every edge of every node.
+ *
+ * The edges of cell i are stored in [mCellOffsets[i], mCellOffsets[i + 1])
+ * of mCellEdges.
+ */
+class EdgeIndex
+{
+    public:
+        struct Segment
+        {
+            sf::Vector2f a;
+            sf::Vector2f b;
+        };
+
+        EdgeIndex();
+
+        void    build(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes);
+        void    clear();
+
+        /**
+         * \brief Does the segment a-b cross any terrain edge?
+         *
+         * Edges sharing an end point with the segment are ignored, the
+         * same way TerrainCollissionNode::isLineIntersecting does it.
+         */
+        bool    isLineIntersecting(sf::Vector2f a, sf::Vector2f b) const;
+
+        /**
+         * \brief Get the segments stored in the cells covered by rect.
+         *
+         * Every segment passing through rect is included, along with
+         * some that only pass close to it. Each segment is included once.
+         */
+        void    getSegments(sf::FloatRect rect, std::vector<Segment>& segments) const;
+
+        int             getSegmentCount() const;
+        sf::Vector2i    getGridSize() const;
+        float           getCellSize() const;
+        sf::Vector2f    getOrigin() const; ///< Top left corner of the grid.
+
+    private:
+        /**
+         * \brief Call function with the index of every cell the segment a-b covers.
+         *
+         * Stops and returns true as soon as function returns true.
+         */
+        template<typename Function>
+        bool    forEachCell(sf::Vector2f a, sf::Vector2f b, Function function) const;
+
+    private:
+        static const int MAX_CELLS_PER_AXIS = 256;
+
+        std::vector<Segment>    mSegments;
+        std::vector<int>        mCellOffsets; ///< Has one more element than there are cells.
+        std::vector<int>        mCellEdges; ///< Indices into mSegments.
+        sf::Vector2f            mOrigin; ///< Top left corner of the grid.
+        float                   mCellSize;
+        int                     mColumns;
+        int                     mRows;
+};
+
+#endif // ANTGAME_EDGEINDEX_HPP
@@ -32,21 +32,37 @@
 ////////////////////////////////////////////////
 // SFML - Simple and Fast Media Library
 #include "SFML/Graphics/RenderTarget.hpp"
+#include "SFML/Window/Event.hpp"
 ////////////////////////////////////////////////
 
 
 #include "EntityNode.hpp"
+#include "EntityStore.hpp"
 #include "CollissionManager.hpp"
+#include "PathRequestQueue.hpp"
+#include "CrowdSteering.hpp"
+#include "TickScheduler.hpp"
 
 
 class CommandQueue;
 class Map;
+class TerrainCollissionNode;
 
 class EntitiesManager
 {
     public:
-        EntitiesManager(const Map& map, CommandQueue& commandQueue);
+        EntitiesManager(Map& map, CommandQueue& commandQueue);
 
+        /**
+         * \brief Simulate a tick.
+         *
+         * Runs as jobs over ranges of entities, on as many threads as
+         * set. Entities update in parallel, so the velocities they are
+         * steered at are handed out from several threads at once, and
+         * the paths they request are queued once all of them are done.
+         * The broad phase update stays serial. The tick comes out the
+         * same on any number of threads.
+         */
         void update();
         void handleEvent(const sf::Event& event);
         void draw(sf::RenderTarget& target) const;
@@ -56,12 +72,100 @@ class EntitiesManager
         void insertEntity(std::unique_ptr<EntityNode> entity);
 
         std::list<Pathfinder::Waypoint> getPath(float diameter, sf::Vector2f a, sf::Vector2f b);
+        std::list<Pathfinder::Waypoint> getPath(const Pathfinder::SearchTree& tree, sf::Vector2f a, sf::Vector2f b);
+        std::list<Pathfinder::Waypoint> getPath(Pathfinder::Chase& chase, sf::Vector2f a, sf::Vector2f b); ///< Repairs the search of chase instead of searching again.
+
+        /**
+         * \brief Solve routes from everywhere to b in one search.
+         *
+         * Used when a group is ordered to the same destination.
+         */
+        Pathfinder::SearchTreePtr getSearchTree(float diameter, sf::Vector2f b);
+
+        /**
+         * \brief Get the directions to b from everywhere on the map.
+         *
+         * Used when a large group is ordered onto the same target.
+         */
+        Pathfinder::FlowFieldPtr getFlowField(float diameter, sf::Vector2f b);
+
+        /**
+         * \brief Get the next waypoints of a long path.
+         *
+         * Called as the waypoints found so far run out.
+         */
+        std::list<Pathfinder::Waypoint> refinePath(Pathfinder::AbstractPath& path);
+
+        /**
+         * \brief Solve a path for entity asynchronously.
+         *
+         * Requests made while entities update in parallel are kept with
+         * the entity, and queued in handle order once all of them have
+         * updated. callback is called from a later update() once the
+         * path has been found, unless the request is cancelled before
+         * that. A new request of the entity replaces the one before.
+         *
+         * Returns a ticket for cancelPath(), never 0.
+         */
+        unsigned int requestPath(const EntityNode& entity, float diameter, sf::Vector2f a, sf::Vector2f b, PathRequestQueue::Callback callback);
+        void cancelPath(const EntityNode& entity, unsigned int ticket); ///< Does nothing if entity has made a new request since.
+        PathRequestQueue::Metrics getPathMetrics() const;
+        PathCache::Metrics getPathCacheMetrics() const;
+
+        /**
+         * \brief Change the terrain of the map.
+         *
+         * Path requests are only solved during update(), so their
+         * workers never read the map while it changes.
+         */
+        TerrainCollissionNode* insertObstacle(std::unique_ptr<TerrainCollissionNode> pObstacle);
+        bool removeObstacle(const TerrainCollissionNode* pObstacle);
+
+        /**
+         * \brief Get the velocity entity should move at this tick.
+         *
+         * The one closest to preferredVelocity that avoids the units
+         * around, as solved at the end of the last tick. Call it once
+         * per tick for every moving entity.
+         */
+        sf::Vector2f steer(EntityNode& entity, sf::Vector2f preferredVelocity);
+        EntityStore& getEntityStore();
+        void setThreadCount(unsigned int threadCount); ///< Threads that update() runs on. 0 for one per core.
+        unsigned int getThreadCount() const;
 
     private:
+        /**
+         * \brief The path request of an entity.
+         */
+        struct PathSlot
+        {
+            PathSlot();
+            unsigned int                ticket; ///< Of the latest request.
+            bool                        isWaiting; ///< True if the request below has not been queued yet.
+            PathRequestQueue::Handle    handle; ///< Of the queued request, 0 if none.
+            float                       diameter;
+            sf::Vector2f                a;
+            sf::Vector2f                b;
+            PathRequestQueue::Callback  callback;
+        };
+
+        void queuePathRequests(); ///< Queue the requests kept with the entities, in handle order.
+
+    private:
+        static const unsigned int PATH_EXPANSIONS_PER_TICK = 20000;
+        static const unsigned int ENTITIES_PER_JOB = 256; ///< Entities updated or moved by each job of a tick.
+        static const unsigned int AGENTS_PER_JOB = 128; ///< Entities steered by each job of a tick.
+
+        Map&                mMap;
         CommandQueue&       mCommandQueue;
-        SceneNode           mEntitiesGraph;
+        EntityStore         mEntityStore; ///< Declared before mEntitiesGraph, so that it outlives the entities.
         CollissionManager   mCollissionManager;
+        CrowdSteering       mCrowdSteering;
         Pathfinder          mPathfinder;
+        PathRequestQueue    mPathRequests;
+        std::vector<PathSlot> mPathSlots; ///< One per entity handle. Entities only touch their own while updating.
+        TickScheduler       mScheduler;
+        SceneNode           mEntitiesGraph; ///< Declared last so that entities are destroyed while mPathRequests still exists.
 };
 
 #endif // ANTGAME_ENTITIESMANAGER_HPP
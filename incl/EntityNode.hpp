@@ -29,46 +29,56 @@
 #include "SFML/Graphics/Sprite.hpp"
 ////////////////////////////////////////////////
 
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <vector>
+////////////////////////////////////////////////
+
 
 #include "SceneNode.hpp"
 #include "StateQueue.hpp"
+#include "EntityStore.hpp"
 
 class CommandQueue;
 class Team;
 class EntitiesManager;
 
+/**
+ * \brief A unit in the scene graph.
+ *
+ * Its position, velocity, bounds and attributes live in the EntityStore
+ * of its EntitiesManager, which the systems run over. The node reads
+ * and writes them there, and draws itself at the stored position. Its
+ * sf::Transformable position is not used, so move it through
+ * EntityNode rather than through a SceneNode pointer.
+ */
 class EntityNode : public SceneNode
 {
     public:
-        struct Attributes
-        {
-            Attributes(int baseHp, float baseMovementSpeed, int attackDamage, float attackRange);
-
-            const int   baseHp;
-            int         hp;
-
-            const float baseMovementSpeed;
-            float       movementSpeed;
-
-            const int   baseAttackDamage;
-            int         attackDamage;
-
-            const float baseAttackRange;
-            float       attackRange;
-        };
+        typedef EntityStore::Attributes Attributes;
 
     public:
 
 
         EntityNode(int hp, sf::Vector2f position, Team& team, EntitiesManager& entitiesManager, Category::Type category = Category::Entity);
+        virtual ~EntityNode();
 
         void            damage(int points);
         void            destroy();
+        void            strike(EntityNode& target, int points); ///< Damage target at the end of the tick. Safe while other entities update.
 
         virtual bool            isMarkedForRemoval() const;
         virtual void            drawCurrent(sf::RenderTarget&, sf::RenderStates) const;
         virtual void            updateCurrent(CommandQueue& commands);
         virtual sf::FloatRect   getBoundingRect() const;
+        virtual unsigned int    getCategory() const;
+
+        sf::Vector2f    getPosition() const;
+        void            setPosition(sf::Vector2f position);
+        void            move(sf::Vector2f offset);
+
+        sf::Vector2f    getVelocity() const;
+        void            setVelocity(sf::Vector2f velocity); ///< Moved at when the EntitiesManager updates, then reset.
 
         void setTexture(const sf::Texture& texture);
         void setSprite(sf::Sprite sprite);
@@ -76,23 +86,68 @@ class EntityNode : public SceneNode
         virtual void interact(EntityNode* target, bool isAppending = false);
         virtual void goTo(sf::Vector2f target, bool isAppending = false);
 
+        /**
+         * \brief Move a group of entities to target in formation.
+         *
+         * Searches the navigation graph once for the whole group. Each
+         * entity then reads its route from the shared search tree and is
+         * given its own slot in a grid centred on target.
+         */
+        static void groupGoTo(const std::vector<EntityNode*>& group, sf::Vector2f target, bool isAppending = false);
+
+        /**
+         * \brief Have a group of entities interact with target.
+         *
+         * If enough of them are to attack it, they all close in along one
+         * flow field instead of each searching for a path of its own.
+         */
+        static void groupInteract(const std::vector<EntityNode*>& group, EntityNode* target, bool isAppending = false);
+
         const Attributes& getAttributes() const;
         unsigned int getTeamId() const;
+        float getDiameter() const;
+
+        /**
+         * \brief Move on from the current state if it is done.
+         *
+         * Called by the EntitiesManager once the damage of the tick has
+         * been dealt, so that no state goes on after its target has been
+         * destroyed.
+         */
+        void  advanceState();
 
         bool  isMoving() const;
+        bool  hasMoved() const; ///< True if the entity moved in the last tick. Safe to ask while it updates.
         bool  isDestroyed() const;
 
+        EntityStore::Handle getHandle() const; ///< Where the EntityStore keeps the entity.
+
+        /**
+         * \brief Where the broad phase of collission detection keeps the entity.
+         *
+         * Set by the broad phase when the entity is inserted into it, so
+         * that it is found without a search. -1 if it is in none.
+         */
+        int   getCollissionHandle() const;
+        void  setCollissionHandle(int handle);
+
     private:
         void updateOrigin();
+        void goTo(sf::Vector2f target, Pathfinder::SearchTreePtr searchTree, bool isAppending);
 
+        bool canAttack(const EntityNode* target) const;
         void attack(EntityNode* target, bool isAppending = false);
+        void attack(EntityNode* target, Pathfinder::FlowFieldPtr flowField, bool isAppending);
         void harvest(EntityNode* target, bool isAppending = false);
         void assist(EntityNode* target, bool isAppending = false);
         void heal(EntityNode* target, bool isAppending = false);
 
 
     private:
-        Attributes      mAttributes;
+        static const unsigned int FLOW_FIELD_GROUP_SIZE = 16; ///< Smallest number of attackers that share a flow field.
+
+        EntityStore&        mStore;
+        EntityStore::Handle mHandle;
 
         sf::Sprite      mSprite;
 
@@ -103,6 +158,7 @@ class EntityNode : public SceneNode
 
         EntitiesManager& mEntitiesManager;
         StateQueue      mStateQueue;
+        int             mCollissionHandle;
 };
 
 #endif // ANTGAME_ENTITYNODE_HPP
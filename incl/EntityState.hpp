@@ -26,6 +26,7 @@
 class EntityNode;
 class EntitiesManager;
 #include "Pathfinder.hpp"
+#include "PathRequestQueue.hpp"
 
 #include "SFML/Graphics/RenderTarget.hpp"
 
@@ -33,6 +34,7 @@ class EntityState
 {
     public:
         EntityState(EntityNode& entity, EntitiesManager& entitiesManger);
+        virtual ~EntityState();
 
         virtual void update();
         virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const;
@@ -52,16 +54,57 @@ class EntityStateMove : public EntityState
     public:
         EntityStateMove(EntityNode& entity, EntitiesManager& entitiesManger, sf::Vector2f target);
 
+        /**
+         * \brief Move along a search tree shared by a group.
+         *
+         * The route is read from the tree when the state is initialized
+         * instead of being requested from the path queue.
+         */
+        EntityStateMove(EntityNode& entity, EntitiesManager& entitiesManger, sf::Vector2f target, Pathfinder::SearchTreePtr searchTree);
+
+        /**
+         * \brief Move by steering along a flow field shared by a large group.
+         *
+         * No path is searched for unless the entity stands where the
+         * field cannot lead it, for example right by the terrain.
+         */
+        EntityStateMove(EntityNode& entity, EntitiesManager& entitiesManger, sf::Vector2f target, Pathfinder::FlowFieldPtr flowField);
+        virtual ~EntityStateMove();
+
         virtual void update();
         virtual bool isDone() const;
         virtual void initialize();
 
         virtual bool isMoving() const;
         void setTarget(sf::Vector2f target);
+        bool isWaitingForPath() const;
+
+    protected:
+        bool isFollowingFlowField() const;
+
+        /**
+         * \brief Follow a moving target.
+         *
+         * Unlike setTarget(), the path is found right away, by repairing
+         * the search of the previous call rather than searching again.
+         */
+        void chase(sf::Vector2f target);
+
+    private:
+        void cancelPathRequest();
+        void steer(); ///< Take a step along the flow field.
+
+    private:
+        static const unsigned int REFINE_AHEAD = 2; ///< Waypoints left when more of a long path is refined.
 
     private:
         std::list<Pathfinder::Waypoint>    mWaypoints;
         sf::Vector2f                       mTarget;
+        unsigned int                       mPathRequest; ///< Ticket from EntitiesManager::requestPath(), 0 if no path is being waited for.
+        Pathfinder::SearchTreePtr          mSearchTree; ///< nullptr unless moving with a group.
+        Pathfinder::AbstractPathPtr        mRemainder; ///< Part of a long path not turned into waypoints yet. nullptr if there is none.
+        Pathfinder::ChasePtr               mChase; ///< nullptr until chase() is called.
+        Pathfinder::FlowFieldPtr           mFlowField; ///< nullptr unless steering along a flow field.
 };
 
 
@@ -69,6 +112,7 @@ class EntityStateAttack : public EntityStateMove
 {
     public:
         EntityStateAttack(EntityNode& entity, EntitiesManager& entitiesManger, EntityNode* target);
+        EntityStateAttack(EntityNode& entity, EntitiesManager& entitiesManger, EntityNode* target, Pathfinder::FlowFieldPtr flowField); ///< Closes in on target along flowField.
 
         virtual void update();
         virtual bool isDone() const;
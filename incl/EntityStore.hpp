@@ -0,0 +1,158 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_ENTITYSTORE_HPP
+#define ANTGAME_ENTITYSTORE_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <vector>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/Vector2.hpp"
+#include "SFML/Graphics/Rect.hpp"
+////////////////////////////////////////////////
+
+class EntityNode;
+
+/**
+ * \brief The simulated state of every entity, one array per component.
+ *
+ * Positions, velocities, bounds, attributes, teams and categories are
+ * kept in dense arrays, so that the systems run over all entities, like
+ * moving them and dealing damage, walk memory in order rather than
+ * chase nodes through the scene graph. EntityNode reads and writes its
+ * own state here.
+ *
+ * Erasing moves the last entity into the gap, so the arrays stay
+ * dense. Handles are therefore looked up in a table, and stay the same
+ * for as long as the entity is in the store.
+ *
+ * While entities update, each one only writes its own velocity and
+ * strikes, and everything else is only read. The systems then apply
+ * them, in ranges that may run in parallel where noted.
+ */
+class EntityStore
+{
+    public:
+        typedef unsigned int Handle;
+
+        struct Attributes
+        {
+            Attributes(int baseHp, float baseMovementSpeed, int attackDamage, float attackRange);
+
+            int         baseHp;
+            int         hp;
+
+            float       baseMovementSpeed;
+            float       movementSpeed;
+
+            int         baseAttackDamage;
+            int         attackDamage;
+
+            float       baseAttackRange;
+            float       attackRange;
+        };
+
+    public:
+        Handle  insert(EntityNode* entity, sf::Vector2f position, const Attributes& attributes, unsigned int teamId, unsigned int category);
+        void    erase(Handle handle);
+
+        sf::Vector2f        getPosition(Handle handle) const;
+        void                setPosition(Handle handle, sf::Vector2f position);
+        sf::Vector2f        getVelocity(Handle handle) const;
+        void                setVelocity(Handle handle, sf::Vector2f velocity); ///< Moved at in the next call to move().
+
+        /**
+         * \brief Get the bounding rect of an entity.
+         *
+         * Entities are neither rotated nor scaled, so it is their bounds
+         * offset by their position.
+         */
+        sf::FloatRect       getBoundingRect(Handle handle) const;
+        void                setBounds(Handle handle, sf::FloatRect bounds); ///< Relative to the position.
+
+        bool                hasMoved(Handle handle) const; ///< True if the entity had a velocity in the last call to move().
+
+        const Attributes&   getAttributes(Handle handle) const;
+        void                damage(Handle handle, int points); ///< Dealt in the next call to dealDamage().
+        void                destroy(Handle handle);
+
+        /**
+         * \brief Have an entity deal damage to another.
+         *
+         * Kept with the attacker, so that entities updating in parallel
+         * may strike the same target. Dealt in the next call to
+         * dealDamage(). An entity strikes at most once per tick.
+         */
+        void                strike(Handle attacker, Handle target, int points);
+
+        unsigned int        getTeamId(Handle handle) const;
+        unsigned int        getCategory(Handle handle) const;
+
+        /**
+         * \brief Move every entity at its velocity for dt seconds.
+         *
+         * Velocities are then reset, so an entity only moves in a tick
+         * it is given a velocity in.
+         */
+        void                move(float dt);
+        void                move(unsigned int first, unsigned int end, float dt); ///< Move the entities from index first to end - 1. Ranges may be moved in parallel.
+
+        /**
+         * \brief Deal the damage taken since the last call.
+         *
+         * Damage is gathered over a tick and dealt at once, so that
+         * units attacking each other hit just as hard no matter which
+         * of them is updated first. May run in parallel with move().
+         */
+        void                dealDamage();
+
+        unsigned int        getEntityCount() const;
+        unsigned int        getHandleCount() const; ///< Every handle in use is below it.
+        EntityNode*         getEntity(unsigned int index) const; ///< Entities are in no particular order.
+
+    private:
+        std::vector<int>            mIndices; ///< Index into the arrays below of each handle, -1 if unused.
+        std::vector<Handle>         mFreeHandles;
+
+        ////////////////////////////////////////////////
+        // Entities, densely packed.
+        std::vector<Handle>         mHandles;
+        std::vector<EntityNode*>    mEntities;
+        std::vector<sf::Vector2f>   mPositions;
+        std::vector<sf::Vector2f>   mVelocities;
+        std::vector<sf::FloatRect>  mBounds;
+        std::vector<Attributes>     mAttributes;
+        std::vector<int>            mDamages; ///< Taken this tick.
+        std::vector<int>            mStrikeTargets; ///< Handle of the entity struck this tick, -1 if none.
+        std::vector<int>            mStrikeDamages;
+        std::vector<char>           mHasMoved;
+        std::vector<unsigned int>   mTeamIds;
+        std::vector<unsigned int>   mCategories;
+        ////////////////////////////////////////////////
+};
+
+#endif //ANTGAME_ENTITYSTORE_HPP
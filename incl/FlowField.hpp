@@ -0,0 +1,113 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_FLOWFIELD_HPP
+#define ANTGAME_FLOWFIELD_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <vector>
+#include <list>
+#include <memory>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/Vector2.hpp"
+#include "SFML/Graphics/Rect.hpp"
+////////////////////////////////////////////////
+
+class TerrainCollissionNode;
+
+/**
+ * \brief Direction to one target from every cell of a grid over the map.
+ *
+ * Meant for a large number of units ordered onto the same target. The
+ * map bounds are cut into square cells, and the cells that a unit of
+ * the field's diameter does not fit in are blocked. The distance to the
+ * target is then solved for every other cell in a single fast marching
+ * sweep, an eikonal solver that, unlike Dijkstra on the grid, measures
+ * distances in any direction rather than along 8 of them. Each unit
+ * steers by sampling the downhill direction of its cell instead of
+ * searching for a path of its own.
+ *
+ * Cell (x, y) is stored at index y * columns + x.
+ */
+class FlowField
+{
+    public:
+        static const float CELL_SIZE;
+
+        FlowField();
+
+        /**
+         * \brief Solve the field of target over bounds.
+         *
+         * version is that of the NavGraph of the same terrain, so the
+         * field can be told apart from one built before a change to it.
+         */
+        void    build(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, sf::FloatRect bounds, unsigned int version, sf::Vector2f target, float diameter, float cellSize = CELL_SIZE);
+
+        /**
+         * \brief Get the direction to head in from p.
+         *
+         * The directions of the cells around p are blended, so that the
+         * heading does not turn sharply when a unit crosses into a new
+         * cell. Returns false if p is outside the grid, in the terrain
+         * or anywhere else the target cannot be reached from.
+         */
+        bool    sample(sf::Vector2f p, sf::Vector2f& direction) const;
+
+        float   getDistance(sf::Vector2f p) const; ///< Distance left to the target from the cell of p. Infinite if it cannot be reached.
+
+        sf::Vector2f    getTarget() const;
+        float           getDiameter() const;
+        unsigned int    getVersion() const;
+        sf::Vector2i    getGridSize() const;
+        float           getCellSize() const;
+        int             getReachedCount() const; ///< Number of cells the target can be reached from.
+
+    private:
+        int     getCell(sf::Vector2f p) const; ///< -1 if p is outside the grid.
+        void    blockTerrain(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, float radius);
+        float   solveDistance(int x, int y) const; ///< Eikonal update of cell (x, y) from its settled neighbours.
+        void    computeDirection(int x, int y);
+
+    private:
+        static const int MAX_CELLS_PER_AXIS = 512;
+
+        std::vector<float>          mDistances;
+        std::vector<sf::Vector2f>   mDirections; ///< Unit vectors. Zero for the target cell and the cells that cannot reach it.
+        std::vector<bool>           mIsBlocked;
+        sf::Vector2f                mOrigin; ///< Top left corner of the grid.
+        sf::Vector2f                mTarget;
+        float                       mDiameter;
+        float                       mCellSize;
+        int                         mColumns;
+        int                         mRows;
+        int                         mTargetCell;
+        int                         mReachedCount;
+        unsigned int                mVersion;
+};
+
+#endif // ANTGAME_FLOWFIELD_HPP
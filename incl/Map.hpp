@@ -20,8 +20,8 @@
 ****************************************************************
 ****************************************************************/
 
-#ifndef ANTGAME_MAP_HPP
-#define ANTGAME_MAP_HPP
+#ifndef ANTGAME_MAP_HPP
+#define ANTGAME_MAP_HPP
 
 ////////////////////////////////////////////////
 // SFML - Simple and Fast Media Library
@@ -31,30 +31,71 @@
 ////////////////////////////////////////////////
 
 #include "TerrainCollissionNode.hpp"
+#include "NavGraph.hpp"
+#include "EdgeIndex.hpp"
+#include "MapLoader.hpp"
+#include "BroadPhase.hpp"
 
 class Map : public sf::Drawable
 {
     public:
         typedef std::unique_ptr<TerrainCollissionNode> NodePtr;
 
-        Map(const std::string& filePath);
-        Map(const std::string& filePath, sf::Vector2f size);
+        Map(const std::string& filePath, BroadPhase::Type broadPhase = BroadPhase::SpatialHashType);
+        Map(const std::string& filePath, sf::Vector2f size, BroadPhase::Type broadPhase = BroadPhase::SpatialHashType);
 
         void load(const std::string& filePath);
         sf::FloatRect getBounds() const;
 
         virtual void draw(sf::RenderTarget& target, sf::RenderStates states) const;
-        std::list<const TerrainCollissionNode::Point*> getVisiblePoints(sf::Vector2f p) const;
+        std::vector<int> getVisiblePoints(sf::Vector2f p) const; ///< Indices of the NavGraph vertices visible from p.
         const std::list<NodePtr>& getImpassableTerrain() const;
+        const NavGraph& getNavGraph() const;
+        const NavGraph& getNavGraph(int clearanceClass) const; ///< Subgraph of the edges units of clearanceClass fit.
+        const EdgeIndex& getEdgeIndex() const;
+        const MapLoader::Stats& getLoadStats() const; ///< Polygon and vertex counts, and the time it took to load them.
+        BroadPhase::Type getBroadPhase() const; ///< Broad phase of collission detection between the entities on the map.
+
+        /**
+         * \brief Add an obstacle, like a building, to the built map.
+         *
+         * Instead of building the NavGraph again, only the lines of sight
+         * crossing the obstacle's bounding rect are tested, and only the
+         * paths passing close to it get their pass widths recomputed.
+         * Only the clearance subgraphs that gained or lost an edge are
+         * extracted again.
+         */
+        TerrainCollissionNode* insertObstacle(NodePtr pObstacle);
+
+        /**
+         * \brief Remove an obstacle, repairing the NavGraph around it.
+         *
+         * Like insertObstacle(), only the lines of sight crossing the
+         * obstacle's bounding rect are tested again.
+         * Returns false if pObstacle is not part of the map.
+         */
+        bool removeObstacle(const TerrainCollissionNode* pObstacle);
 
     private:
         void buildMap();
+        void buildDebugPaths();
+        void numberPoints();
+        void buildClearanceGraphs();
+        void updateClearanceGraphs(const NavGraph& previous, const std::vector<int>& oldIndices); ///< Extract the subgraphs whose edges differ from previous again, and renumber the rest.
+        void restorePaths(); ///< Recreate the paths of the points from a NavGraph loaded from the cache.
+        void computePassWidths(sf::FloatRect area); ///< Recompute the pass widths of the paths that area can narrow.
 
     private:
         sf::Texture         mTexture;
         sf::RectangleShape  mDrawShape;
 
         std::list<NodePtr> mImpassableNodes;
+        NavGraph           mNavGraph;
+        std::vector<NavGraph> mClearanceGraphs; ///< One per clearance class.
+        std::string        mFilePath;
+        MapLoader::Stats   mLoadStats;
+        EdgeIndex          mEdgeIndex;
+        BroadPhase::Type   mBroadPhase;
 
 
         sf::VertexArray     mPaths; ///< Debug
@@ -0,0 +1,119 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_MAPLOADER_HPP
+#define ANTGAME_MAPLOADER_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/Vector2.hpp"
+#include "SFML/System/Time.hpp"
+#include "SFML/Graphics/Transform.hpp"
+////////////////////////////////////////////////
+
+namespace sf
+{
+    class Image;
+}
+
+/**
+ * \brief Extracts the impassable terrain polygons of a map.
+ *
+ * Polygons are either read from a sidecar polygon file, or traced from
+ * the map image. Tracing runs marching squares over the image tile by
+ * tile, links the contour segments as they are produced and simplifies
+ * each contour with Douglas-Peucker as soon as it closes. Only the
+ * contours still open across tile borders are kept in memory.
+ *
+ * Polygons are listed clockwise, in world coordinates.
+ */
+class MapLoader
+{
+    public:
+        typedef std::vector<sf::Vector2f> Polygon;
+
+        struct Stats
+        {
+            unsigned int    polygonCount;
+            unsigned int    vertexCount;
+            sf::Time        loadTime;
+        };
+
+        /**
+         * \param pixelToWorld Transform from image pixels to world coordinates.
+         */
+        MapLoader(const sf::Transform& pixelToWorld);
+
+        /**
+         * \brief Read polygons from a text file.
+         *
+         * One polygon per line, as whitespace separated x y pairs in
+         * world coordinates. Empty lines and lines starting with '#'
+         * are skipped.
+         *
+         * \return False if the file could not be opened or is malformed.
+         */
+        bool    loadPolygonFile(const std::string& filePath);
+
+        /**
+         * \brief Trace polygons around the impassable pixels of image.
+         *
+         * A pixel is impassable if it is opaque and dark, see
+         * IMPASSABLE_LUMINANCE.
+         */
+        void    traceImage(const sf::Image& image);
+
+        const std::vector<Polygon>& getPolygons() const;
+        const Stats&                getStats() const;
+
+    private:
+        typedef std::deque<sf::Vector2i> Chain; ///< Contour points, at twice the sample resolution.
+
+        void    addSegment(sf::Vector2i from, sf::Vector2i to);
+        void    closeChain(const Chain& chain);
+        void    addPolygon(const Polygon& polygon);
+
+    private:
+        static const unsigned int   TILE_SIZE = 256;
+        static const unsigned int   IMPASSABLE_LUMINANCE = 64; ///< Pixels darker than this are impassable.
+        static const float          SIMPLIFY_TOLERANCE; ///< In pixels.
+
+        sf::Transform                               mPixelToWorld;
+        std::vector<Polygon>                        mPolygons;
+        Stats                                       mStats;
+
+        std::unordered_map<int, Chain>              mChains; ///< Contours not yet closed.
+        std::unordered_map<long long, int>          mChainStarts; ///< Chain starting at a point.
+        std::unordered_map<long long, int>          mChainEnds; ///< Chain ending at a point.
+        int                                         mNextChainId;
+};
+
+#endif // ANTGAME_MAPLOADER_HPP
@@ -0,0 +1,66 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_MAPPEDFILE_HPP
+#define ANTGAME_MAPPEDFILE_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <string>
+#include <cstddef>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/NonCopyable.hpp"
+////////////////////////////////////////////////
+
+/**
+ * \brief Read only memory mapping of a whole file.
+ *
+ * Wraps mmap on POSIX systems and file mappings on Windows.
+ */
+class MappedFile : sf::NonCopyable
+{
+    public:
+        MappedFile();
+        ~MappedFile();
+
+        bool        open(const std::string& filePath);
+        void        close();
+
+        bool        isOpen() const;
+        const char* getData() const;
+        std::size_t getSize() const;
+
+    private:
+        const char* mData;
+        std::size_t mSize;
+
+#ifdef _WIN32
+        void*       mFile;
+        void*       mMapping;
+#endif
+};
+
+#endif // ANTGAME_MAPPEDFILE_HPP
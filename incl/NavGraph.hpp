@@ -0,0 +1,150 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_NAVGRAPH_HPP
+#define ANTGAME_NAVGRAPH_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <vector>
+#include <list>
+#include <memory>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/Vector2.hpp"
+////////////////////////////////////////////////
+
+class TerrainCollissionNode;
+
+/**
+ * \brief Compiled visibility graph of a map.
+ *
+ * The points and paths of all TerrainCollissionNodes are flattened
+ * into contiguous arrays. The edges leaving vertex i are stored in
+ * [mEdgeOffsets[i], mEdgeOffsets[i + 1]) of mEdges, so expanding a
+ * vertex reads a single block of memory.
+ */
+class NavGraph
+{
+    public:
+        struct Vertex
+        {
+            sf::Vector2f    pos;
+            sf::Vector2f    bisector; ///< Unit vector of the (angle's) bisector, pointing outwards.
+        };
+
+        struct Edge
+        {
+            int             to; ///< Index of the destination vertex.
+            int             reverse; ///< Index of the edge going the opposite way. -1 if there is none.
+            float           length;
+            sf::Vector2f    direction;
+            float           passWidth;
+            bool            isEdge; ///< True if the edge runs along the terrain.
+            unsigned short  clearanceMask; ///< Bit i is set if units of clearance class i fit the edge.
+        };
+
+        /**
+         * \brief Size classes of units.
+         *
+         * Class i holds the diameters up to getClassDiameter(i). Each
+         * class is sqrt(2) times wider than the one before, and the
+         * widest is wider than any pass, so a unit is never treated as
+         * more than 41% larger than it is.
+         */
+        static const int CLEARANCE_CLASS_COUNT = 16;
+
+        static int      getClearanceClass(float diameter); ///< Smallest class that diameter fits in.
+        static float    getClassDiameter(int clearanceClass);
+
+        NavGraph();
+
+        /**
+         * \brief Flatten the points and paths of nodes.
+         *
+         * Vertex indices are taken from TerrainCollissionNode::Point::index,
+         * which must be numbered from 0 to the total number of points.
+         */
+        void    compile(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes);
+        void    clear();
+
+        /**
+         * \brief Replace the graph with already compiled arrays.
+         *
+         * Used when loading a cached graph. edgeOffsets must have one
+         * more element than vertices.
+         */
+        void    assign(std::vector<Vertex> vertices, std::vector<int> edgeOffsets, std::vector<Edge> edges);
+
+        /**
+         * \brief Replace the graph with the edges of graph that fit clearanceClass.
+         *
+         * Searching the subgraph of a class never has to skip an edge.
+         * Vertices keep their indices, and the version is copied from
+         * graph, so the two can be used interchangeably.
+         */
+        void    extract(const NavGraph& graph, int clearanceClass);
+
+        /**
+         * \brief Follow graph, which this was extracted from, after its vertices were renumbered.
+         *
+         * Vertex i of graph was vertex oldIndices[i], or is new if that is
+         * -1. Only for when none of the edges of this subgraph changed,
+         * so vertices that were dropped have no edges here, and new ones
+         * get none. Cheaper than extracting the subgraph again.
+         */
+        void    renumber(const NavGraph& graph, const std::vector<int>& oldIndices);
+
+        int             getVertexCount() const;
+        int             getEdgeCount() const;
+        const Vertex&   getVertex(int index) const;
+        const Edge*     edgesBegin(int vertex) const;
+        const Edge*     edgesEnd(int vertex) const;
+        const Edge&     getEdge(int index) const;
+
+        /**
+         * \brief Changes every time the graph is replaced.
+         *
+         * Anything holding on to vertex or edge indices, like a search
+         * tree, is stale once the version differs.
+         */
+        unsigned int    getVersion() const;
+
+        const std::vector<Vertex>&  getVertices() const;
+        const std::vector<int>&     getEdgeOffsets() const;
+        const std::vector<Edge>&    getEdges() const;
+
+    private:
+        static unsigned short   getClearanceMask(const Edge& edge);
+        void                    linkReverseEdges();
+
+    private:
+        std::vector<Vertex> mVertices;
+        std::vector<int>    mEdgeOffsets; ///< Has one more element than mVertices.
+        std::vector<Edge>   mEdges;
+        unsigned int        mVersion;
+};
+
+#endif // ANTGAME_NAVGRAPH_HPP
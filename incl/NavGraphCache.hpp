@@ -0,0 +1,122 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_NAVGRAPHCACHE_HPP
+#define ANTGAME_NAVGRAPHCACHE_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <string>
+#include <vector>
+#include <list>
+#include <memory>
+#include <cstdint>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/Graphics/Rect.hpp"
+////////////////////////////////////////////////
+
+class TerrainCollissionNode;
+class NavGraph;
+
+/**
+ * \brief Binary file holding a compiled NavGraph.
+ *
+ * Saves the visibility linking and pass width computations on load.
+ * The file stores a hash of the polygons it was built from, as well as
+ * their bounding boxes, and is rejected if either no longer matches.
+ *
+ * Layout, in native byte order:
+ *  Header
+ *  VertexRecord    [vertexCount]
+ *  int32_t         [vertexCount + 1] edge offsets
+ *  EdgeRecord      [edgeCount]
+ *  BoundsRecord    [nodeCount]
+ */
+class NavGraphCache
+{
+    public:
+        /**
+         * \brief Format version.
+         *
+         * Bump when the layout changes or when the graph built from the
+         * same polygons would change, so that old files are rebuilt.
+         */
+        static const uint32_t VERSION = 1;
+
+        NavGraphCache(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes);
+
+        bool        load(const std::string& filePath, NavGraph& navGraph) const;
+        bool        save(const std::string& filePath, const NavGraph& navGraph) const;
+
+        uint64_t    getHash() const;
+
+    private:
+        struct Header
+        {
+            char        magic[4];
+            uint32_t    version;
+            uint64_t    hash;
+            uint32_t    vertexCount;
+            uint32_t    edgeCount;
+            uint32_t    nodeCount;
+            uint32_t    padding;
+        };
+
+        struct VertexRecord
+        {
+            float       x;
+            float       y;
+            float       bisectorX;
+            float       bisectorY;
+        };
+
+        struct EdgeRecord
+        {
+            int32_t     to;
+            int32_t     reverse;
+            float       length;
+            float       directionX;
+            float       directionY;
+            float       passWidth;
+            uint32_t    isEdge;
+        };
+
+        struct BoundsRecord
+        {
+            float       left;
+            float       top;
+            float       width;
+            float       height;
+        };
+
+        static std::size_t getFileSize(const Header& header);
+
+    private:
+        uint64_t                    mHash; ///< FNV-1a of the polygon points.
+        std::vector<sf::FloatRect>  mBounds;
+};
+
+#endif // ANTGAME_NAVGRAPHCACHE_HPP
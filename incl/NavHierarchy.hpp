@@ -0,0 +1,137 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_NAVHIERARCHY_HPP
+#define ANTGAME_NAVHIERARCHY_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <vector>
+#include <unordered_map>
+#include <utility>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/Vector2.hpp"
+////////////////////////////////////////////////
+
+class NavGraph;
+
+/**
+ * \brief Two level abstraction of a NavGraph for long searches.
+ *
+ * The map is cut into square clusters. A vertex is a portal if an edge
+ * joins it to a vertex of another cluster. Portals are linked by those
+ * edges and by the cost of the shortest route between each two portals
+ * of a cluster that stays inside it. A search over the portals then
+ * crosses a cluster in a single step, and the routes through the
+ * clusters are only found again once they are needed.
+ *
+ * The links of portal i are stored in [mLinkOffsets[i], mLinkOffsets[i + 1])
+ * of mLinks, and the vertices of cluster i in
+ * [mClusterOffsets[i], mClusterOffsets[i + 1]) of mClusterVertices.
+ */
+class NavHierarchy
+{
+    public:
+        struct Link
+        {
+            int     to; ///< Index of the destination portal.
+            float   cost;
+            bool    isInterCluster; ///< True if the link is a NavGraph edge. Otherwise it runs through a cluster and has to be refined.
+        };
+
+        /**
+         * \brief Search state of a vertex reached by searchClusters().
+         */
+        struct Step
+        {
+            float   distance; ///< Distance from (or to, when searching backwards) the nearest seed.
+            int     next; ///< Neighbouring vertex on the way to that seed. -1 for the seeds themselves.
+            bool    isClosed;
+        };
+
+        typedef std::unordered_map<int, Step> ClusterSearch;
+        typedef std::vector<std::pair<int, float>> Seeds; ///< Vertices to search from, with their initial distances.
+
+        static const float CLUSTER_SIZE;
+
+        NavHierarchy();
+
+        void    build(const NavGraph& graph, float clusterSize = CLUSTER_SIZE);
+
+        int     getClusterCount() const;
+        int     getCluster(int vertex) const;
+        void    getClusters(sf::Vector2f pos, int radius, std::vector<int>& clusters) const; ///< Clusters at most radius clusters away from the one pos is in.
+        const int*  verticesBegin(int cluster) const;
+        const int*  verticesEnd(int cluster) const;
+
+        int     getPortalCount() const;
+        int     getPortal(int vertex) const; ///< -1 if the vertex is not a portal.
+        int     getPortalVertex(int portal) const;
+        const Link* linksBegin(int portal) const;
+        const Link* linksEnd(int portal) const;
+
+        /**
+         * \brief Version of the NavGraph the hierarchy was built from.
+         */
+        unsigned int getVersion() const;
+
+        /**
+         * \brief Dijkstra from several vertices at once, without leaving their clusters.
+         *
+         * Only edges between two vertices of the same cluster are
+         * followed. If isBackwards, edges are walked against their
+         * direction, so the distances are those left to the seeds.
+         */
+        void    searchClusters(const NavGraph& graph, const Seeds& seeds, bool isBackwards, ClusterSearch& search) const;
+
+        /**
+         * \brief Route between two vertices of a cluster that stays inside it.
+         *
+         * The vertices between from and to are stored in corners. Returns
+         * false if there is no such route.
+         */
+        bool    findRoute(const NavGraph& graph, int from, int to, std::vector<int>& corners) const;
+
+    private:
+        sf::Vector2i    getClusterCoords(sf::Vector2f pos) const; ///< Clamped to the grid.
+        void            linkPortal(const NavGraph& graph, int portal);
+
+    private:
+        std::vector<int>    mVertexClusters;
+        std::vector<int>    mClusterOffsets; ///< Has one more element than there are clusters.
+        std::vector<int>    mClusterVertices;
+        std::vector<int>    mVertexPortals;
+        std::vector<int>    mPortalVertices;
+        std::vector<int>    mLinkOffsets; ///< Has one more element than mPortalVertices.
+        std::vector<Link>   mLinks;
+        sf::Vector2f        mOrigin; ///< Top left corner of the grid.
+        float               mClusterSize;
+        int                 mColumns;
+        int                 mRows;
+        unsigned int        mVersion;
+};
+
+#endif // ANTGAME_NAVHIERARCHY_HPP
@@ -0,0 +1,133 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_PATHCACHE_HPP
+#define ANTGAME_PATHCACHE_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <list>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/NonCopyable.hpp"
+#include "SFML/System/Vector2.hpp"
+////////////////////////////////////////////////
+
+/**
+ * \brief Least recently used cache of routes through the NavGraph.
+ *
+ * Routes are keyed by the regions their ends lie in and the clearance
+ * class of the unit, so ants going back and forth between an anthill
+ * and a resource share one search. Regions are cells of REGION_SIZE,
+ * small enough that routes between them rarely differ. Users must check
+ * that the ends of a cached route can still be seen from their positions.
+ *
+ * The cache empties itself when it is used with a new NavGraph version.
+ * It may be used from several threads.
+ */
+class PathCache : private sf::NonCopyable
+{
+    public:
+        struct Key
+        {
+            bool operator==(const Key& other) const;
+            sf::Vector2i    start; ///< Region of the start position.
+            sf::Vector2i    goal; ///< Region of the destination.
+            int             clearanceClass;
+        };
+
+        /**
+         * \brief Corners of a route, from the first vertex to the last.
+         */
+        struct Route
+        {
+            Route();
+            int                 first; ///< First vertex, seen from the start position.
+            std::vector<int>    edges; ///< Edges of the clearance class's NavGraph taken from first on.
+        };
+
+        struct Metrics
+        {
+            Metrics();
+            unsigned int    hits;
+            unsigned int    misses;
+            unsigned int    size; ///< Routes currently stored.
+            unsigned int    capacity;
+            float           hitRate; ///< Share of the lookups that were hits, 0 if there were none.
+        };
+
+        explicit PathCache(unsigned int capacity);
+
+        static const float REGION_SIZE;
+
+        static sf::Vector2i getRegion(sf::Vector2f pos);
+
+        /**
+         * \brief Look up the route for key.
+         *
+         * Returns false if there is none, or if it was stored for an older
+         * version of the NavGraph.
+         */
+        bool    get(const Key& key, unsigned int version, Route& route);
+
+        /**
+         * \brief Look up the route for key, leaving the order of the routes as it is.
+         *
+         * For lookups from several threads at once, so that which routes
+         * get evicted does not depend on which thread comes first. Call
+         * touch() later, in an order of your own, for the hits.
+         */
+        bool    find(const Key& key, unsigned int version, Route& route);
+        void    touch(const Key& key, unsigned int version); ///< Make the route for key the most recently used, if it is still there.
+        void    insert(const Key& key, unsigned int version, const Route& route);
+        void    clear();
+
+        Metrics getMetrics() const;
+
+    private:
+        struct KeyHash
+        {
+            size_t operator()(const Key& key) const;
+        };
+
+        typedef std::list<std::pair<Key, Route>> Entries;
+
+        void    setVersion(unsigned int version);
+
+    private:
+        const unsigned int  mCapacity;
+
+        mutable std::mutex  mMutex;
+        Entries             mEntries; ///< Most recently used first.
+        std::unordered_map<Key, Entries::iterator, KeyHash> mLookup;
+        unsigned int        mVersion;
+        unsigned int        mHits;
+        unsigned int        mMisses;
+};
+
+#endif // ANTGAME_PATHCACHE_HPP
@@ -0,0 +1,147 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_PATHREQUESTQUEUE_HPP
+#define ANTGAME_PATHREQUESTQUEUE_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <list>
+#include <deque>
+#include <vector>
+#include <map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/NonCopyable.hpp"
+#include "SFML/System/Clock.hpp"
+////////////////////////////////////////////////
+
+#include "Pathfinder.hpp"
+
+/**
+ * \brief Solves path requests on worker threads.
+ *
+ * Requests can be enqueued and cancelled from any thread, and get a
+ * handle back. Each tick, update() has the workers solve the requests
+ * in order until the vertices they expanded reach the expansion budget,
+ * and hands the paths to the requesters' callbacks. The rest wait for
+ * the next tick.
+ *
+ * Which requests are solved in a tick, and the paths found, only depend
+ * on the order of the requests, never on the number of workers or how
+ * fast they are. Requests beyond the budget that a worker already got
+ * to are solved again next tick, and the path cache is only changed
+ * once the workers are done, in request order.
+ *
+ * Long paths come with the part that has not been refined yet, which
+ * is nullptr for the others.
+ */
+class PathRequestQueue : private sf::NonCopyable
+{
+    public:
+        typedef unsigned int Handle; ///< 0 is never a valid handle.
+        typedef std::function<void(std::list<Pathfinder::Waypoint>& path, Pathfinder::AbstractPathPtr remainder)> Callback;
+
+        struct Metrics
+        {
+            Metrics();
+            unsigned int    queueDepth; ///< Requests waiting for the next tick.
+            unsigned int    expansions; ///< Vertices expanded for the requests solved in the last tick.
+            float           medianLatency; ///< Seconds between enqueueing and solving a request.
+            float           p99Latency;
+        };
+
+        PathRequestQueue(const Pathfinder& pathfinder, unsigned int expansionBudget, unsigned int workerCount = 0);
+        ~PathRequestQueue();
+
+        Handle  request(float diameter, sf::Vector2f pos, sf::Vector2f destination, Callback callback);
+        void    cancel(Handle handle);
+        bool    isPending(Handle handle) const;
+
+        /**
+         * \brief Solve the requests of this tick and deliver their paths.
+         *
+         * Must be called once per tick from the simulation thread, which
+         * waits for the workers. Callbacks are called in request order.
+         * The workers only read the map while in here, so it may be
+         * changed between calls.
+         */
+        void    update();
+
+        Metrics getMetrics() const;
+
+    private:
+        struct Request
+        {
+            Handle          handle;
+            float           diameter;
+            sf::Vector2f    pos;
+            sf::Vector2f    destination;
+            sf::Time        enqueueTime;
+        };
+
+        struct Result
+        {
+            Result();
+            bool                            isSolved;
+            unsigned int                    expansions;
+            std::list<Pathfinder::Waypoint> path;
+            Pathfinder::AbstractPathPtr     remainder;
+            Pathfinder::CacheUse            cacheUse;
+        };
+
+        void    work();
+        void    recordLatency(sf::Time latency);
+
+    private:
+        static const unsigned int LATENCY_SAMPLES = 1024;
+
+        const Pathfinder&           mPathfinder;
+        const unsigned int          mExpansionBudget;
+
+        mutable std::mutex          mMutex; ///< Guards the handles, callbacks, requests, results and counters.
+        Handle                      mNextHandle;
+        std::map<Handle, Callback>  mCallbacks; ///< Not touched by the workers.
+        std::condition_variable     mCondition;
+        std::deque<Request>         mRequests; ///< In the order they were made.
+        std::vector<Result>         mResults; ///< Of the first requests, while update() runs.
+        unsigned int                mNextRequest; ///< Next request for a worker to pick up.
+        unsigned int                mInProgress;
+        unsigned int                mExpansions;
+        bool                        mIsSolving; ///< True while update() lets the workers pick up requests.
+        bool                        mIsStopping;
+
+        sf::Clock                   mClock;
+        std::vector<float>          mLatencies; ///< Ring buffer of the latest latencies, in seconds.
+        unsigned int                mLatencyIndex;
+
+        std::vector<std::thread>    mWorkers;
+};
+
+#endif // ANTGAME_PATHREQUESTQUEUE_HPP
@@ -26,6 +26,11 @@
 ////////////////////////////////////////////////
 // STD - C++ Standard Library
 #include <list>
+#include <vector>
+#include <memory>
+#include <deque>
+#include <queue>
+#include <mutex>
 ////////////////////////////////////////////////
 
 ////////////////////////////////////////////////
@@ -33,8 +38,11 @@
 #include "SFML/System/Vector2.hpp"
 ////////////////////////////////////////////////
 
-#include "TerrainCollissionNode.hpp"
+#include "NavGraph.hpp"
+#include "NavHierarchy.hpp"
+#include "FlowField.hpp"
 #include "Map.hpp"
+#include "PathCache.hpp"
 
 namespace sf
 {
@@ -44,44 +52,277 @@ namespace sf
 class Pathfinder
 {
     public:
-        Pathfinder(const Map& map);
+        explicit Pathfinder(const Map& map, unsigned int pathCacheSize = PATH_CACHE_SIZE);
 
         struct Waypoint
         {
             Waypoint(sf::Vector2f from, sf::Vector2f to);
-            Waypoint(const TerrainCollissionNode::Path* pPath);
             sf::Vector2f    destination;
             sf::Vector2f    direction;
             float           distance;
         };
 
+        /**
+         * \brief Shortest routes from every vertex to one destination.
+         *
+         * Lets a group of entities heading for the same destination share
+         * a single search. Each entity's route is then read by following
+         * the edges of the tree.
+         */
+        struct SearchTree
+        {
+            sf::Vector2f                        destination;
+            float                               diameter; ///< Largest diameter the routes fit.
+            std::vector<float>                  distances; ///< Distance left to the destination from each vertex.
+            std::vector<const NavGraph::Edge*>  edges; ///< Edge to take from each vertex. nullptr if the destination is visible or unreachable.
+            unsigned int                        version; ///< NavGraph version the tree was built from.
+        };
+
+        typedef std::shared_ptr<const SearchTree> SearchTreePtr;
+
+        /**
+         * \brief Rest of a long path, found through the NavHierarchy.
+         *
+         * Routes through clusters are only searched for once the path
+         * gets to them, a few corners at a time, by refinePath().
+         */
+        struct AbstractPath
+        {
+            sf::Vector2f        start; ///< Where the waypoints refined so far end.
+            bool                isStartCorner; ///< True if start is the NavGraph vertex the last refinement stopped at.
+            sf::Vector2f        destination;
+            float               diameter;
+            unsigned int        version; ///< NavGraph version the path was found in.
+            std::deque<int>     corners; ///< NavGraph vertices left, including the portals. Empty once the path is done.
+            std::deque<bool>    isRefined; ///< False if the route from corners[i] to corners[i + 1] has not been found yet.
+        };
+
+        typedef std::shared_ptr<AbstractPath> AbstractPathPtr;
+
+        /**
+         * \brief What finding a path would have changed in the path cache.
+         *
+         * Lets paths be found on several threads at once without the
+         * cache depending on which of them gets there first.
+         * applyCacheUse() makes the changes later, in an order of the
+         * caller's choosing.
+         */
+        struct CacheUse
+        {
+            CacheUse();
+            bool                isHit; ///< A cached route was used.
+            bool                isNew; ///< route was searched for, and belongs in the cache.
+            PathCache::Key      key;
+            unsigned int        version;
+            PathCache::Route    route;
+        };
+
+        /**
+         * \brief Search state kept between the paths of a chase.
+         *
+         * A D* Lite search from the target back to the chaser. When the
+         * target moves, only the costs of reaching it from the vertices
+         * it sees change, and only the vertices whose distances those
+         * change are searched again. The chaser moving is made up for
+         * by keyModifier instead of reordering the open set.
+         *
+         * Vertex i is node i. The target and the chaser come after the
+         * vertices, as nodes getGoal() and getStart().
+         */
+        struct Chase
+        {
+            struct Key
+            {
+                bool operator<(const Key& other) const;
+                bool operator==(const Key& other) const;
+                float   primary; ///< min(g, rhs) + h + km
+                float   secondary; ///< min(g, rhs)
+            };
+
+            typedef std::pair<Key, int> OpenNode;
+
+            explicit Chase(float diameter);
+
+            int getGoal() const;
+            int getStart() const;
+
+            float               diameter;
+            unsigned int        version; ///< NavGraph version the state was built from. 0 before the first search.
+            sf::Vector2f        start;
+            sf::Vector2f        destination;
+            float               keyModifier; ///< km, how far the start has moved since the search began.
+            std::vector<float>  distances; ///< g, distance to the target as of the last expansion of each node.
+            std::vector<float>  lookaheads; ///< rhs, distance to the target through the best successor.
+            std::vector<float>  startCosts; ///< Cost from the chaser to each vertex it is joined to. Negative if it is not.
+            std::vector<float>  goalCosts; ///< Cost from each vertex to the target, if joined to it. Negative if not.
+            std::vector<int>    startLinks; ///< Vertices joined to the chaser.
+            std::vector<int>    goalLinks; ///< Vertices joined to the target.
+            std::vector<Key>    keys; ///< Key each node is queued with.
+            std::vector<bool>   isQueued;
+            std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> openSet; ///< Entries whose key differs from keys are stale.
+        };
+
+        typedef std::shared_ptr<Chase> ChasePtr;
+
+        typedef std::shared_ptr<const FlowField> FlowFieldPtr;
+
         void draw(sf::RenderTarget& target) const;
-        std::list<Waypoint> getPath(float diameter, sf::Vector2f pos, sf::Vector2f destination);
+
+        /**
+         * \brief Find a path for a unit of diameter.
+         *
+         * Paths longer than the hierarchy distance are searched for
+         * through the NavHierarchy. If pRemainder is given, only the
+         * first corners of such a path are turned into waypoints and the
+         * rest is stored in it, to be refined later. Otherwise the whole
+         * path is returned.
+         *
+         * If pCacheUse is given, the path cache is only read, and what
+         * would have changed in it is stored in pCacheUse instead.
+         */
+        std::list<Waypoint> getPath(float diameter, sf::Vector2f pos, sf::Vector2f destination, unsigned int* pExpansions = nullptr, AbstractPathPtr* pRemainder = nullptr, CacheUse* pCacheUse = nullptr) const;
+        void                applyCacheUse(const CacheUse& cacheUse) const;
+
+        /**
+         * \brief Turn the next few corners of path into waypoints.
+         *
+         * The waypoints continue from where the previous ones ended. If
+         * the map has changed since the path was found, the rest of it
+         * is searched for from scratch instead.
+         */
+        std::list<Waypoint> refinePath(AbstractPath& path) const;
+
+        /**
+         * \brief Set how long a path must be to go through the NavHierarchy.
+         *
+         * Must not be called while paths are being searched for.
+         */
+        void                setHierarchyDistance(float distance);
+
+        SearchTreePtr       getSearchTree(float diameter, sf::Vector2f destination) const;
+
+        /**
+         * \brief Read a route from a search tree.
+         *
+         * destination may differ slightly from the tree's destination,
+         * for example to spread a group out in formation. It is only
+         * used if it is visible from where the route leaves the tree.
+         *
+         * If the map has changed since the tree was built, the path is
+         * searched for from scratch instead.
+         */
+        std::list<Waypoint> getPath(const SearchTree& tree, sf::Vector2f pos, sf::Vector2f destination) const;
+
+        /**
+         * \brief Find the path of a unit chasing a moving destination.
+         *
+         * If destination can be seen, the unit heads straight for it.
+         * Otherwise the search state of chase is repaired for the new
+         * ends, which is much cheaper than a new search as long as they
+         * only moved a little. After a long jump, or a change to the map,
+         * the state is searched again from scratch.
+         */
+        std::list<Waypoint> getPath(Chase& chase, sf::Vector2f pos, sf::Vector2f destination, unsigned int* pExpansions = nullptr) const;
+
+        /**
+         * \brief Get the flow field of destination for units of diameter.
+         *
+         * Fields are shared: as long as any unit still holds the field of
+         * a destination, asking for one within half a cell of it returns
+         * the same field. The field is built for the widest diameter of
+         * the clearance class, so that every unit of the class fits it.
+         */
+        FlowFieldPtr        getFlowField(float diameter, sf::Vector2f destination) const;
+
+        PathCache::Metrics  getPathCacheMetrics() const;
 
     private:
-        struct PathNode
+        /**
+         * \brief Search state of a vertex in the visibility graph.
+         *
+         * Stored in a vector indexed by NavGraph vertex.
+         */
+        struct SearchNode
         {
-            PathNode(float distanceTravelled, float distanceLeft, std::list<PathNode>::iterator iParent, const TerrainCollissionNode::Point* pPoint);
-            float f();
-            float distanceTravelled;
-            float distanceLeft;
-            std::list<PathNode>::iterator iParent;
-            const TerrainCollissionNode::Point* pPoint;
-            const TerrainCollissionNode::Path* pPath;
+            SearchNode();
+            float       distanceTravelled; ///< G, cost of the cheapest known route from the start position.
+            const NavGraph::Edge* pEdge; ///< Edge leading to this vertex on the cheapest known route. nullptr if entered from the start position.
+            int         parent; ///< Previous vertex on the cheapest known route. -1 if entered from the start position.
+            bool        isClosed;
         };
 
-        typedef const TerrainCollissionNode::Point* PointPtr;
-        typedef const TerrainCollissionNode::Path* PathPtr;
+        /**
+         * \brief Entry of the open set.
+         *
+         * Vertices may be pushed several times; stale entries are skipped
+         * when popped since their vertex has already been closed.
+         */
+        struct OpenNode
+        {
+            OpenNode(float f, int index);
+            bool operator>(const OpenNode& other) const;
+            float   f; ///< F = G + H
+            int     index;
+        };
 
-        float       getF(PathPtr pPath, sf::Vector2f target) const;
-        float       getF(sf::Vector2f start, sf::Vector2f p, sf::Vector2f target) const;
-        PointPtr    findSmallestF(sf::Vector2f pos, sf::Vector2f destination, std::list<PointPtr> points) const;
-        PathPtr     findSmallestF(float diameter, sf::Vector2f destination, std::list<TerrainCollissionNode::Path*> paths) const;
-        bool        lineIntersectsRect(sf::Vector2f p1, sf::Vector2f p2, sf::FloatRect rect) const;
+        bool        findRoute(const NavGraph& graph, sf::Vector2f pos, sf::Vector2f destination, PathCache::Route& route, unsigned int* pExpansions) const; ///< A* through graph. False if there is no route.
+        bool        cutCorners(const NavGraph& graph, PathCache::Route& route, sf::Vector2f pos, sf::Vector2f destination) const; ///< Fit a cached route to new ends. False if they cannot see it.
         bool        pathIsObstructed(sf::Vector2f from, sf::Vector2f to) const;
 
+        /**
+         * \brief Search for a route over the portals of the NavHierarchy.
+         *
+         * pos and destination are only joined to the vertices of the
+         * clusters around them. False if they see none of those, or if
+         * no route fits.
+         */
+        bool        findAbstractRoute(int clearanceClass, sf::Vector2f pos, sf::Vector2f destination, AbstractPath& path, unsigned int* pExpansions) const;
+        std::shared_ptr<const NavHierarchy> getHierarchy(int clearanceClass) const; ///< Built on first use, and again when the NavGraph changes.
+
+        /**
+         * \brief Vertices seen from p in the clusters around it.
+         *
+         * All the vertices seen from p if there are none around it.
+         */
+        std::vector<int>    getNearbyVisiblePoints(int clearanceClass, sf::Vector2f p) const;
+
+        void                resetChase(Chase& chase, const NavGraph& graph) const;
+        void                linkChase(Chase& chase, const NavGraph& graph, bool isStart, sf::Vector2f p) const; ///< Join the chaser or the target to the vertices p sees.
+        Chase::Key          getChaseKey(const Chase& chase, const NavGraph& graph, int node) const;
+        void                updateChaseNode(Chase& chase, const NavGraph& graph, int node) const; ///< Recompute the lookahead of node and queue it if it is inconsistent.
+        void                queueChaseNode(Chase& chase, const NavGraph& graph, int node) const;
+        void                updateChasePredecessor(Chase& chase, const NavGraph& graph, int predecessor, float cost, int node, float oldDistance) const;
+        void                updateChasePredecessors(Chase& chase, const NavGraph& graph, int node, float oldDistance) const; ///< Called when the distance of node has changed from oldDistance.
+        unsigned int        searchChase(Chase& chase, const NavGraph& graph) const; ///< Returns the number of expansions.
+
+        /**
+         * \brief Turn a route through corners into waypoints.
+         *
+         * Each corner is pushed out along its bisector by the unit's
+         * radius, so that the unit does not scrape the terrain, and
+         * waypoints that can be seen past are dropped.
+         *
+         * If pos or destination is itself a corner, like where a path is
+         * cut up when it is refined, they are kept on it.
+         */
+        std::list<Waypoint> smoothPath(const NavGraph& graph, const std::vector<int>& corners, float diameter, sf::Vector2f pos, sf::Vector2f destination, bool isPosCorner = false, bool isDestinationCorner = false) const;
+
     private:
-        const Map& mMap;
+        static const unsigned int PATH_CACHE_SIZE = 512;
+        static const unsigned int REFINED_CORNERS = 8; ///< Corners refined at a time.
+        static const float HIERARCHY_DISTANCE;
+        static const int CLUSTER_RADIUS = 1; ///< Clusters away from pos and destination that are joined to them.
+        static const float CHASE_REPAIR_DISTANCE; ///< Further than this, a chase is searched again rather than repaired.
+
+        const Map&          mMap;
+        mutable PathCache   mPathCache;
+        float               mHierarchyDistance;
+
+        mutable std::mutex  mHierarchyMutex;
+        mutable std::vector<std::shared_ptr<const NavHierarchy>> mHierarchies; ///< One per clearance class.
+
+        mutable std::mutex  mFlowFieldMutex;
+        mutable std::vector<std::weak_ptr<const FlowField>> mFlowFields; ///< Expired fields are dropped the next time a field is built.
 };
 
 #endif // ANTGAME_PATHFINDER_HPP
@@ -20,87 +20,120 @@
 ****************************************************************
 ****************************************************************/
 
-#ifndef ANTGAME_QUADTREE_HPP
-#define ANTGAME_QUADTREE_HPP
 
-#include <EntityNode.hpp>
-
-////////////////////////////////////////////////
-// C++ Standard Library
-#include <list>
-#include <set>
-////////////////////////////////////////////////
-
-////////////////////////////////////////////////
-// SFML - Simple and Fast Media Library
-#include "SFML/System/NonCopyable.hpp"
-#include "SFML/Graphics.hpp"
-////////////////////////////////////////////////
-
-
-
-class Quadtree
+#ifndef ANTGAME_QUADTREE_HPP
+#define ANTGAME_QUADTREE_HPP
+
+#include "BroadPhase.hpp"
+
+/**
+ * \brief Loose quadtree over the bounding rects of entities.
+ *
+ * Each entity is stored in exactly one quad: the deepest one whose cell
+ * contains the centre of the entity's rect and whose children would be
+ * too small for it. Quads are loose, their bounds twice the size of
+ * their cells, so an entity always lies within the loose bounds of its
+ * quad and only moves to another quad when its centre crosses a cell.
+ *
+ * Quads live in a pool, with the four children of a quad in one
+ * contiguous block of it. The entities of a quad form an intrusive
+ * list of elements linked by index, and each entity holds the index of
+ * its element as its collission handle, so that it is found, moved and
+ * erased in constant time. Freed quad blocks and elements are reused.
+ *
+ * Every update also fits the bounds of each quad around the rects
+ * below it, which are much tighter than its loose bounds, so that the
+ * search for nearby entities skips most of the tree.
+ */
+class Quadtree : public BroadPhase
 {
     public:
-        struct Node
-        {
-            std::list<Quadtree*>    quads;
-            EntityNode*             entity;
-        };
-
-                Quadtree(sf::FloatRect bounds, std::list<Node>& nodes);
-
-        void    update();
-        void    insertEntity(EntityNode* entity);
-        void eraseEntity(EntityNode* entity);
+        explicit Quadtree(sf::FloatRect bounds);
+
+        /**
+         * \brief Move the entities that have moved to their new quads.
+         *
+         * Leaves holding too many entities are then split, and quads
+         * with too few entities below them merged.
+         */
+        virtual void    update();
+        virtual void    insertEntity(EntityNode* entity);
+        virtual void    eraseEntity(EntityNode* entity);
+        virtual void    removeWrecks();
+
+        /**
+         * \brief Get the pairs of entities whose rects touch.
+         *
+         * The rect of each entity is only tested against those of the
+         * entities in the quads whose bounds it touches. Since
+         * every entity is in one quad, each pair is only reported from
+         * the entity with the lower element index.
+         */
+        virtual void    getNearbyEntities(std::vector<Pair>& pairs) const;
+        virtual void    getEntitiesIn(sf::FloatRect area, std::vector<Proxy>& proxies) const;
+
+        sf::FloatRect   getBoundingRect() const;
+        virtual int     getEntityCount() const;
 
         /////////////////////////////////////////////////////////
         // For testing purposes
-        void    getQuadtree(std::list<const Quadtree*>& qtree) const;
+        virtual void    getCells(std::vector<sf::FloatRect>& cells) const; ///< Cell of every quad in use.
         /////////////////////////////////////////////////////////
 
-        std::set<std::pair<EntityNode*, EntityNode*>> getNearbyEntities();
-
-        sf::FloatRect getBoundingRect() const;
-        void    removeWrecks();
-
     private:
-                Quadtree(int level, sf::FloatRect bounds, std::list<Node>& nodes);
-
-        void            updateTree();
-        void            updateNodes(std::list<Node*>& updatedNodes);
-
-
-        void            insertNode(Node* node);
-
-        void            getBottomQuads(std::list<Quadtree*>& quads);
-
-        void            eraseNode(std::list<Node>::iterator iNode);
-        void            eraseQuadNode(Node* node);
-        void            clear();
-
-        void            split();
-        void            merge();
+        struct Quad
+        {
+            explicit Quad(sf::FloatRect cell = sf::FloatRect(), int level = 0); ///< A leaf holding nothing.
+
+            sf::FloatRect   cell; ///< Bounds of the quad before it is loosened.
+            int             level;
+            int             firstChild; ///< Index of the first of the four children. -1 for leaves. Links the free blocks.
+            int             firstElement; ///< -1 if the quad holds no entities.
+            int             elementCount;
+
+            ////////////////////////////////////////////////
+            // Bounds of the rects of the entities in the quad and its
+            // descendants, as of the last update. Empty if left > right.
+            float           left;
+            float           top;
+            float           right;
+            float           bottom;
+            ////////////////////////////////////////////////
+        };
 
-        bool            isOutOfBounds(EntityNode* node);
-        unsigned char   getPartialIndices(sf::FloatRect nodeBounds);
+        struct Element
+        {
+            EntityNode*     entity; ///< nullptr while the element is free.
+            sf::FloatRect   rect; ///< Bounding rect of the entity as of the last update.
+            int             quad;
+            int             prev; ///< -1 at the head of the list.
+            int             next; ///< -1 at the end of the list. Links the free elements.
+        };
 
+        int     findQuad(sf::FloatRect rect) const; ///< Deepest quad in use that rect belongs in.
+        int     getChild(int quad, sf::FloatRect rect) const; ///< Child of quad that rect belongs in. -1 if quad is a leaf or rect belongs in quad itself.
 
+        void    link(int element, int quad);
+        void    unlink(int element);
+        void    eraseElement(int element);
 
+        int     updateQuad(int quad); ///< Split or merge quad and its descendants. Returns the number of entities in them, quad included.
+        void    split(int quad);
+        void    merge(int quad); ///< Move the entities of the descendants of quad into it and free them.
+        void    fitBounds(int quad); ///< Fit the bounds of quad around its entities and the bounds of its children.
 
-        bool                hasChildren();
-        std::list<Node*>    getQuadNodes();
+        void    getNearbyEntities(int quad, int element, std::vector<Pair>& pairs) const; ///< Pair element with the entities of quad and of its descendants whose bounds it touches.
+        void    getEntitiesIn(int quad, sf::FloatRect area, std::vector<Proxy>& proxies) const; ///< Entities of quad and of its descendants touching area.
 
     private:
-        unsigned int MAX_NODES = 5;
-        unsigned int MAX_LEVELS = 10;
-        unsigned int mLevel;
-
-        std::vector<Quadtree>   mChildren;
-        std::list<Node*>        mQuadNodes;
-        sf::FloatRect           mBounds;
-
-        std::list<Node>&        mNodes;
+        static const int MAX_ELEMENTS = 5; ///< Entities a leaf holds before it is split.
+        static const int MAX_LEVELS = 10;
+
+        std::vector<Quad>       mQuads; ///< The root is mQuads[0].
+        std::vector<Element>    mElements;
+        int                     mFreeQuads; ///< First quad of the first free block. -1 if there is none.
+        int                     mFreeElements; ///< -1 if there is none.
+        int                     mEntityCount;
 };
 
 #endif //ANTGAME_QUADTREE_HPP
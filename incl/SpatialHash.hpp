@@ -0,0 +1,105 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_SPATIALHASH_HPP
+#define ANTGAME_SPATIALHASH_HPP
+
+#include "BroadPhase.hpp"
+
+/**
+ * \brief Uniform grid over the bounding rects of entities, hashed into buckets.
+ *
+ * Ants are all about the same size, so the grid is sized after them:
+ * a cell is twice the median width of the rects. Every rect is put into
+ * the bucket of each cell it touches, and pairs are only looked for
+ * among the entities sharing a bucket. Since cells are hashed, the grid
+ * is unbounded and takes memory only for the cells in use.
+ *
+ * Nothing is kept from one update to the next. The rects are read into
+ * one array per side and the entities counting sorted into buckets
+ * again, so there is no structure to split, merge or repair as they
+ * move.
+ */
+class SpatialHash : public BroadPhase
+{
+    public:
+        SpatialHash();
+
+        virtual void    update(); ///< Read the rect of every entity and sort them into buckets again.
+        virtual void    insertEntity(EntityNode* entity);
+        virtual void    eraseEntity(EntityNode* entity);
+        virtual void    removeWrecks();
+
+        /**
+         * \brief Get the pairs of entities whose rects touch.
+         *
+         * Entities inserted or erased since the last update are not
+         * paired until the next one. A pair sharing several buckets is
+         * only reported from the bucket of the cell holding the top left
+         * corner of the intersection of their rects.
+         */
+        virtual void    getNearbyEntities(std::vector<Pair>& pairs) const;
+        virtual void    getEntitiesIn(sf::FloatRect area, std::vector<Proxy>& proxies) const;
+
+        virtual int     getEntityCount() const;
+        float           getCellSize() const;
+
+        /////////////////////////////////////////////////////////
+        // For testing purposes
+        virtual void    getCells(std::vector<sf::FloatRect>& cells) const; ///< Cells holding entities.
+        /////////////////////////////////////////////////////////
+
+    private:
+        void    fitCellSize(); ///< Size cells after the median width of the rects.
+        void    sortIntoBuckets();
+        int     getCell(float coordinate) const;
+        int     getBucket(int x, int y) const;
+        void    eraseAt(int index);
+        void    clearBuckets();
+
+    private:
+        static const float  CELL_SIZE_FACTOR; ///< Size of a cell in median rect widths.
+        static const float  MIN_CELL_SIZE;
+
+        float                       mCellSize; ///< Cells are laid out from the world origin.
+
+        std::vector<EntityNode*>    mEntities; ///< Indexed by collission handle.
+
+        ////////////////////////////////////////////////
+        // Rects of the entities as of the last update.
+        std::vector<float>          mLefts;
+        std::vector<float>          mTops;
+        std::vector<float>          mRights;
+        std::vector<float>          mBottoms;
+        ////////////////////////////////////////////////
+
+        int                         mBucketMask; ///< Number of buckets - 1, which is a power of two.
+        std::vector<int>            mBucketStarts; ///< The entities in bucket i are mBucketEntities[mBucketStarts[i]] to mBucketEntities[mBucketStarts[i + 1]].
+        std::vector<int>            mBucketEntities; ///< Indices of the entities, sorted by bucket.
+        std::vector<int>            mEntryBuckets; ///< Bucket of each cell an entity touches, in entity order. Sorted into mBucketEntities.
+        std::vector<int>            mEntryEntities;
+        std::vector<int>            mCellLefts; ///< Cell of the left side of each rect, as of the last sort.
+        std::vector<int>            mCellTops;
+};
+
+#endif //ANTGAME_SPATIALHASH_HPP
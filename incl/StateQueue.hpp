@@ -39,7 +39,8 @@ class StateQueue
     public:
             StateQueue(StatePtr defaultState);
 
-        void update();
+        void update(); ///< Update the current state.
+        void advance(); ///< Move on to the next state if the current one is done.
         bool isEmpty() const;
 
         void pushState(StatePtr state);
@@ -0,0 +1,89 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_SWEEPANDPRUNE_HPP
+#define ANTGAME_SWEEPANDPRUNE_HPP
+
+#include "BroadPhase.hpp"
+
+/**
+ * \brief Sort and sweep over the bounding rects of entities along x.
+ *
+ * The rects are kept in an array sorted by their left sides. Ants only
+ * move a little from one tick to the next, so the order changes little,
+ * and an insertion sort puts it right again in close to linear time.
+ * Sweeping the sorted rects then only tests each one against those
+ * starting before it ends, and reports the pairs that also overlap
+ * along y.
+ */
+class SweepAndPrune : public BroadPhase
+{
+    public:
+        SweepAndPrune();
+
+        virtual void    update(); ///< Read the rect of every entity and sort them again.
+        virtual void    insertEntity(EntityNode* entity);
+        virtual void    eraseEntity(EntityNode* entity);
+        virtual void    removeWrecks();
+
+        /**
+         * \brief Get the pairs of entities whose rects touch.
+         *
+         * Entities inserted since the last update are not paired until
+         * the next one.
+         */
+        virtual void    getNearbyEntities(std::vector<Pair>& pairs) const;
+        virtual void    getEntitiesIn(sf::FloatRect area, std::vector<Proxy>& proxies) const;
+
+        virtual int     getEntityCount() const;
+        unsigned int    getSwapCount() const; ///< Swaps it took the last update to sort the rects.
+
+        /////////////////////////////////////////////////////////
+        // For testing purposes
+        virtual void    getCells(std::vector<sf::FloatRect>& cells) const; ///< Rects as of the last update, in sorted order.
+        /////////////////////////////////////////////////////////
+
+    private:
+        struct Box
+        {
+            float   left;
+            float   right;
+            float   top;
+            float   bottom;
+            int     slot; ///< Index of the entity in mEntities.
+        };
+
+        void    setRect(Box& box, sf::FloatRect rect);
+        void    sort();
+        void    eraseSlot(int slot);
+
+    private:
+        std::vector<EntityNode*>    mEntities; ///< Indexed by collission handle. nullptr in free slots.
+        std::vector<int>            mFreeSlots;
+        std::vector<Box>            mBoxes; ///< Sorted by left side as of the last update, but for those inserted since.
+        int                         mSortedCount; ///< Boxes not inserted since the last update, at the front of mBoxes.
+        float                       mMaxWidth; ///< Of the sorted boxes.
+        unsigned int                mSwapCount;
+};
+
+#endif //ANTGAME_SWEEPANDPRUNE_HPP
@@ -27,6 +27,13 @@
 #include <SceneNode.hpp>
 #include <PolygonShape.hpp>
 
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <functional>
+////////////////////////////////////////////////
+
+class EdgeIndex;
+
 
 class TerrainCollissionNode : public SceneNode
 {
@@ -42,6 +49,7 @@ class TerrainCollissionNode : public SceneNode
             std::list<Path*>    paths;
             sf::Vector2f        prev;
             sf::Vector2f        next;
+            int                 index; ///< Index among all points of the map. Assigned by Map.
         };
 
         struct Path
@@ -55,6 +63,8 @@ class TerrainCollissionNode : public SceneNode
             const bool      isEdge;
         };
 
+        static const float MAX_PASS_WIDTH; ///< Terrain further away than this from a path does not narrow it.
+
         TerrainCollissionNode(const std::vector<sf::Vector2f>& points);
         TerrainCollissionNode();
         const Point* getClosestPoint(sf::Vector2f p, float* minSqrd = nullptr) const;
@@ -65,25 +75,19 @@ class TerrainCollissionNode : public SceneNode
         std::list<Point>& getConvexAngles();
         bool isLineIntersecting(sf::Vector2f a, sf::Vector2f b) const;
         //bool isLineIntersecting(sf::Vector2f a, sf::Vector2f b, std::pair<const Point*, const Point*>& entry, std::pair<const Point*, const Point*>& exit) const;
-        void connectVisiblePoints(std::unique_ptr<TerrainCollissionNode>& node, std::list<std::unique_ptr<TerrainCollissionNode>>& nodes);
         Path* connectPoints(Point& from, Point& to, bool isEdge = false);
+        void removePaths(const std::function<bool(const Point& from, const Path& path)>& isRemoved); ///< Remove the paths for which isRemoved returns true.
         bool convexAngleContains(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c, sf::Vector2f p) const;
-        std::pair<double, double> getMinMaxAngles(sf::Vector2f pos);
 
-        void computePassWidths(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes);
-        void getVisiblePoints(sf::Vector2f p, const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, std::list<const Point*>& visiblePoints) const;
+        void computePassWidths(const EdgeIndex& edgeIndex);
+        void computePassWidth(const Point& from, Path& path, const EdgeIndex& edgeIndex);
+        void getVisiblePoints(sf::Vector2f p, const EdgeIndex& edgeIndex, std::list<const Point*>& visiblePoints) const;
     private:
 
         float minDistanceSqrd(sf::Vector2f a, sf::Vector2f b, sf::Vector2f p) const;
-        void connectVisiblePoints(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes);
-
-        bool addSectorIfVisible(std::vector<std::pair<double, double>>& sectors, const std::pair<double, double>& sector);
-        void mergeSectors(std::vector<std::pair<double, double>>& sectors);
 
         void computeConvexAngles();
 
-        bool lineIntersects(sf::Vector2f p1, sf::Vector2f p2, const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes) const;
-
         virtual void            drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const;
         virtual void            updateCurrent(CommandQueue&);
 
@@ -0,0 +1,93 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_THREADPOOL_HPP
+#define ANTGAME_THREADPOOL_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <deque>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/NonCopyable.hpp"
+////////////////////////////////////////////////
+
+/**
+ * \brief Runs tasks on a fixed set of threads that steal work from each other.
+ *
+ * Every thread has a queue of its own. Tasks submitted by a task go on
+ * the queue of the thread running it, which takes the newest first.
+ * A thread that runs out of tasks takes the oldest from another queue,
+ * so the work spreads out without a queue that all threads contend for.
+ *
+ * The thread calling wait() is one of the threads and works through the
+ * tasks along with the others, so a pool of one thread starts none.
+ */
+class ThreadPool : private sf::NonCopyable
+{
+    public:
+        typedef std::function<void(unsigned int thread)> Task; ///< Given the index of the thread running it.
+
+    public:
+        explicit ThreadPool(unsigned int threadCount = 0); ///< 0 for one per hardware thread.
+        ~ThreadPool();
+
+        void            submit(Task task);
+        void            wait(); ///< Help out until every task submitted has run, including those submitted meanwhile. Not from a task.
+
+        unsigned int    getThreadCount() const;
+
+    private:
+        struct Queue
+        {
+            std::mutex          mutex;
+            std::deque<Task>    tasks;
+        };
+
+        void    work(unsigned int thread);
+        bool    runTask(unsigned int thread); ///< Run a task from the queue of thread, or one stolen from another. False if there was none.
+        void    notify(); ///< Wake threads waiting for tasks or for the last task to finish.
+
+    private:
+        std::vector<std::unique_ptr<Queue>> mQueues; ///< One per thread. The thread calling wait() has the first.
+        std::vector<std::thread>            mThreads;
+
+        std::atomic<unsigned int>           mQueuedCount; ///< Tasks waiting in a queue.
+        std::atomic<unsigned int>           mPendingCount; ///< Tasks submitted and not yet finished.
+        std::atomic<unsigned int>           mNextQueue; ///< Queue for tasks submitted from outside the pool.
+
+        std::mutex                          mMutex;
+        std::condition_variable             mCondition;
+        bool                                mIsStopping;
+};
+
+#endif //ANTGAME_THREADPOOL_HPP
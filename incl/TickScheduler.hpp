@@ -0,0 +1,88 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_TICKSCHEDULER_HPP
+#define ANTGAME_TICKSCHEDULER_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <functional>
+////////////////////////////////////////////////
+
+#include "ThreadPool.hpp"
+
+/**
+ * \brief Runs the jobs of a tick in parallel, each once the jobs it depends on are done.
+ *
+ * A job is split into ranges of a fixed number of items, which run as
+ * separate tasks on a work stealing ThreadPool. How many items a job
+ * has is only asked when it starts, since it often depends on the jobs
+ * before it.
+ *
+ * The ranges do not depend on the number of threads. As long as the
+ * ranges of a job write to separate items, and jobs that touch the
+ * same data depend on each other, the tick comes out the same on any
+ * number of threads.
+ */
+class TickScheduler : private sf::NonCopyable
+{
+    public:
+        typedef unsigned int JobId;
+        typedef std::function<void()> Task;
+        typedef std::function<unsigned int()> Counter;
+        typedef std::function<void(unsigned int first, unsigned int end, unsigned int thread)> RangeTask; ///< Items first to end - 1, on the thread of that index.
+
+    public:
+        explicit TickScheduler(unsigned int threadCount = 0); ///< 0 for one per hardware thread.
+
+        JobId   addJob(Task task, std::vector<JobId> dependencies = std::vector<JobId>());
+        JobId   addParallelJob(Counter itemCount, unsigned int rangeSize, RangeTask task, std::vector<JobId> dependencies = std::vector<JobId>());
+
+        void    run(); ///< Run the jobs added since the last run, and wait for them.
+
+        void            setThreadCount(unsigned int threadCount); ///< 0 for one per hardware thread.
+        unsigned int    getThreadCount() const;
+
+    private:
+        struct Job
+        {
+            Counter                     itemCount;
+            unsigned int                rangeSize;
+            RangeTask                   task;
+            std::vector<JobId>          dependants;
+            std::atomic<unsigned int>   dependencyCount; ///< Jobs left to wait for.
+            std::atomic<unsigned int>   rangeCount; ///< Ranges left to run.
+        };
+
+        void    start(JobId job);
+        void    finish(JobId job);
+
+    private:
+        std::unique_ptr<ThreadPool>         mPool;
+        std::vector<std::unique_ptr<Job>>   mJobs;
+};
+
+#endif //ANTGAME_TICKSCHEDULER_HPP
@@ -85,6 +85,7 @@ bool    contains(sf::FloatRect lhs, sf::FloatRect rhs);
 bool    intersects(sf::FloatRect lhs, sf::FloatRect rhs);
 bool    intersects(sf::Vector2f p, sf::FloatRect rect);
 bool    intersects(sf::Vector2f a1, sf::Vector2f a2, sf::Vector2f b1, sf::Vector2f b2, sf::Vector2f* intersection = nullptr);
+bool    intersects(sf::Vector2f a, sf::Vector2f b, sf::FloatRect rect); ///< Does the segment a-b touch rect?
 
 bool    isAngleConvex(sf::Vector2f a, sf::Vector2f b, sf::Vector2f c);
 
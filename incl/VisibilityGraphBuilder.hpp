@@ -0,0 +1,161 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#ifndef ANTGAME_VISIBILITYGRAPHBUILDER_HPP
+#define ANTGAME_VISIBILITYGRAPHBUILDER_HPP
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <vector>
+#include <list>
+#include <set>
+#include <memory>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/System/Vector2.hpp"
+#include "SFML/Graphics/Rect.hpp"
+#include "SFML/System/NonCopyable.hpp"
+////////////////////////////////////////////////
+
+#include "TerrainCollissionNode.hpp"
+
+class EdgeIndex;
+
+/**
+ * \brief Connects the convex points of the terrain that see each other.
+ *
+ * Uses Lee's rotational plane sweep. For every convex point, all polygon
+ * points are sorted by angle around it and a ray is swept through them
+ * while keeping the polygon edges it crosses in a balanced tree ordered by
+ * distance. A point is visible if the closest of those edges does not cross
+ * the line to it. This is O(n^2 log n) instead of testing every pair
+ * against every edge.
+ *
+ * Pair tests through the edge index stop at the first edge in the way,
+ * so they are faster while lines of sight are short. build() only sweeps
+ * maps that are mostly open space.
+ */
+class VisibilityGraphBuilder : private sf::NonCopyable
+{
+    public:
+        VisibilityGraphBuilder(const EdgeIndex& edgeIndex);
+
+        /**
+         * \brief Connect the points of nodes.
+         *
+         * Points must have been numbered through
+         * TerrainCollissionNode::Point::index. The edge index must hold
+         * the edges of nodes, since it decides how the points are tested.
+         */
+        void    build(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes);
+
+        /**
+         * \brief Connect the points of a node added after build().
+         *
+         * node must already be in nodes and in the edge index. Its points
+         * are tested against the other points one by one, which is cheaper
+         * than sweeping the whole map again for a single node.
+         */
+        void    insert(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, TerrainCollissionNode& node);
+
+        /**
+         * \brief Connect the points whose line of sight crosses area.
+         *
+         * Used after a node inside area has been removed, since that may
+         * have cleared lines of sight. Points already connected are kept.
+         * Each point only tests the points in the edge index cells its cone
+         * through area reaches, so the edge index must be up to date.
+         */
+        void    reconnect(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, sf::FloatRect area);
+
+    private:
+        struct SweepPoint
+        {
+            sf::Vector2f                    pos;
+            int                             prev; ///< Neighbour in the polygon.
+            int                             next; ///< Neighbour in the polygon.
+            TerrainCollissionNode*          pNode;
+            TerrainCollissionNode::Point*   pPoint; ///< nullptr if the angle at this point is concave.
+        };
+
+        /**
+         * \brief Polygon edge crossed by the sweep ray.
+         *
+         * Identified by the indices of its end points, with a < b.
+         */
+        struct OpenEdge
+        {
+            int a;
+            int b;
+        };
+
+        /**
+         * \brief Orders open edges by distance along the current sweep ray.
+         *
+         * Open edges never cross, so their order stays the same while the
+         * ray turns and only needs to be evaluated on insertion.
+         */
+        struct CloserEdge
+        {
+            CloserEdge(const VisibilityGraphBuilder& builder);
+            bool operator()(const OpenEdge& lhs, const OpenEdge& rhs) const;
+
+            const VisibilityGraphBuilder* pBuilder;
+        };
+
+        typedef std::multiset<OpenEdge, CloserEdge> OpenEdges;
+
+        void    addPoints(TerrainCollissionNode& node);
+        void    testPairs(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes);
+        void    sweep(int source);
+        void    connect(SweepPoint& from, SweepPoint& to, bool isVisible);
+        void    connect(TerrainCollissionNode& fromNode, TerrainCollissionNode::Point& p1, TerrainCollissionNode& toNode, TerrainCollissionNode::Point& p2);
+
+        float   getRayDistance(sf::Vector2f origin, sf::Vector2f direction, const OpenEdge& edge) const;
+        bool    isCloser(sf::Vector2f origin, sf::Vector2f direction, const OpenEdge& lhs, const OpenEdge& rhs) const;
+        int     getEdgeSlot(const OpenEdge& edge) const; ///< Index of the point the edge starts at.
+        void    insertEdge(sf::Vector2f direction, OpenEdge edge);
+        void    removeEdge(OpenEdge edge);
+
+    private:
+        /**
+         * Edge index cells per polygon point above which build() sweeps.
+         * Cells are about as large as an average edge, so this is how
+         * much of the map is open space. Measured on grids of pentagons.
+         */
+        static const int SWEEP_CELLS_PER_POINT = 6;
+
+        const EdgeIndex&            mEdgeIndex;
+        std::vector<SweepPoint>     mPoints;
+        std::vector<int>            mOrder; ///< Points sorted by angle around the current source.
+        std::vector<sf::Vector2f>   mDirections; ///< From the current source to each point.
+        std::vector<int>            mHalves; ///< Half of the turn each direction points into.
+        sf::Vector2f                mOrigin; ///< Of the sweep ray.
+        sf::Vector2f                mDirection; ///< Of the sweep ray, where the next edge is inserted.
+        OpenEdges                   mOpenEdges;
+        std::vector<OpenEdges::iterator> mOpenEdgeSlots; ///< Position of each open edge by getEdgeSlot(), or mOpenEdges.end().
+};
+
+#endif // ANTGAME_VISIBILITYGRAPHBUILDER_HPP
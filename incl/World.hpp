@@ -55,7 +55,12 @@ namespace sf
 class World
 {
     public:
-        World(sf::RenderWindow& window);
+        /**
+         * \brief Build the world.
+         *
+         * \param threadCount Threads that run the simulation tick, 0 for one per core.
+         */
+        World(sf::RenderWindow& window, unsigned int threadCount = 0);
         void draw();
         void update();
         void handleEvent(const sf::Event& event);
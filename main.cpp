@@ -1,11 +1,39 @@
 #include "AntGame.hpp"
 
-int main()
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include <climits>
+
+int main(int argc, char** argv)
 {
     unsigned int sizeX, sizeY;
     sizeX = sizeY = 500;
 
-    AntGame game(sizeX, sizeY);
+    // Threads that run the simulation tick, 0 for one per core.
+    int threadCount = 0;
+    for(int i = 1; i < argc; i++)
+    {
+        bool isValid = false;
+        if(std::string(argv[i]) == "--threads" && i + 1 < argc)
+        {
+            // The whole argument must be a count, so that a typo is not taken for 0.
+            const char* count = argv[++i];
+            char* end = nullptr;
+            long value = std::strtol(count, &end, 10);
+
+            isValid = end != count && *end == '\0' && value >= 0 && value <= INT_MAX;
+            threadCount = value;
+        }
+
+        if(!isValid)
+        {
+            std::cerr << "Usage: " << argv[0] << " [--threads N, 0 for one per core]" << std::endl;
+            return 1;
+        }
+    }
+
+    AntGame game(sizeX, sizeY, threadCount);
     game.run();
 }
 
@@ -27,9 +27,9 @@
 
 #include <sstream>
 
-AntGame::AntGame(unsigned int sizeX, unsigned int sizeY)
+AntGame::AntGame(unsigned int sizeX, unsigned int sizeY, unsigned int threadCount)
 : mWindow(sf::VideoMode(sizeX, sizeY), "Ant game", sf::Style::Titlebar | sf::Style::Close)
-, mWorld(mWindow)
+, mWorld(mWindow, threadCount)
 {
     mWindow.setMouseCursorVisible(false);
     TIME_PER_FRAME::setAsSeconds(1/60.f);
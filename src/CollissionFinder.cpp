@@ -22,34 +22,176 @@
 
 #include "CollissionFinder.hpp"
 #include "EntityNode.hpp"
-#include "Utility.hpp"
 
-std::list<CollissionFinder::CollissionData> CollissionFinder::getCollissions(std::set<std::pair<EntityNode*, EntityNode*>>& nearbyEntities)
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cmath>
+////////////////////////////////////////////////
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ANTGAME_COLLISSION_SSE2
+#include <emmintrin.h>
+#endif
+
+CollissionFinder::CollissionFinder()
+: mIsVectorized(isVectorizable())
+, mTick(0)
+{
+}
+
+bool CollissionFinder::isVectorizable()
+{
+#if defined(__AVX__) || defined(ANTGAME_COLLISSION_SSE2)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void CollissionFinder::setVectorized(bool isVectorized)
+{
+    mIsVectorized = isVectorized && isVectorizable();
+}
+
+const std::vector<CollissionFinder::CollissionData>& CollissionFinder::getCollissions(const std::vector<Pair>& nearbyEntities)
+{
+    // Room for every pair colliding, so that writing the collissions never reallocates.
+    mCollissions.clear();
+    mCollissions.reserve(nearbyEntities.size());
+
+    gather(nearbyEntities);
+    findCollissions(nearbyEntities, 0, nearbyEntities.size(), mCollissions);
+
+    return mCollissions;
+}
+
+void CollissionFinder::findCollissions(const std::vector<Pair>& pairs, int first, int end, std::vector<CollissionData>& collissions) const
+{
+    if(mIsVectorized)
+        testVectorized(pairs, first, end, collissions);
+    else
+        testScalar(pairs, first, end, collissions);
+}
+
+void CollissionFinder::gather(const std::vector<Pair>& pairs)
+{
+    mTick++;
+
+    mDxs.resize(pairs.size());
+    mDys.resize(pairs.size());
+    mRadiusSums.resize(pairs.size());
+
+    for(int i = 0; i < (int)pairs.size(); i++)
+    {
+        int l = gatherEntity(pairs[i].first);
+        int r = gatherEntity(pairs[i].second);
+
+        mDxs[i] = mXs[l] - mXs[r];
+        mDys[i] = mYs[l] - mYs[r];
+        mRadiusSums[i] = mRadii[l] + mRadii[r];
+    }
+}
+
+int CollissionFinder::gatherEntity(EntityNode* entity)
 {
-    std::list<CollissionData> collissions;
-    for(auto pair : nearbyEntities)
+    int index = entity->getCollissionHandle();
+    if(index >= (int)mReadTicks.size())
     {
-        float radiusSum = pair.first->getBoundingRect().width / 2 + pair.second->getBoundingRect().width / 2;
+        mReadTicks.resize(index + 1, 0);
+        mXs.resize(index + 1);
+        mYs.resize(index + 1);
+        mRadii.resize(index + 1);
+    }
 
-        sf::Vector2f dVec = pair.first->getPosition() - pair.second->getPosition();
+    if(mReadTicks[index] != mTick)
+    {
+        mReadTicks[index] = mTick;
 
-        //float dSqrd = dVec.x * dVec.x + dVec.y * dVec.y;
+        sf::Vector2f position = entity->getPosition();
+        mXs[index] = position.x;
+        mYs[index] = position.y;
+        mRadii[index] = entity->getBoundingRect().width / 2;
+    }
 
-        if(std::fabs(dVec.x) < radiusSum && std::fabs(dVec.y) < radiusSum)
-        //if(dSqrd < radiusSum * radiusSum)
-        {
+    return index;
+}
 
-            CollissionData collission;
-            collission.lNode = pair.first;
-            collission.rNode = pair.second;
+void CollissionFinder::testScalar(const std::vector<Pair>& pairs, int first, int end, std::vector<CollissionData>& collissions) const
+{
+    for(int i = first; i < end; i++)
+    {
+        float distanceSqrd = mDxs[i] * mDxs[i] + mDys[i] * mDys[i];
+        if(distanceSqrd < mRadiusSums[i] * mRadiusSums[i])
+            addCollission(pairs[i], mDxs[i], mDys[i], mRadiusSums[i], std::sqrt(distanceSqrd), collissions);
+    }
+}
 
-            float d = length(dVec);
-            collission.penetrationDepth = radiusSum - d;
-            collission.unitVector = dVec / d;
+void CollissionFinder::testVectorized(const std::vector<Pair>& pairs, int first, int end, std::vector<CollissionData>& collissions) const
+{
+    int batchEnd = first;
+
+#if defined(__AVX__)
+    const int BATCH_SIZE = 8;
+    batchEnd = first + (end - first) / BATCH_SIZE * BATCH_SIZE;
 
-            collissions.push_back(collission);
-        }
+    float distances[BATCH_SIZE];
+    for(int i = first; i < batchEnd; i += BATCH_SIZE)
+    {
+        __m256 dx = _mm256_loadu_ps(&mDxs[i]);
+        __m256 dy = _mm256_loadu_ps(&mDys[i]);
+        __m256 radiusSum = _mm256_loadu_ps(&mRadiusSums[i]);
+
+        __m256 distanceSqrd = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        int hits = _mm256_movemask_ps(_mm256_cmp_ps(distanceSqrd, _mm256_mul_ps(radiusSum, radiusSum), _CMP_LT_OQ));
+        if(!hits)
+            continue;
+
+        _mm256_storeu_ps(distances, _mm256_sqrt_ps(distanceSqrd));
+        for(int j = 0; j < BATCH_SIZE; j++)
+            if(hits & (1 << j))
+                addCollission(pairs[i + j], mDxs[i + j], mDys[i + j], mRadiusSums[i + j], distances[j], collissions);
+    }
+#elif defined(ANTGAME_COLLISSION_SSE2)
+    const int BATCH_SIZE = 4;
+    batchEnd = first + (end - first) / BATCH_SIZE * BATCH_SIZE;
+
+    float distances[BATCH_SIZE];
+    for(int i = first; i < batchEnd; i += BATCH_SIZE)
+    {
+        __m128 dx = _mm_loadu_ps(&mDxs[i]);
+        __m128 dy = _mm_loadu_ps(&mDys[i]);
+        __m128 radiusSum = _mm_loadu_ps(&mRadiusSums[i]);
+
+        __m128 distanceSqrd = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        int hits = _mm_movemask_ps(_mm_cmplt_ps(distanceSqrd, _mm_mul_ps(radiusSum, radiusSum)));
+        if(!hits)
+            continue;
+
+        _mm_storeu_ps(distances, _mm_sqrt_ps(distanceSqrd));
+        for(int j = 0; j < BATCH_SIZE; j++)
+            if(hits & (1 << j))
+                addCollission(pairs[i + j], mDxs[i + j], mDys[i + j], mRadiusSums[i + j], distances[j], collissions);
     }
+#endif
+
+    // The pairs left over after the last whole batch.
+    testScalar(pairs, batchEnd, end, collissions);
+}
+
+void CollissionFinder::addCollission(const Pair& pair, float dx, float dy, float radiusSum, float distance, std::vector<CollissionData>& collissions)
+{
+    CollissionData collission;
+    collission.lNode = pair.first;
+    collission.rNode = pair.second;
+    collission.penetrationDepth = radiusSum - distance;
+
+    // Entities on top of each other are pushed apart along x.
+    if(distance > 0.f)
+        collission.unitVector = sf::Vector2f(dx / distance, dy / distance);
+    else
+        collission.unitVector = sf::Vector2f(1.f, 0.f);
 
-    return collissions;
+    collissions.push_back(collission);
 }
@@ -22,12 +22,35 @@
 
 #include "CollissionHandler.hpp"
 #include "EntityNode.hpp"
+#include "Utility.hpp"
 
-void CollissionHandler::handleCollissions(std::list<CollissionData> collissions)
+void CollissionHandler::handleCollissions(const std::vector<CollissionData>& collissions)
 {
-    for(CollissionData& collission : collissions)
+    // The entities have not moved since the collissions were found, so the distances they touch at follow from them.
+    mContacts.clear();
+    for(const CollissionData& collission : collissions)
     {
-        collission.lNode->goTo(collission.lNode->getPosition() + collission.unitVector * 10.f);
-        collission.rNode->goTo(collission.rNode->getPosition() - collission.unitVector * 10.f);
+        Contact contact;
+        contact.lNode = collission.lNode;
+        contact.rNode = collission.rNode;
+        contact.restDistance = collission.penetrationDepth + length(collission.lNode->getPosition() - collission.rNode->getPosition());
+        contact.unitVector = collission.unitVector;
+
+        mContacts.push_back(contact);
     }
+
+    for(unsigned int i = 0; i < SOLVER_ITERATIONS; i++)
+        for(const Contact& contact : mContacts)
+        {
+            sf::Vector2f dVec = contact.lNode->getPosition() - contact.rNode->getPosition();
+            float distance = length(dVec);
+            float penetrationDepth = contact.restDistance - distance;
+            if(penetrationDepth <= 0.f)
+                continue;
+
+            sf::Vector2f unit = distance > 0.f ? dVec / distance : contact.unitVector;
+            sf::Vector2f push = unit * (penetrationDepth / 2);
+            contact.lNode->move(push);
+            contact.rNode->move(-push);
+        }
 }
@@ -22,36 +22,100 @@
 
 
 #include "CollissionManager.hpp"
+#include "Quadtree.hpp"
+#include "SpatialHash.hpp"
+#include "SweepAndPrune.hpp"
 
-CollissionManager::CollissionManager(sf::FloatRect area)
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <algorithm>
+////////////////////////////////////////////////
+
+static std::unique_ptr<BroadPhase> createBroadPhase(sf::FloatRect area, BroadPhase::Type type)
+{
+    switch(type)
+    {
+        case BroadPhase::QuadtreeType:
+            return std::unique_ptr<BroadPhase>(new Quadtree(area));
+        case BroadPhase::SweepAndPruneType:
+            return std::unique_ptr<BroadPhase>(new SweepAndPrune());
+        case BroadPhase::SpatialHashType:
+        default:
+            return std::unique_ptr<BroadPhase>(new SpatialHash());
+    }
+}
+
+CollissionManager::CollissionManager(sf::FloatRect area, BroadPhase::Type broadPhase)
 : mFinder()
 , mHandler()
-, mQuadtree(area, mQuadtreeNodes)
+, mBroadPhase(createBroadPhase(area, broadPhase))
 {
 }
 
 void CollissionManager::update()
 {
-    mQuadtree.update();
+    findNearbyEntities();
+
+    for(unsigned int range = 0; range < getRangeCount(); range++)
+        findCollissions(range);
+
+    handleCollissions();
+}
+
+void CollissionManager::findNearbyEntities()
+{
+    mBroadPhase->update();
+
+    mBroadPhase->getNearbyEntities(mNearbyEntities);
+    mFinder.gather(mNearbyEntities);
+
+    if(mRangeCollissions.size() < getRangeCount())
+        mRangeCollissions.resize(getRangeCount());
+}
+
+unsigned int CollissionManager::getRangeCount() const
+{
+    return (mNearbyEntities.size() + PAIRS_PER_RANGE - 1) / PAIRS_PER_RANGE;
+}
+
+void CollissionManager::findCollissions(unsigned int range)
+{
+    unsigned int first = range * PAIRS_PER_RANGE;
+    unsigned int end = std::min<unsigned int>(first + PAIRS_PER_RANGE, mNearbyEntities.size());
+
+    std::vector<CollissionFinder::CollissionData>& collissions = mRangeCollissions[range];
+    collissions.clear();
+    mFinder.findCollissions(mNearbyEntities, first, end, collissions);
+}
+
+void CollissionManager::handleCollissions()
+{
+    mCollissions.clear();
+    for(unsigned int range = 0; range < getRangeCount(); range++)
+        mCollissions.insert(mCollissions.end(), mRangeCollissions[range].begin(), mRangeCollissions[range].end());
 
-    std::set<std::pair<EntityNode*, EntityNode*>> nearbyEntities = mQuadtree.getNearbyEntities();
-    mHandler.handleCollissions(mFinder.getCollissions(nearbyEntities));
+    mHandler.handleCollissions(mCollissions);
 }
 
 void CollissionManager::insertEntity(EntityNode* entity)
 {
-    mQuadtree.insertEntity(entity);
+    mBroadPhase->insertEntity(entity);
 }
 
 void CollissionManager::removeWrecks()
 {
-    mQuadtree.removeWrecks();
+    mBroadPhase->removeWrecks();
+}
+
+const BroadPhase& CollissionManager::getBroadPhase() const
+{
+    return *mBroadPhase;
 }
 
-std::list<const Quadtree*> CollissionManager::getQuadtree() const
+std::vector<sf::FloatRect> CollissionManager::getCells() const
 {
-    std::list<const Quadtree*> quadtree;
-    mQuadtree.getQuadtree(quadtree);
+    std::vector<sf::FloatRect> cells;
+    mBroadPhase->getCells(cells);
 
-    return quadtree;
+    return cells;
 }
@@ -0,0 +1,376 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "CrowdSteering.hpp"
+#include "EntityNode.hpp"
+#include "Utility.hpp"
+#include "TIME_PER_FRAME.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <algorithm>
+#include <cmath>
+////////////////////////////////////////////////
+
+const float CrowdSteering::TIME_HORIZON = 1.f;
+const float CrowdSteering::NEIGHBOUR_DISTANCE = 20.f;
+
+static const float EPSILON = 0.00001f;
+
+static float det(sf::Vector2f a, sf::Vector2f b)
+{
+    return a.x * b.y - a.y * b.x;
+}
+
+/*
+ * The linear programs below find the velocity closest to a preferred one
+ * among those left of every line and no faster than maxSpeed, after van
+ * den Berg et al., "Reciprocal n-body collision avoidance".
+ */
+
+/**
+ * \brief Find the best velocity on line lineNo that is left of the lines before it.
+ *
+ * With isDirection, the velocity furthest in the direction of
+ * optimization. Returns false if there is none.
+ */
+template <typename Line>
+static bool linearProgram1(const std::vector<Line>& lines, unsigned int lineNo, float maxSpeed, sf::Vector2f optimization, bool isDirection, sf::Vector2f& result)
+{
+    const Line& line = lines[lineNo];
+    float dotProduct = dot(line.point, line.direction);
+    float discriminant = dotProduct * dotProduct + maxSpeed * maxSpeed - lengthSqrd(line.point);
+
+    // The line misses the circle of allowed speeds.
+    if(discriminant < 0.f)
+        return false;
+
+    float sqrtDiscriminant = std::sqrt(discriminant);
+    float tLeft = -dotProduct - sqrtDiscriminant;
+    float tRight = -dotProduct + sqrtDiscriminant;
+
+    for(unsigned int i = 0; i < lineNo; i++)
+    {
+        float denominator = det(line.direction, lines[i].direction);
+        float numerator = det(lines[i].direction, line.point - lines[i].point);
+
+        // Parallel lines.
+        if(std::fabs(denominator) <= EPSILON)
+        {
+            if(numerator < 0.f)
+                return false;
+            else
+                continue;
+        }
+
+        float t = numerator / denominator;
+        if(denominator >= 0.f)
+            tRight = std::min(tRight, t);
+        else
+            tLeft = std::max(tLeft, t);
+
+        if(tLeft > tRight)
+            return false;
+    }
+
+    if(isDirection)
+    {
+        if(dot(optimization, line.direction) > 0.f)
+            result = line.point + tRight * line.direction;
+        else
+            result = line.point + tLeft * line.direction;
+    }
+    else
+    {
+        float t = dot(line.direction, optimization - line.point);
+        result = line.point + std::max(tLeft, std::min(t, tRight)) * line.direction;
+    }
+
+    return true;
+}
+
+/**
+ * \brief Find the velocity closest to optimization that is left of all lines.
+ *
+ * Returns the number of lines if there is one, and the index of the
+ * first line that could not be kept to otherwise.
+ */
+template <typename Line>
+static unsigned int linearProgram2(const std::vector<Line>& lines, float maxSpeed, sf::Vector2f optimization, bool isDirection, sf::Vector2f& result)
+{
+    if(isDirection)
+        result = optimization * maxSpeed;
+    else if(lengthSqrd(optimization) > maxSpeed * maxSpeed)
+        result = unitVector(optimization) * maxSpeed;
+    else
+        result = optimization;
+
+    for(unsigned int i = 0; i < lines.size(); i++)
+        if(det(lines[i].direction, lines[i].point - result) > 0.f)
+        {
+            sf::Vector2f previous = result;
+            if(!linearProgram1(lines, i, maxSpeed, optimization, isDirection, result))
+            {
+                result = previous;
+                return i;
+            }
+        }
+
+    return lines.size();
+}
+
+/**
+ * \brief Find the velocity that breaks the lines from beginLine on the least.
+ *
+ * For when the neighbours are too close for any velocity to be left of
+ * all lines.
+ */
+template <typename Line>
+static void linearProgram3(const std::vector<Line>& lines, unsigned int beginLine, float maxSpeed, std::vector<Line>& projectedLines, sf::Vector2f& result)
+{
+    float distance = 0.f;
+
+    for(unsigned int i = beginLine; i < lines.size(); i++)
+    {
+        if(det(lines[i].direction, lines[i].point - result) <= distance)
+            continue;
+
+        projectedLines.clear();
+        for(unsigned int j = 0; j < i; j++)
+        {
+            Line line;
+            float determinant = det(lines[i].direction, lines[j].direction);
+
+            if(std::fabs(determinant) <= EPSILON)
+            {
+                // Parallel lines pointing the same way.
+                if(dot(lines[i].direction, lines[j].direction) > 0.f)
+                    continue;
+
+                line.point = 0.5f * (lines[i].point + lines[j].point);
+            }
+            else
+                line.point = lines[i].point + (det(lines[j].direction, lines[i].point - lines[j].point) / determinant) * lines[i].direction;
+
+            line.direction = unitVector(lines[j].direction - lines[i].direction);
+            projectedLines.push_back(line);
+        }
+
+        sf::Vector2f previous = result;
+        if(linearProgram2(projectedLines, maxSpeed, sf::Vector2f(-lines[i].direction.y, lines[i].direction.x), true, result) < projectedLines.size())
+            result = previous;
+
+        distance = det(lines[i].direction, lines[i].point - result);
+    }
+}
+
+CrowdSteering::CrowdSteering()
+: mTick(1)
+, mWorkspaces(1)
+{
+}
+
+void CrowdSteering::resize(unsigned int handleCount)
+{
+    if(handleCount <= mEntities.size())
+        return;
+
+    mEntities.resize(handleCount, nullptr);
+    mSteeredTicks.resize(handleCount, 0);
+    mVelocities.resize(handleCount);
+    mPreferredVelocities.resize(handleCount);
+    mMaxSpeeds.resize(handleCount);
+    mNextVelocities.resize(handleCount);
+}
+
+sf::Vector2f CrowdSteering::steer(EntityNode& entity, sf::Vector2f preferredVelocity, float maxSpeed)
+{
+    // Not made room for.
+    unsigned int handle = entity.getHandle();
+    if(handle >= mEntities.size())
+        return preferredVelocity;
+
+    sf::Vector2f velocity = preferredVelocity;
+    if(mEntities[handle] == &entity && mSteeredTicks[handle] + 1 == mTick)
+        velocity = mNextVelocities[handle];
+
+    mEntities[handle] = &entity;
+    mSteeredTicks[handle] = mTick;
+    mVelocities[handle] = velocity;
+    mPreferredVelocities[handle] = preferredVelocity;
+    mMaxSpeeds[handle] = maxSpeed;
+
+    return velocity;
+}
+
+unsigned int CrowdSteering::gatherAgents()
+{
+    mAgents.clear();
+    for(unsigned int handle = 0; handle < mEntities.size(); handle++)
+        if(mSteeredTicks[handle] == mTick)
+            mAgents.push_back(handle);
+
+    mSolvedVelocities.resize(mAgents.size());
+
+    return mAgents.size();
+}
+
+void CrowdSteering::solve(const BroadPhase& broadPhase, unsigned int first, unsigned int end, unsigned int thread)
+{
+    for(unsigned int i = first; i < end; i++)
+        mSolvedVelocities[i] = solve(broadPhase, mAgents[i], mWorkspaces[thread]);
+}
+
+void CrowdSteering::finish()
+{
+    for(unsigned int i = 0; i < mAgents.size(); i++)
+        mNextVelocities[mAgents[i]] = mSolvedVelocities[i];
+
+    mTick++;
+}
+
+sf::Vector2f CrowdSteering::solve(const BroadPhase& broadPhase, unsigned int handle, Workspace& workspace) const
+{
+    const float invTimeHorizon = 1.f / TIME_HORIZON;
+    const float invTimeStep = 1.f / TIME_PER_FRAME::S;
+
+    EntityNode* entity = mEntities[handle];
+    sf::Vector2f position = entity->getPosition();
+    sf::Vector2f velocity = mVelocities[handle];
+    sf::Vector2f preferredVelocity = mPreferredVelocities[handle];
+    float maxSpeed = mMaxSpeeds[handle];
+
+    std::vector<BroadPhase::Proxy>& neighbours = workspace.neighbours;
+    broadPhase.getEntitiesIn(sf::FloatRect(position.x - NEIGHBOUR_DISTANCE, position.y - NEIGHBOUR_DISTANCE, NEIGHBOUR_DISTANCE * 2, NEIGHBOUR_DISTANCE * 2), neighbours);
+
+    auto getCentre = [](const BroadPhase::Proxy& proxy)
+    {
+        return sf::Vector2f(proxy.rect.left + proxy.rect.width / 2, proxy.rect.top + proxy.rect.height / 2);
+    };
+
+    // The agent itself is among them, its rect as the broad phase last saw it.
+    float radius = -1.f;
+    for(const BroadPhase::Proxy& neighbour : neighbours)
+        if(neighbour.entity == entity)
+        {
+            radius = neighbour.rect.width / 2;
+            position = getCentre(neighbour);
+        }
+
+    if(radius < 0.f)
+        return preferredVelocity;
+
+    // Only avoid the closest few, the agent included.
+    if(neighbours.size() > MAX_NEIGHBOURS + 1)
+        std::nth_element(neighbours.begin(), neighbours.begin() + MAX_NEIGHBOURS, neighbours.end(), [&](const BroadPhase::Proxy& lhs, const BroadPhase::Proxy& rhs)
+        {
+            return lengthSqrd(getCentre(lhs) - position) < lengthSqrd(getCentre(rhs) - position);
+        });
+
+    std::vector<Line>& lines = workspace.lines;
+    lines.clear();
+    for(unsigned int i = 0; i < neighbours.size() && i <= MAX_NEIGHBOURS; i++)
+    {
+        const BroadPhase::Proxy& neighbour = neighbours[i];
+        if(neighbour.entity == entity)
+            continue;
+
+        // A neighbour that is not moving leaves all of the evasion to the agent.
+        bool isReciprocal = isSteered(neighbour.entity);
+        sf::Vector2f neighbourVelocity = isReciprocal ? mVelocities[neighbour.entity->getHandle()] : sf::Vector2f();
+        float share = isReciprocal ? 0.5f : 1.f;
+
+        sf::Vector2f relativePosition = getCentre(neighbour) - position;
+        sf::Vector2f relativeVelocity = velocity - neighbourVelocity;
+        float distanceSqrd = lengthSqrd(relativePosition);
+        float combinedRadius = radius + neighbour.rect.width / 2;
+        float combinedRadiusSqrd = combinedRadius * combinedRadius;
+
+        Line line;
+        sf::Vector2f u;
+        if(distanceSqrd > combinedRadiusSqrd)
+        {
+            // Vector from the centre of the truncated cone of colliding velocities to the relative velocity.
+            sf::Vector2f w = relativeVelocity - invTimeHorizon * relativePosition;
+            float wLengthSqrd = lengthSqrd(w);
+            float dotProduct = dot(w, relativePosition);
+
+            if(dotProduct < 0.f && dotProduct * dotProduct > combinedRadiusSqrd * wLengthSqrd)
+            {
+                // Closest to the cut off circle of the cone.
+                float wLength = std::sqrt(wLengthSqrd);
+                sf::Vector2f unitW = w / wLength;
+
+                line.direction = sf::Vector2f(unitW.y, -unitW.x);
+                u = (combinedRadius * invTimeHorizon - wLength) * unitW;
+            }
+            else
+            {
+                // Closest to one of the legs of the cone.
+                float leg = std::sqrt(distanceSqrd - combinedRadiusSqrd);
+                if(det(relativePosition, w) > 0.f)
+                    line.direction = sf::Vector2f(relativePosition.x * leg - relativePosition.y * combinedRadius, relativePosition.x * combinedRadius + relativePosition.y * leg) / distanceSqrd;
+                else
+                    line.direction = -sf::Vector2f(relativePosition.x * leg + relativePosition.y * combinedRadius, -relativePosition.x * combinedRadius + relativePosition.y * leg) / distanceSqrd;
+
+                u = dot(relativeVelocity, line.direction) * line.direction - relativeVelocity;
+            }
+        }
+        else
+        {
+            // Already overlapping. Get apart within one tick.
+            sf::Vector2f w = relativeVelocity - invTimeStep * relativePosition;
+            float wLength = length(w);
+            sf::Vector2f unitW = wLength > 0.f ? w / wLength : sf::Vector2f(1.f, 0.f);
+
+            line.direction = sf::Vector2f(unitW.y, -unitW.x);
+            u = (combinedRadius * invTimeStep - wLength) * unitW;
+        }
+
+        line.point = velocity + share * u;
+        lines.push_back(line);
+    }
+
+    sf::Vector2f result;
+    unsigned int lineFail = linearProgram2(lines, maxSpeed, preferredVelocity, false, result);
+    if(lineFail < lines.size())
+        linearProgram3(lines, lineFail, maxSpeed, workspace.projectedLines, result);
+
+    return result;
+}
+
+bool CrowdSteering::isSteered(EntityNode* entity) const
+{
+    unsigned int handle = entity->getHandle();
+    return handle < mEntities.size() && mEntities[handle] == entity && mSteeredTicks[handle] == mTick;
+}
+
+void CrowdSteering::setThreadCount(unsigned int threadCount)
+{
+    mWorkspaces.resize(threadCount);
+}
+
+unsigned int CrowdSteering::getAgentCount() const
+{
+    return mAgents.size();
+}
@@ -0,0 +1,223 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "EdgeIndex.hpp"
+#include "TerrainCollissionNode.hpp"
+#include "Utility.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cmath>
+#include <algorithm>
+#include <limits>
+////////////////////////////////////////////////
+
+EdgeIndex::EdgeIndex()
+: mCellOffsets(1, 0)
+, mCellSize(1.f)
+, mColumns(0)
+, mRows(0)
+{
+
+}
+
+void EdgeIndex::clear()
+{
+    mSegments.clear();
+    mCellOffsets.assign(1, 0);
+    mCellEdges.clear();
+    mCellSize = 1.f;
+    mColumns = 0;
+    mRows = 0;
+}
+
+void EdgeIndex::build(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes)
+{
+    clear();
+
+    sf::Vector2f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    sf::Vector2f max(-min);
+    float totalLength = 0.f;
+
+    for(const std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
+    {
+        const std::vector<sf::Vector2f>& points = pNode->getPoints();
+        for(unsigned int i = 0; i + 1 < points.size(); i++)
+        {
+            Segment segment = {points[i], points[i + 1]};
+            mSegments.push_back(segment);
+            totalLength += length(segment.b - segment.a);
+
+            min.x = std::min(min.x, std::min(segment.a.x, segment.b.x));
+            min.y = std::min(min.y, std::min(segment.a.y, segment.b.y));
+            max.x = std::max(max.x, std::max(segment.a.x, segment.b.x));
+            max.y = std::max(max.y, std::max(segment.a.y, segment.b.y));
+        }
+    }
+
+    if(mSegments.empty())
+        return;
+
+    /*
+     * Cells about as large as an average edge keep the number of edges
+     * per cell low without making long queries walk too many cells.
+     */
+    sf::Vector2f size = max - min;
+    mCellSize = std::max(totalLength / mSegments.size(), std::max(size.x, size.y) / MAX_CELLS_PER_AXIS);
+    mCellSize = std::max(mCellSize, 1.f);
+    mOrigin = min;
+    mColumns = size.x / mCellSize + 1;
+    mRows = size.y / mCellSize + 1;
+
+    const int cellCount = mColumns * mRows;
+    mCellOffsets.assign(cellCount + 1, 0);
+
+    // Count the edges of each cell, then fill them in.
+    for(const Segment& segment : mSegments)
+        forEachCell(segment.a, segment.b, [this](int cell)
+        {
+            mCellOffsets[cell + 1]++;
+            return false;
+        });
+
+    for(int i = 0; i < cellCount; i++)
+        mCellOffsets[i + 1] += mCellOffsets[i];
+
+    mCellEdges.resize(mCellOffsets.back());
+    std::vector<int> cellSizes(cellCount, 0);
+    for(int i = 0; i < (int)mSegments.size(); i++)
+        forEachCell(mSegments[i].a, mSegments[i].b, [this, i, &cellSizes](int cell)
+        {
+            mCellEdges[mCellOffsets[cell] + cellSizes[cell]++] = i;
+            return false;
+        });
+}
+
+template<typename Function>
+bool EdgeIndex::forEachCell(sf::Vector2f a, sf::Vector2f b, Function function) const
+{
+    /*
+     * Walk the grid row by row. Within a row, the segment covers the
+     * cells between where it enters and leaves the row. A small margin
+     * keeps segments lying on cell borders from slipping between cells.
+     */
+    const float margin = mCellSize * 0.001f;
+
+    float minY = std::min(a.y, b.y) - margin - mOrigin.y;
+    float maxY = std::max(a.y, b.y) + margin - mOrigin.y;
+    int firstRow = std::max(0, (int)std::floor(minY / mCellSize));
+    int lastRow = std::min(mRows - 1, (int)std::floor(maxY / mCellSize));
+
+    for(int row = firstRow; row <= lastRow; row++)
+    {
+        float top = mOrigin.y + row * mCellSize;
+        float bottom = top + mCellSize;
+
+        float x1 = a.x;
+        float x2 = b.x;
+        if(a.y != b.y)
+        {
+            float t1 = std::max(0.f, std::min(1.f, (top - a.y) / (b.y - a.y)));
+            float t2 = std::max(0.f, std::min(1.f, (bottom - a.y) / (b.y - a.y)));
+            x1 = a.x + (b.x - a.x) * t1;
+            x2 = a.x + (b.x - a.x) * t2;
+        }
+
+        float minX = std::min(x1, x2) - margin - mOrigin.x;
+        float maxX = std::max(x1, x2) + margin - mOrigin.x;
+        int firstColumn = std::max(0, (int)std::floor(minX / mCellSize));
+        int lastColumn = std::min(mColumns - 1, (int)std::floor(maxX / mCellSize));
+
+        for(int column = firstColumn; column <= lastColumn; column++)
+            if(function(row * mColumns + column))
+                return true;
+    }
+
+    return false;
+}
+
+bool EdgeIndex::isLineIntersecting(sf::Vector2f a, sf::Vector2f b) const
+{
+    return forEachCell(a, b, [this, a, b](int cell)
+    {
+        for(int i = mCellOffsets[cell]; i < mCellOffsets[cell + 1]; i++)
+        {
+            const Segment& segment = mSegments[mCellEdges[i]];
+            if(segment.a == a || segment.a == b || segment.b == a || segment.b == b)
+                continue;
+
+            if(intersects(segment.a, segment.b, a, b))
+                return true;
+        }
+
+        return false;
+    });
+}
+
+void EdgeIndex::getSegments(sf::FloatRect rect, std::vector<Segment>& segments) const
+{
+    segments.clear();
+    if(mColumns == 0 || mRows == 0)
+        return;
+
+    int firstColumn = std::max(0, (int)std::floor((rect.left - mOrigin.x) / mCellSize));
+    int lastColumn = std::min(mColumns - 1, (int)std::floor((rect.left + rect.width - mOrigin.x) / mCellSize));
+    int firstRow = std::max(0, (int)std::floor((rect.top - mOrigin.y) / mCellSize));
+    int lastRow = std::min(mRows - 1, (int)std::floor((rect.top + rect.height - mOrigin.y) / mCellSize));
+
+    // Long segments are stored in several cells.
+    std::vector<int> indices;
+    for(int row = firstRow; row <= lastRow; row++)
+        for(int column = firstColumn; column <= lastColumn; column++)
+        {
+            const int cell = row * mColumns + column;
+            indices.insert(indices.end(), mCellEdges.begin() + mCellOffsets[cell], mCellEdges.begin() + mCellOffsets[cell + 1]);
+        }
+
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+    segments.reserve(indices.size());
+    for(int i : indices)
+        segments.push_back(mSegments[i]);
+}
+
+int EdgeIndex::getSegmentCount() const
+{
+    return mSegments.size();
+}
+
+sf::Vector2i EdgeIndex::getGridSize() const
+{
+    return sf::Vector2i(mColumns, mRows);
+}
+
+float EdgeIndex::getCellSize() const
+{
+    return mCellSize;
+}
+
+sf::Vector2f EdgeIndex::getOrigin() const
+{
+    return mOrigin;
+}
@@ -25,20 +25,38 @@
 #include "CommandQueue.hpp"
 #include "Pathfinder.hpp"
 #include "Map.hpp"
+#include "TIME_PER_FRAME.hpp"
 
 
-EntitiesManager::EntitiesManager(const Map& map, CommandQueue& commandQueue)
-: mCommandQueue(commandQueue)
-, mCollissionManager(map.getBounds())
-, mPathfinder(map)
+EntitiesManager::PathSlot::PathSlot()
+: ticket(0)
+, isWaiting(false)
+, handle(0)
+, diameter(0.f)
 {
 
 }
 
+EntitiesManager::EntitiesManager(Map& map, CommandQueue& commandQueue)
+: mMap(map)
+, mCommandQueue(commandQueue)
+, mEntityStore()
+, mCollissionManager(map.getBounds(), map.getBroadPhase())
+, mCrowdSteering()
+, mPathfinder(map)
+, mPathRequests(mPathfinder, PATH_EXPANSIONS_PER_TICK)
+, mPathSlots()
+, mScheduler()
+, mEntitiesGraph()
+{
+    mCrowdSteering.setThreadCount(mScheduler.getThreadCount());
+}
+
 
 void EntitiesManager::insertEntity(std::unique_ptr<EntityNode> entity)
 {
     mCollissionManager.insertEntity(entity.get());
+    mPathSlots.resize(mEntityStore.getHandleCount());
     mEntitiesGraph.attachChild(std::move(entity));
 }
 
@@ -48,18 +66,15 @@ void EntitiesManager::draw(sf::RenderTarget& target) const
     mPathfinder.draw(target);
 
 /*
-    // Quadtree debugging
+    // Broad phase debugging
     sf::RectangleShape shape;
     shape.setFillColor(sf::Color::Transparent);
     shape.setOutlineColor(sf::Color::Red);
     shape.setOutlineThickness(1.f);
 
-    std::list<const Quadtree*> quadtree = mCollissionManager.getQuadtree();
-    for(const Quadtree* quad : quadtree)
+    std::vector<sf::FloatRect> cells = mCollissionManager.getCells();
+    for(sf::FloatRect bounds : cells)
     {
-        assert(quad != nullptr);
-
-        sf::FloatRect bounds = quad->getBoundingRect();
         shape.setPosition(bounds.left, bounds.top);
         shape.setSize(sf::Vector2f(bounds.width, bounds.height));
 
@@ -74,6 +89,132 @@ std::list<Pathfinder::Waypoint> EntitiesManager::getPath(float diameter, sf::Vec
     return mPathfinder.getPath(diameter, a, b);
 }
 
+std::list<Pathfinder::Waypoint> EntitiesManager::getPath(const Pathfinder::SearchTree& tree, sf::Vector2f a, sf::Vector2f b)
+{
+    return mPathfinder.getPath(tree, a, b);
+}
+
+std::list<Pathfinder::Waypoint> EntitiesManager::getPath(Pathfinder::Chase& chase, sf::Vector2f a, sf::Vector2f b)
+{
+    return mPathfinder.getPath(chase, a, b);
+}
+
+Pathfinder::SearchTreePtr EntitiesManager::getSearchTree(float diameter, sf::Vector2f b)
+{
+    return mPathfinder.getSearchTree(diameter, b);
+}
+
+Pathfinder::FlowFieldPtr EntitiesManager::getFlowField(float diameter, sf::Vector2f b)
+{
+    return mPathfinder.getFlowField(diameter, b);
+}
+
+std::list<Pathfinder::Waypoint> EntitiesManager::refinePath(Pathfinder::AbstractPath& path)
+{
+    return mPathfinder.refinePath(path);
+}
+
+unsigned int EntitiesManager::requestPath(const EntityNode& entity, float diameter, sf::Vector2f a, sf::Vector2f b, PathRequestQueue::Callback callback)
+{
+    PathSlot& slot = mPathSlots[entity.getHandle()];
+    if(slot.handle)
+    {
+        mPathRequests.cancel(slot.handle);
+        slot.handle = 0;
+    }
+
+    // Skip 0 if the tickets wrap around.
+    slot.ticket++;
+    if(slot.ticket == 0)
+        slot.ticket++;
+
+    slot.isWaiting = true;
+    slot.diameter = diameter;
+    slot.a = a;
+    slot.b = b;
+    slot.callback = callback;
+
+    return slot.ticket;
+}
+
+void EntitiesManager::cancelPath(const EntityNode& entity, unsigned int ticket)
+{
+    PathSlot& slot = mPathSlots[entity.getHandle()];
+    if(slot.ticket != ticket)
+        return;
+
+    if(slot.handle)
+    {
+        mPathRequests.cancel(slot.handle);
+        slot.handle = 0;
+    }
+
+    slot.isWaiting = false;
+    slot.callback = PathRequestQueue::Callback();
+}
+
+void EntitiesManager::queuePathRequests()
+{
+    for(unsigned int i = 0; i < mPathSlots.size(); i++)
+    {
+        PathSlot& slot = mPathSlots[i];
+        if(!slot.isWaiting)
+            continue;
+
+        PathRequestQueue::Callback callback;
+        callback.swap(slot.callback);
+        slot.isWaiting = false;
+
+        // A request that is answered is no longer one to cancel.
+        slot.handle = mPathRequests.request(slot.diameter, slot.a, slot.b, [this, i, callback](std::list<Pathfinder::Waypoint>& path, Pathfinder::AbstractPathPtr remainder)
+        {
+            mPathSlots[i].handle = 0;
+            callback(path, remainder);
+        });
+    }
+}
+
+PathRequestQueue::Metrics EntitiesManager::getPathMetrics() const
+{
+    return mPathRequests.getMetrics();
+}
+
+PathCache::Metrics EntitiesManager::getPathCacheMetrics() const
+{
+    return mPathfinder.getPathCacheMetrics();
+}
+
+TerrainCollissionNode* EntitiesManager::insertObstacle(std::unique_ptr<TerrainCollissionNode> pObstacle)
+{
+    return mMap.insertObstacle(std::move(pObstacle));
+}
+
+bool EntitiesManager::removeObstacle(const TerrainCollissionNode* pObstacle)
+{
+    return mMap.removeObstacle(pObstacle);
+}
+
+sf::Vector2f EntitiesManager::steer(EntityNode& entity, sf::Vector2f preferredVelocity)
+{
+    return mCrowdSteering.steer(entity, preferredVelocity, entity.getAttributes().movementSpeed);
+}
+
+EntityStore& EntitiesManager::getEntityStore()
+{
+    return mEntityStore;
+}
+
+void EntitiesManager::setThreadCount(unsigned int threadCount)
+{
+    mScheduler.setThreadCount(threadCount);
+    mCrowdSteering.setThreadCount(mScheduler.getThreadCount());
+}
+
+unsigned int EntitiesManager::getThreadCount() const
+{
+    return mScheduler.getThreadCount();
+}
+
 void EntitiesManager::removeWrecks()
 {
     mCollissionManager.removeWrecks();
@@ -83,9 +224,52 @@ void EntitiesManager::removeWrecks()
 
 void EntitiesManager::update()
 {
+    mPathRequests.update();
+
     while (!mCommandQueue.isEmpty())
 		mEntitiesGraph.onCommand(mCommandQueue.pop());
 
-    mEntitiesGraph.update(mCommandQueue);
-    //mCollissionManager.update();
+    mCrowdSteering.resize(mEntityStore.getHandleCount());
+
+    typedef TickScheduler::JobId JobId;
+    auto getEntityCount = [this](){return mEntityStore.getEntityCount();};
+
+    // Entities only write their own velocities and strikes while updating, which the jobs after apply.
+    JobId states = mScheduler.addParallelJob(getEntityCount, ENTITIES_PER_JOB, [this](unsigned int first, unsigned int end, unsigned int)
+    {
+        for(unsigned int i = first; i < end; i++)
+            mEntityStore.getEntity(i)->update(mCommandQueue);
+    });
+
+    JobId damage = mScheduler.addJob([this](){mEntityStore.dealDamage();}, {states});
+    JobId move = mScheduler.addParallelJob(getEntityCount, ENTITIES_PER_JOB, [this](unsigned int first, unsigned int end, unsigned int)
+    {
+        mEntityStore.move(first, end, TIME_PER_FRAME::S);
+    }, {states});
+
+    // States that are done are left before wrecks are removed. The next states may read positions, so after moving too.
+    JobId advance = mScheduler.addParallelJob(getEntityCount, ENTITIES_PER_JOB, [this](unsigned int first, unsigned int end, unsigned int)
+    {
+        for(unsigned int i = first; i < end; i++)
+            mEntityStore.getEntity(i)->advanceState();
+    }, {damage, move});
+
+    // Entities request paths while updating and advancing their states, in whichever order the threads get to them.
+    mScheduler.addJob([this](){queuePathRequests();}, {advance});
+
+    JobId nearby = mScheduler.addJob([this](){mCollissionManager.findNearbyEntities();}, {advance});
+    JobId collissions = mScheduler.addParallelJob([this](){return mCollissionManager.getRangeCount();}, 1, [this](unsigned int range, unsigned int, unsigned int)
+    {
+        mCollissionManager.findCollissions(range);
+    }, {nearby});
+    JobId separation = mScheduler.addJob([this](){mCollissionManager.handleCollissions();}, {collissions});
+
+    JobId agents = mScheduler.addJob([this](){mCrowdSteering.gatherAgents();}, {states});
+    JobId steering = mScheduler.addParallelJob([this](){return mCrowdSteering.getAgentCount();}, AGENTS_PER_JOB, [this](unsigned int first, unsigned int end, unsigned int thread)
+    {
+        mCrowdSteering.solve(mCollissionManager.getBroadPhase(), first, end, thread);
+    }, {separation, agents});
+    mScheduler.addJob([this](){mCrowdSteering.finish();}, {steering});
+
+    mScheduler.run();
 }
@@ -26,6 +26,8 @@
 ////////////////////////////////////////////////
 // STD - C++ Standard Library
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 ////////////////////////////////////////////////
 
 ////////////////////////////////////////////////
@@ -36,37 +38,34 @@
 #include "CommandQueue.hpp"
 #include "EntitiesManager.hpp"
 
-EntityNode::Attributes::Attributes(int baseHp, float baseMovementSpeed, int baseAttackDamage, float baseAttackRange)
-: baseHp(baseHp)
-, hp(baseHp)
-, baseMovementSpeed(baseMovementSpeed)
-, movementSpeed(baseMovementSpeed)
-, baseAttackDamage(baseAttackDamage)
-, attackDamage(baseAttackDamage)
-, baseAttackRange(baseAttackRange)
-, attackRange(baseAttackRange)
-{
-
-}
-
 EntityNode::EntityNode(int hp, sf::Vector2f position, Team& team, EntitiesManager& entitiesManager, Category::Type category)
 : SceneNode(category)
-, mAttributes(hp, 100, 10, 40)
+, mStore(entitiesManager.getEntityStore())
+, mHandle(mStore.insert(this, position, Attributes(hp, 100, 10, 40), team.getId(), category))
 , mHarvestCategory(0)
 , mAttackCategory(Category::Entity)
 , mHealCategory(0)
 , mTeam(team)
 , mEntitiesManager(entitiesManager)
 , mStateQueue(StateQueue::StatePtr(new EntityState(*this, mEntitiesManager)))
+, mCollissionHandle(-1)
 {
-    setPosition(position);
     updateOrigin();
 }
 
+EntityNode::~EntityNode()
+{
+    mStore.erase(mHandle);
+}
+
 void EntityNode::updateOrigin()
 {
     sf::FloatRect bounds = mSprite.getGlobalBounds();
     setOrigin(bounds.width / 2.f, bounds.height / 2.f);
+
+    bounds.left -= bounds.width / 2.f;
+    bounds.top -= bounds.height / 2.f;
+    mStore.setBounds(mHandle, bounds);
 }
 
 void EntityNode::setTexture(const sf::Texture& texture)
@@ -83,7 +82,7 @@ void EntityNode::setSprite(sf::Sprite sprite)
 
 const EntityNode::Attributes& EntityNode::getAttributes() const
 {
-    return mAttributes;
+    return mStore.getAttributes(mHandle);
 }
 
 void EntityNode::interact(EntityNode* target, bool isAppending)
@@ -124,6 +123,86 @@ void EntityNode::goTo(sf::Vector2f target, bool isAppending)
         mStateQueue.setState(std::move(StateQueue::StatePtr(new EntityStateMove(*this, mEntitiesManager, target))));
 }
 
+void EntityNode::goTo(sf::Vector2f target, Pathfinder::SearchTreePtr searchTree, bool isAppending)
+{
+    if(isAppending)
+        mStateQueue.pushState(std::move(StateQueue::StatePtr(new EntityStateMove(*this, mEntitiesManager, target, searchTree))));
+    else
+        mStateQueue.setState(std::move(StateQueue::StatePtr(new EntityStateMove(*this, mEntitiesManager, target, searchTree))));
+}
+
+void EntityNode::groupGoTo(const std::vector<EntityNode*>& group, sf::Vector2f target, bool isAppending)
+{
+    if(group.empty())
+        return;
+
+    if(group.size() == 1)
+    {
+        group.front()->goTo(target, isAppending);
+        return;
+    }
+
+    // The tree must fit the largest entity of the group.
+    float diameter = 0.f;
+    for(const EntityNode* pEntity : group)
+        diameter = std::max(diameter, pEntity->getDiameter());
+
+    Pathfinder::SearchTreePtr searchTree = group.front()->mEntitiesManager.getSearchTree(diameter, target);
+
+    /*
+     * Hand out grid slots row by row, in the same order as the entities
+     * currently stand, so that the group keeps its shape and paths
+     * crossing each other at the destination are kept to a minimum.
+     */
+    std::vector<EntityNode*> formation(group);
+    std::sort(formation.begin(), formation.end(), [](const EntityNode* lhs, const EntityNode* rhs)
+    {
+        sf::Vector2f lPos = lhs->getPosition();
+        sf::Vector2f rPos = rhs->getPosition();
+        return lPos.y < rPos.y || (lPos.y == rPos.y && lPos.x < rPos.x);
+    });
+
+    const unsigned int columns = std::ceil(std::sqrt(formation.size()));
+    const unsigned int rows = (formation.size() + columns - 1) / columns;
+    const float spacing = diameter * 1.5f;
+    const sf::Vector2f origin = target - sf::Vector2f(columns - 1, rows - 1) * spacing / 2.f;
+
+    for(unsigned int i = 0; i < formation.size(); i++)
+    {
+        sf::Vector2f slot = origin + sf::Vector2f(i % columns, i / columns) * spacing;
+        formation[i]->goTo(slot, searchTree, isAppending);
+    }
+}
+
+void EntityNode::groupInteract(const std::vector<EntityNode*>& group, EntityNode* target, bool isAppending)
+{
+    assert(target && !target->isMarkedForRemoval());
+
+    std::vector<EntityNode*> attackers;
+    for(EntityNode* pEntity : group)
+        if(pEntity->canAttack(target))
+            attackers.push_back(pEntity);
+        else
+            pEntity->interact(target, isAppending);
+
+    if(attackers.size() < FLOW_FIELD_GROUP_SIZE)
+    {
+        for(EntityNode* pEntity : attackers)
+            pEntity->attack(target, isAppending);
+
+        return;
+    }
+
+    // The field must fit the largest attacker.
+    float diameter = 0.f;
+    for(const EntityNode* pEntity : attackers)
+        diameter = std::max(diameter, pEntity->getDiameter());
+
+    Pathfinder::FlowFieldPtr flowField = target->mEntitiesManager.getFlowField(diameter, target->getPosition());
+    for(EntityNode* pEntity : attackers)
+        pEntity->attack(target, flowField, isAppending);
+}
+
 void EntityNode::heal(EntityNode* target, bool isAppending)
 {
     //mTarget = target;
@@ -138,6 +217,19 @@ void EntityNode::attack(EntityNode* target, bool isAppending)
         mStateQueue.setState(std::move(StateQueue::StatePtr(new EntityStateAttack(*this, mEntitiesManager, target))));
 }
 
+void EntityNode::attack(EntityNode* target, Pathfinder::FlowFieldPtr flowField, bool isAppending)
+{
+    if(isAppending)
+        mStateQueue.pushState(std::move(StateQueue::StatePtr(new EntityStateAttack(*this, mEntitiesManager, target, flowField))));
+    else
+        mStateQueue.setState(std::move(StateQueue::StatePtr(new EntityStateAttack(*this, mEntitiesManager, target, flowField))));
+}
+
+bool EntityNode::canAttack(const EntityNode* target) const
+{
+    return (target->getCategory() & mAttackCategory) && mTeam.isHostile(target->getTeamId());
+}
+
 void EntityNode::harvest(EntityNode* target, bool isAppending)
 {
     //mTarget = target;
@@ -152,7 +244,13 @@ void EntityNode::assist(EntityNode* target, bool isAppending)
 
 unsigned int EntityNode::getTeamId() const
 {
-    return mTeam.getId();
+    return mStore.getTeamId(mHandle);
+}
+
+float EntityNode::getDiameter() const
+{
+    sf::FloatRect rect = getBoundingRect();
+    return rect.width / 2 + rect.height / 2;
 }
 
 void EntityNode::updateCurrent(CommandQueue& commands)
@@ -160,35 +258,96 @@ void EntityNode::updateCurrent(CommandQueue& commands)
     mStateQueue.update();
 }
 
+void EntityNode::advanceState()
+{
+    mStateQueue.advance();
+}
+
 bool EntityNode::isMoving() const
 {
     return mStateQueue.getState()->isMoving();
 }
 
+bool EntityNode::hasMoved() const
+{
+    return mStore.hasMoved(mHandle);
+}
+
+EntityStore::Handle EntityNode::getHandle() const
+{
+    return mHandle;
+}
+
 void EntityNode::drawCurrent(sf::RenderTarget& target, sf::RenderStates states) const
 {
+    states.transform.translate(getPosition());
     target.draw(mSprite, states);
 }
 
 sf::FloatRect EntityNode::getBoundingRect() const
 {
-    return getWorldTransform().transformRect(mSprite.getGlobalBounds());
+    return mStore.getBoundingRect(mHandle);
+}
+
+unsigned int EntityNode::getCategory() const
+{
+    return mStore.getCategory(mHandle);
+}
+
+sf::Vector2f EntityNode::getPosition() const
+{
+    return mStore.getPosition(mHandle);
+}
+
+void EntityNode::setPosition(sf::Vector2f position)
+{
+    mStore.setPosition(mHandle, position);
 }
 
+void EntityNode::move(sf::Vector2f offset)
+{
+    mStore.setPosition(mHandle, mStore.getPosition(mHandle) + offset);
+}
+
+sf::Vector2f EntityNode::getVelocity() const
+{
+    return mStore.getVelocity(mHandle);
+}
+
+void EntityNode::setVelocity(sf::Vector2f velocity)
+{
+    mStore.setVelocity(mHandle, velocity);
+}
 
 bool  EntityNode::isDestroyed() const
 {
-    return mAttributes.baseHp > 0 && mAttributes.hp <= 0;
+    const Attributes& attributes = getAttributes();
+    return attributes.baseHp > 0 && attributes.hp <= 0;
 }
 
 void EntityNode::damage(int points)
 {
-    mAttributes.hp -= points;
+    mStore.damage(mHandle, points);
 }
 
 void EntityNode::destroy()
 {
-    mAttributes.hp = 0;
+    mStore.destroy(mHandle);
+}
+
+void EntityNode::strike(EntityNode& target, int points)
+{
+    mStore.strike(mHandle, target.mHandle, points);
+}
+
+int EntityNode::getCollissionHandle() const
+{
+    return mCollissionHandle;
+}
+
+void EntityNode::setCollissionHandle(int handle)
+{
+    mCollissionHandle = handle;
 }
 
 bool EntityNode::isMarkedForRemoval() const
@@ -115,20 +115,18 @@ void EntitySelector::interact(sf::Vector2f pos, bool isAppending)
     if(mActivations.size() == 0)
         return;
 
+    std::vector<EntityNode*> group;
+    for(Highlight& activation : mActivations)
+        if(activation.node->getCategory() & Category::PlayerEntity)
+            group.push_back(activation.node);
+
     if(mSelections.size() > 0)
     {
-        for(Highlight& activation : mActivations)
-            if(activation.node->getCategory() & Category::PlayerEntity)
-                for(Highlight& selection : mSelections)
-                    activation.node->interact(selection.node, isAppending);
-
+        for(Highlight& selection : mSelections)
+            EntityNode::groupInteract(group, selection.node, isAppending);
     }
     else
-    {
-        for(Highlight& activation : mActivations)
-            if(activation.node->getCategory() & Category::PlayerEntity)
-                activation.node->goTo(pos, isAppending);
-    }
+        EntityNode::groupGoTo(group, pos, isAppending);
 }
 
 void EntitySelector::activate()
@@ -25,6 +25,7 @@
 #include "EntityNode.hpp"
 #include "TIME_PER_FRAME.hpp"
 #include "EntitiesManager.hpp"
+#include "Utility.hpp"
 
 EntityState::EntityState(EntityNode& entity, EntitiesManager& entitiesManager)
 : mEntity(entity)
@@ -33,6 +34,10 @@ EntityState::EntityState(EntityNode& entity, EntitiesManager& entitiesManager)
     // Do nothing more by default.
 }
 
+EntityState::~EntityState()
+{
+}
+
 void EntityState::update()
 {
     // Do nothing by default.
@@ -63,56 +68,188 @@ bool EntityState::isMoving() const
 EntityStateMove::EntityStateMove(EntityNode& entity, EntitiesManager& entitiesManager, sf::Vector2f target)
 : EntityState(entity, entitiesManager)
 , mTarget(target)
+, mPathRequest(0)
+{
+}
+
+EntityStateMove::EntityStateMove(EntityNode& entity, EntitiesManager& entitiesManager, sf::Vector2f target, Pathfinder::SearchTreePtr searchTree)
+: EntityState(entity, entitiesManager)
+, mTarget(target)
+, mPathRequest(0)
+, mSearchTree(searchTree)
+{
+}
+
+EntityStateMove::EntityStateMove(EntityNode& entity, EntitiesManager& entitiesManager, sf::Vector2f target, Pathfinder::FlowFieldPtr flowField)
+: EntityState(entity, entitiesManager)
+, mTarget(target)
+, mPathRequest(0)
+, mFlowField(flowField)
 {
 }
 
+EntityStateMove::~EntityStateMove()
+{
+    cancelPathRequest();
+}
+
 void EntityStateMove::initialize()
 {
-    sf::FloatRect rect = mEntity.getBoundingRect();
-    float diameter = rect.width / 2 + rect.height / 2;
+    cancelPathRequest();
+    mRemainder.reset();
+
+    if(mFlowField)
+    {
+        mWaypoints.clear();
+        return;
+    }
+
+    if(mSearchTree)
+    {
+        mWaypoints = mEntitiesManager.getPath(*mSearchTree, mEntity.getPosition(), mTarget);
+        return;
+    }
+
+    float diameter = mEntity.getDiameter();
+
+    // Keep following the current waypoints until the new path arrives.
+    mPathRequest = mEntitiesManager.requestPath(mEntity, diameter, mEntity.getPosition(), mTarget, [this](std::list<Pathfinder::Waypoint>& path, Pathfinder::AbstractPathPtr remainder)
+    {
+        mPathRequest = 0;
+        mWaypoints.swap(path);
+        mRemainder = remainder;
+
+        // The entity may have moved while the path was being solved.
+        if(!mWaypoints.empty())
+            mWaypoints.front() = Pathfinder::Waypoint(mEntity.getPosition(), mWaypoints.front().destination);
+    });
+}
+
+void EntityStateMove::cancelPathRequest()
+{
+    if(mPathRequest)
+    {
+        mEntitiesManager.cancelPath(mEntity, mPathRequest);
+        mPathRequest = 0;
+    }
+}
 
-    mWaypoints = mEntitiesManager.getPath(diameter, mEntity.getPosition(), mTarget);
+bool EntityStateMove::isWaitingForPath() const
+{
+    return mPathRequest != 0;
 }
 
 bool EntityStateMove::isDone() const
 {
-    return mWaypoints.empty();
+    return mWaypoints.empty() && !mRemainder && !isWaitingForPath() && !mFlowField;
+}
+
+bool EntityStateMove::isFollowingFlowField() const
+{
+    return mFlowField != nullptr;
 }
 
 void EntityStateMove::setTarget(sf::Vector2f target)
 {
     mTarget = target;
+    mSearchTree.reset();
+    mFlowField.reset();
     initialize();
 }
 
+void EntityStateMove::chase(sf::Vector2f target)
+{
+    cancelPathRequest();
+    mTarget = target;
+    mSearchTree.reset();
+    mFlowField.reset();
+    mRemainder.reset();
+
+    if(!mChase)
+        mChase.reset(new Pathfinder::Chase(mEntity.getDiameter()));
+
+    mWaypoints = mEntitiesManager.getPath(*mChase, mEntity.getPosition(), target);
+}
+
 bool EntityStateMove::isMoving() const
 {
-    return !mWaypoints.empty();
+    return !mWaypoints.empty() || mFlowField;
+}
+
+void EntityStateMove::steer()
+{
+    sf::Vector2f pos = mEntity.getPosition();
+    float distance = length(mTarget - pos);
+    float step = mEntity.getAttributes().movementSpeed * TIME_PER_FRAME::S;
+
+    if(distance <= step)
+    {
+        // Arrive at the end of the tick.
+        mEntity.setVelocity((mTarget - pos) / TIME_PER_FRAME::S);
+        mFlowField.reset();
+        return;
+    }
+
+    sf::Vector2f direction;
+    if(!mFlowField->sample(pos, direction))
+    {
+        // Pushed somewhere the field does not reach. Find a path out of there instead.
+        mFlowField.reset();
+        initialize();
+        return;
+    }
+
+    mEntity.setVelocity(mEntitiesManager.steer(mEntity, direction * mEntity.getAttributes().movementSpeed));
 }
 
 void EntityStateMove::update()
 {
+    if(mFlowField)
+    {
+        steer();
+        return;
+    }
+
+    // Refine a long path a bit before the unit gets to the end of what is known of it.
+    if(mRemainder && mWaypoints.size() <= REFINE_AHEAD)
+    {
+        mWaypoints.splice(mWaypoints.end(), mEntitiesManager.refinePath(*mRemainder));
+        if(mRemainder->corners.empty())
+            mRemainder.reset();
+    }
+
     if(mWaypoints.empty())
         return;
 
     Pathfinder::Waypoint* wp = &mWaypoints.front();
 
+    // Collissions push units off course. Head for the waypoint from wherever the unit is now.
+    *wp = Pathfinder::Waypoint(mEntity.getPosition(), wp->destination);
+
+    // Entities are only moved once all of them have updated, so find where this one would get to.
+    sf::Vector2f start = mEntity.getPosition();
+    sf::Vector2f position = start;
+
     float step = mEntity.getAttributes().movementSpeed * TIME_PER_FRAME::S;
     while(wp->distance < step)
     {
-        mEntity.setPosition(wp->destination);
+        position = wp->destination;
 
         step -= wp->distance;
         mWaypoints.pop_front();
 
         if(mWaypoints.empty())
+        {
+            mEntity.setVelocity((position - start) / TIME_PER_FRAME::S);
             return;
+        }
         else
             wp = &mWaypoints.front();
     }
 
-    mEntity.move(wp->direction * step);
-    wp->distance -= step;
+    // Give way to the units around. The waypoint is re-aimed next tick anyway.
+    sf::Vector2f velocity = mEntitiesManager.steer(mEntity, wp->direction * step / TIME_PER_FRAME::S);
+    mEntity.setVelocity((position - start) / TIME_PER_FRAME::S + velocity);
 }
 
 EntityStateAttack::EntityStateAttack(EntityNode& entity, EntitiesManager& entitiesManger, EntityNode* target)
@@ -122,6 +259,12 @@ EntityStateAttack::EntityStateAttack(EntityNode& entity, EntitiesManager& entiti
 }
 
 
+EntityStateAttack::EntityStateAttack(EntityNode& entity, EntitiesManager& entitiesManger, EntityNode* target, Pathfinder::FlowFieldPtr flowField)
+: EntityStateMove(entity, entitiesManger, target->getPosition(), flowField)
+, mTarget(target)
+{
+}
+
 bool EntityStateAttack::isInAttackRange(sf::Vector2f target) const
 {
     sf::Vector2f dVec = target - mEntity.getPosition();
@@ -133,17 +276,19 @@ bool EntityStateAttack::isInAttackRange(sf::Vector2f target) const
 
 void EntityStateAttack::update()
 {
-    EntityStateMove::update();
-
     sf::Vector2f targetPosition = mTarget->getPosition();
 
-    // If target is moving, get new path.
-    if(mTarget->isMoving())
-        EntityStateMove::setTarget(targetPosition);
+    // Units closing in along a flow field stop once in range, so that the ones behind can get there too.
+    if(!isFollowingFlowField() || !isInAttackRange(targetPosition))
+        EntityStateMove::update();
+
+    // Keep up with a moving target, once the first path has arrived.
+    if(mTarget->hasMoved() && !isWaitingForPath())
+        chase(targetPosition);
 
     // Attack if in range.
     if(isInAttackRange(targetPosition))
-        mTarget->damage(10);
+        mEntity.strike(*mTarget, 10);
 }
 
 bool EntityStateAttack::isDone() const
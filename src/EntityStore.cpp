@@ -0,0 +1,237 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "EntityStore.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cassert>
+////////////////////////////////////////////////
+
+EntityStore::Attributes::Attributes(int baseHp, float baseMovementSpeed, int baseAttackDamage, float baseAttackRange)
+: baseHp(baseHp)
+, hp(baseHp)
+, baseMovementSpeed(baseMovementSpeed)
+, movementSpeed(baseMovementSpeed)
+, baseAttackDamage(baseAttackDamage)
+, attackDamage(baseAttackDamage)
+, baseAttackRange(baseAttackRange)
+, attackRange(baseAttackRange)
+{
+
+}
+
+EntityStore::Handle EntityStore::insert(EntityNode* entity, sf::Vector2f position, const Attributes& attributes, unsigned int teamId, unsigned int category)
+{
+    Handle handle;
+    if(mFreeHandles.empty())
+    {
+        handle = mIndices.size();
+        mIndices.push_back(-1);
+    }
+    else
+    {
+        handle = mFreeHandles.back();
+        mFreeHandles.pop_back();
+    }
+
+    mIndices[handle] = mEntities.size();
+    mHandles.push_back(handle);
+    mEntities.push_back(entity);
+    mPositions.push_back(position);
+    mVelocities.push_back(sf::Vector2f());
+    mBounds.push_back(sf::FloatRect());
+    mAttributes.push_back(attributes);
+    mDamages.push_back(0);
+    mStrikeTargets.push_back(-1);
+    mStrikeDamages.push_back(0);
+    mHasMoved.push_back(false);
+    mTeamIds.push_back(teamId);
+    mCategories.push_back(category);
+
+    return handle;
+}
+
+void EntityStore::erase(Handle handle)
+{
+    assert(handle < mIndices.size() && mIndices[handle] >= 0);
+
+    // Fill the gap with the last entity.
+    int index = mIndices[handle];
+    int last = mEntities.size() - 1;
+    if(index != last)
+    {
+        mHandles[index] = mHandles[last];
+        mEntities[index] = mEntities[last];
+        mPositions[index] = mPositions[last];
+        mVelocities[index] = mVelocities[last];
+        mBounds[index] = mBounds[last];
+        mAttributes[index] = mAttributes[last];
+        mDamages[index] = mDamages[last];
+        mStrikeTargets[index] = mStrikeTargets[last];
+        mStrikeDamages[index] = mStrikeDamages[last];
+        mHasMoved[index] = mHasMoved[last];
+        mTeamIds[index] = mTeamIds[last];
+        mCategories[index] = mCategories[last];
+
+        mIndices[mHandles[index]] = index;
+    }
+
+    mHandles.pop_back();
+    mEntities.pop_back();
+    mPositions.pop_back();
+    mVelocities.pop_back();
+    mBounds.pop_back();
+    mAttributes.pop_back();
+    mDamages.pop_back();
+    mStrikeTargets.pop_back();
+    mStrikeDamages.pop_back();
+    mHasMoved.pop_back();
+    mTeamIds.pop_back();
+    mCategories.pop_back();
+
+    mIndices[handle] = -1;
+    mFreeHandles.push_back(handle);
+}
+
+sf::Vector2f EntityStore::getPosition(Handle handle) const
+{
+    return mPositions[mIndices[handle]];
+}
+
+void EntityStore::setPosition(Handle handle, sf::Vector2f position)
+{
+    mPositions[mIndices[handle]] = position;
+}
+
+sf::Vector2f EntityStore::getVelocity(Handle handle) const
+{
+    return mVelocities[mIndices[handle]];
+}
+
+void EntityStore::setVelocity(Handle handle, sf::Vector2f velocity)
+{
+    mVelocities[mIndices[handle]] = velocity;
+}
+
+sf::FloatRect EntityStore::getBoundingRect(Handle handle) const
+{
+    int index = mIndices[handle];
+    sf::FloatRect rect = mBounds[index];
+    rect.left += mPositions[index].x;
+    rect.top += mPositions[index].y;
+
+    return rect;
+}
+
+void EntityStore::setBounds(Handle handle, sf::FloatRect bounds)
+{
+    mBounds[mIndices[handle]] = bounds;
+}
+
+bool EntityStore::hasMoved(Handle handle) const
+{
+    return mHasMoved[mIndices[handle]];
+}
+
+const EntityStore::Attributes& EntityStore::getAttributes(Handle handle) const
+{
+    return mAttributes[mIndices[handle]];
+}
+
+void EntityStore::damage(Handle handle, int points)
+{
+    mDamages[mIndices[handle]] += points;
+}
+
+void EntityStore::destroy(Handle handle)
+{
+    mAttributes[mIndices[handle]].hp = 0;
+}
+
+void EntityStore::strike(Handle attacker, Handle target, int points)
+{
+    int index = mIndices[attacker];
+    mStrikeTargets[index] = target;
+    mStrikeDamages[index] = points;
+}
+
+unsigned int EntityStore::getTeamId(Handle handle) const
+{
+    return mTeamIds[mIndices[handle]];
+}
+
+unsigned int EntityStore::getCategory(Handle handle) const
+{
+    return mCategories[mIndices[handle]];
+}
+
+void EntityStore::move(float dt)
+{
+    move(0, mPositions.size(), dt);
+}
+
+void EntityStore::move(unsigned int first, unsigned int end, float dt)
+{
+    for(unsigned int i = first; i < end; i++)
+    {
+        mHasMoved[i] = mVelocities[i] != sf::Vector2f();
+        mPositions[i] += mVelocities[i] * dt;
+        mVelocities[i] = sf::Vector2f();
+    }
+}
+
+void EntityStore::dealDamage()
+{
+    for(unsigned int i = 0; i < mStrikeTargets.size(); i++)
+        if(mStrikeTargets[i] >= 0)
+        {
+            // The target may have been erased since.
+            int target = mIndices[mStrikeTargets[i]];
+            if(target >= 0)
+                mDamages[target] += mStrikeDamages[i];
+
+            mStrikeTargets[i] = -1;
+        }
+
+    for(unsigned int i = 0; i < mAttributes.size(); i++)
+    {
+        mAttributes[i].hp -= mDamages[i];
+        mDamages[i] = 0;
+    }
+}
+
+unsigned int EntityStore::getEntityCount() const
+{
+    return mEntities.size();
+}
+
+unsigned int EntityStore::getHandleCount() const
+{
+    return mIndices.size();
+}
+
+EntityNode* EntityStore::getEntity(unsigned int index) const
+{
+    return mEntities[index];
+}
@@ -0,0 +1,385 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "FlowField.hpp"
+#include "TerrainCollissionNode.hpp"
+#include "Utility.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <functional>
+#include <algorithm>
+////////////////////////////////////////////////
+
+const float FlowField::CELL_SIZE = 16.f;
+
+static float getDistanceSqrd(sf::Vector2f a, sf::Vector2f b, sf::Vector2f p)
+{
+    sf::Vector2f ab = b - a;
+    float abLengthSqrd = lengthSqrd(ab);
+    if(abLengthSqrd == 0.f)
+        return lengthSqrd(p - a);
+
+    float t = std::max(0.f, std::min(1.f, dot(p - a, ab) / abLengthSqrd));
+    return lengthSqrd(p - (a + ab * t));
+}
+
+FlowField::FlowField()
+: mDiameter(0.f)
+, mCellSize(CELL_SIZE)
+, mColumns(0)
+, mRows(0)
+, mTargetCell(-1)
+, mReachedCount(0)
+, mVersion(0)
+{
+
+}
+
+void FlowField::build(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, sf::FloatRect bounds, unsigned int version, sf::Vector2f target, float diameter, float cellSize)
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    mVersion = version;
+    mTarget = target;
+    mDiameter = diameter;
+    mCellSize = std::max(cellSize, std::max(bounds.width, bounds.height) / MAX_CELLS_PER_AXIS);
+    mCellSize = std::max(mCellSize, 1.f);
+    mOrigin = sf::Vector2f(bounds.left, bounds.top);
+    mColumns = bounds.width / mCellSize + 1;
+    mRows = bounds.height / mCellSize + 1;
+    mReachedCount = 0;
+
+    const int cellCount = mColumns * mRows;
+    mDistances.assign(cellCount, infinity);
+    mDirections.assign(cellCount, sf::Vector2f());
+    mIsBlocked.assign(cellCount, false);
+
+    blockTerrain(nodes, diameter / 2.f);
+
+    mTargetCell = getCell(target);
+    if(mTargetCell < 0)
+        return;
+
+    // The target may well stand right by the terrain.
+    mIsBlocked[mTargetCell] = false;
+
+    /*
+     * Fast marching: cells are settled in order of distance, like in
+     * Dijkstra, but each neighbour of a settled cell is given the
+     * distance of a front passing over it from both of its axes.
+     */
+    typedef std::pair<float, int> OpenCell;
+    std::priority_queue<OpenCell, std::vector<OpenCell>, std::greater<OpenCell>> openSet;
+    std::vector<bool> isSettled(cellCount, false);
+
+    mDistances[mTargetCell] = 0.f;
+    openSet.push(OpenCell(0.f, mTargetCell));
+
+    const int dx[4] = {-1, 1, 0, 0};
+    const int dy[4] = {0, 0, -1, 1};
+
+    while(!openSet.empty())
+    {
+        int cell = openSet.top().second;
+        openSet.pop();
+
+        // Stale entry, the cell was queued again with a shorter distance.
+        if(isSettled[cell])
+            continue;
+
+        isSettled[cell] = true;
+        mReachedCount++;
+
+        int x = cell % mColumns;
+        int y = cell / mColumns;
+        for(int i = 0; i < 4; i++)
+        {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if(nx < 0 || ny < 0 || nx >= mColumns || ny >= mRows)
+                continue;
+
+            int neighbour = ny * mColumns + nx;
+            if(mIsBlocked[neighbour] || isSettled[neighbour])
+                continue;
+
+            float distance = solveDistance(nx, ny);
+            if(distance < mDistances[neighbour])
+            {
+                mDistances[neighbour] = distance;
+                openSet.push(OpenCell(distance, neighbour));
+            }
+        }
+    }
+
+    for(int y = 0; y < mRows; y++)
+        for(int x = 0; x < mColumns; x++)
+            if(mDistances[y * mColumns + x] < infinity)
+                computeDirection(x, y);
+
+    /*
+     * Units brushing past a corner may cut into the blocked cells around
+     * the terrain. The ring of blocked cells next to reached ones leads
+     * back out to the nearest of those, rather than losing the field.
+     */
+    std::vector<std::pair<int, int>> exits; // Blocked cell and the reached cell it leads to.
+    for(int cell = 0; cell < cellCount; cell++)
+    {
+        if(!mIsBlocked[cell])
+            continue;
+
+        int x = cell % mColumns;
+        int y = cell / mColumns;
+        int exit = -1;
+        for(int i = 0; i < 4; i++)
+        {
+            int nx = x + dx[i];
+            int ny = y + dy[i];
+            if(nx < 0 || ny < 0 || nx >= mColumns || ny >= mRows)
+                continue;
+
+            int neighbour = ny * mColumns + nx;
+            if(!mIsBlocked[neighbour] && mDistances[neighbour] < infinity && (exit < 0 || mDistances[neighbour] < mDistances[exit]))
+                exit = neighbour;
+        }
+
+        if(exit >= 0)
+            exits.push_back(std::make_pair(cell, exit));
+    }
+
+    for(const std::pair<int, int>& exit : exits)
+    {
+        mDistances[exit.first] = mDistances[exit.second] + mCellSize;
+        mDirections[exit.first] = sf::Vector2f(exit.second % mColumns - exit.first % mColumns, exit.second / mColumns - exit.first / mColumns);
+    }
+}
+
+void FlowField::blockTerrain(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, float radius)
+{
+    /*
+     * Cells closer to an edge than half a cell are blocked no matter how
+     * small the unit, or the sweep could step from one side of a thin
+     * wall to the other.
+     */
+    const float clearance = std::max(radius, mCellSize / 2.f);
+    const float clearanceSqrd = clearance * clearance;
+
+    std::vector<float> crossings;
+    for(const std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
+    {
+        const std::vector<sf::Vector2f>& points = pNode->getPoints();
+        if(points.size() < 2)
+            continue;
+
+        // Cells near the edges.
+        float minY = std::numeric_limits<float>::max();
+        float maxY = -minY;
+        for(unsigned int i = 0; i + 1 < points.size(); i++)
+        {
+            sf::Vector2f a = points[i];
+            sf::Vector2f b = points[i + 1];
+            minY = std::min(minY, a.y);
+            maxY = std::max(maxY, a.y);
+
+            int left = std::max(0, (int)std::floor((std::min(a.x, b.x) - clearance - mOrigin.x) / mCellSize));
+            int right = std::min(mColumns - 1, (int)std::floor((std::max(a.x, b.x) + clearance - mOrigin.x) / mCellSize));
+            int top = std::max(0, (int)std::floor((std::min(a.y, b.y) - clearance - mOrigin.y) / mCellSize));
+            int bottom = std::min(mRows - 1, (int)std::floor((std::max(a.y, b.y) + clearance - mOrigin.y) / mCellSize));
+
+            for(int y = top; y <= bottom; y++)
+                for(int x = left; x <= right; x++)
+                {
+                    sf::Vector2f centre = mOrigin + sf::Vector2f(x + 0.5f, y + 0.5f) * mCellSize;
+                    if(getDistanceSqrd(a, b, centre) < clearanceSqrd)
+                        mIsBlocked[y * mColumns + x] = true;
+                }
+        }
+
+        // Cells inside the polygon, filled row by row between pairs of edge crossings.
+        int top = std::max(0, (int)std::floor((minY - mOrigin.y) / mCellSize));
+        int bottom = std::min(mRows - 1, (int)std::floor((maxY - mOrigin.y) / mCellSize));
+        for(int y = top; y <= bottom; y++)
+        {
+            float centreY = mOrigin.y + (y + 0.5f) * mCellSize;
+
+            crossings.clear();
+            for(unsigned int i = 0; i + 1 < points.size(); i++)
+            {
+                sf::Vector2f a = points[i];
+                sf::Vector2f b = points[i + 1];
+                if((a.y <= centreY) != (b.y <= centreY))
+                    crossings.push_back(a.x + (centreY - a.y) * (b.x - a.x) / (b.y - a.y));
+            }
+
+            std::sort(crossings.begin(), crossings.end());
+            for(unsigned int i = 0; i + 1 < crossings.size(); i += 2)
+            {
+                int first = std::max(0, (int)std::ceil((crossings[i] - mOrigin.x) / mCellSize - 0.5f));
+                int last = std::min(mColumns - 1, (int)std::floor((crossings[i + 1] - mOrigin.x) / mCellSize - 0.5f));
+                for(int x = first; x <= last; x++)
+                    mIsBlocked[y * mColumns + x] = true;
+            }
+        }
+    }
+}
+
+float FlowField::solveDistance(int x, int y) const
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    float a = std::min(x > 0 ? mDistances[y * mColumns + x - 1] : infinity,
+                       x + 1 < mColumns ? mDistances[y * mColumns + x + 1] : infinity);
+    float b = std::min(y > 0 ? mDistances[(y - 1) * mColumns + x] : infinity,
+                       y + 1 < mRows ? mDistances[(y + 1) * mColumns + x] : infinity);
+
+    if(a > b)
+        std::swap(a, b);
+
+    // The front comes from one axis only.
+    if(b - a >= mCellSize)
+        return a + mCellSize;
+
+    return (a + b + std::sqrt(2.f * mCellSize * mCellSize - (b - a) * (b - a))) / 2.f;
+}
+
+void FlowField::computeDirection(int x, int y)
+{
+    const int cell = y * mColumns + x;
+    if(cell == mTargetCell)
+        return;
+
+    // How much closer to the target a step to neighbour (nx, ny) gets. Unreachable neighbours are infinitely far.
+    auto getDrop = [this, cell](int nx, int ny)
+    {
+        if(nx < 0 || ny < 0 || nx >= mColumns || ny >= mRows)
+            return 0.f;
+
+        return std::max(0.f, mDistances[cell] - mDistances[ny * mColumns + nx]);
+    };
+
+    float left = getDrop(x - 1, y);
+    float right = getDrop(x + 1, y);
+    float up = getDrop(x, y - 1);
+    float down = getDrop(x, y + 1);
+
+    sf::Vector2f direction(right > left ? right : -left, down > up ? down : -up);
+    float directionLength = length(direction);
+    if(directionLength > 0.f)
+        mDirections[cell] = direction / directionLength;
+}
+
+int FlowField::getCell(sf::Vector2f p) const
+{
+    int x = std::floor((p.x - mOrigin.x) / mCellSize);
+    int y = std::floor((p.y - mOrigin.y) / mCellSize);
+    if(x < 0 || y < 0 || x >= mColumns || y >= mRows)
+        return -1;
+
+    return y * mColumns + x;
+}
+
+bool FlowField::sample(sf::Vector2f p, sf::Vector2f& direction) const
+{
+    const float infinity = std::numeric_limits<float>::infinity();
+
+    int cell = getCell(p);
+    if(cell < 0 || mDistances[cell] == infinity)
+        return false;
+
+    if(cell == mTargetCell)
+    {
+        sf::Vector2f toTarget = mTarget - p;
+        float toTargetLength = length(toTarget);
+        direction = toTargetLength > 0.f ? toTarget / toTargetLength : sf::Vector2f();
+        return true;
+    }
+
+    // Bilinear blend of the four cells whose centres surround p.
+    float fx = (p.x - mOrigin.x) / mCellSize - 0.5f;
+    float fy = (p.y - mOrigin.y) / mCellSize - 0.5f;
+    int x0 = std::floor(fx);
+    int y0 = std::floor(fy);
+    float tx = fx - x0;
+    float ty = fy - y0;
+
+    sf::Vector2f blended;
+    for(int dy = 0; dy < 2; dy++)
+        for(int dx = 0; dx < 2; dx++)
+        {
+            int x = x0 + dx;
+            int y = y0 + dy;
+            if(x < 0 || y < 0 || x >= mColumns || y >= mRows)
+                continue;
+
+            float weight = (dx ? tx : 1.f - tx) * (dy ? ty : 1.f - ty);
+            blended += mDirections[y * mColumns + x] * weight;
+        }
+
+    // The directions may cancel out where the field parts around an obstacle.
+    float blendedLength = length(blended);
+    direction = blendedLength > 0.001f ? blended / blendedLength : mDirections[cell];
+    return true;
+}
+
+float FlowField::getDistance(sf::Vector2f p) const
+{
+    int cell = getCell(p);
+    if(cell < 0)
+        return std::numeric_limits<float>::infinity();
+
+    return mDistances[cell];
+}
+
+sf::Vector2f FlowField::getTarget() const
+{
+    return mTarget;
+}
+
+float FlowField::getDiameter() const
+{
+    return mDiameter;
+}
+
+unsigned int FlowField::getVersion() const
+{
+    return mVersion;
+}
+
+sf::Vector2i FlowField::getGridSize() const
+{
+    return sf::Vector2i(mColumns, mRows);
+}
+
+float FlowField::getCellSize() const
+{
+    return mCellSize;
+}
+
+int FlowField::getReachedCount() const
+{
+    return mReachedCount;
+}
@@ -22,23 +22,30 @@
 
 #include "Map.hpp"
 #include "Utility.hpp"
+#include "VisibilityGraphBuilder.hpp"
+#include "NavGraphCache.hpp"
 
 #include <cassert>
+#include <algorithm>
+#include <unordered_set>
 
 ////////////////////////////////////////////////
 // SFML - Simple and Fast Media Library
 #include "SFML/Graphics/RenderTarget.hpp"
+#include "SFML/Graphics/Image.hpp"
 ////////////////////////////////////////////////
 
 
-Map::Map(const std::string& filePath)
+Map::Map(const std::string& filePath, BroadPhase::Type broadPhase)
+: mBroadPhase(broadPhase)
 {
     load(filePath);
 
     buildMap();
 }
 
-Map::Map(const std::string& filePath, sf::Vector2f size)
+Map::Map(const std::string& filePath, sf::Vector2f size, BroadPhase::Type broadPhase)
+: mBroadPhase(broadPhase)
 {
     load(filePath);
     mDrawShape.setSize(size);
@@ -49,154 +56,284 @@ Map::Map(const std::string& filePath, sf::Vector2f size)
 
 void Map::buildMap()
 {
-    std::vector<sf::Vector2f> points =
+    // Fit the image onto the draw shape, like its texture.
+    sf::Transform pixelToWorld = mDrawShape.getTransform();
+    sf::Vector2u textureSize = mTexture.getSize();
+    if(textureSize.x > 0 && textureSize.y > 0)
+        pixelToWorld.scale(mDrawShape.getSize().x / textureSize.x, mDrawShape.getSize().y / textureSize.y);
+
+    // A polygon file next to the map takes precedence over tracing the image.
+    MapLoader loader(pixelToWorld);
+    if(!loader.loadPolygonFile(mFilePath + ".poly"))
     {
-        sf::Vector2f(100, 100),
-        sf::Vector2f(200, 150),
-        sf::Vector2f(300, 100),
-        sf::Vector2f(250, 200),
-        sf::Vector2f(150, 150),
-        sf::Vector2f(100, 100),
-    };
+        sf::Image image;
+        if(image.loadFromFile(mFilePath))
+            loader.traceImage(image);
+    }
 
-    NodePtr node(new TerrainCollissionNode(points));
+    mImpassableNodes.clear();
+    for(const MapLoader::Polygon& polygon : loader.getPolygons())
+        mImpassableNodes.push_back(NodePtr(new TerrainCollissionNode(polygon)));
 
-    mImpassableNodes.push_back(std::move(node));
+    mLoadStats = loader.getStats();
 
+    numberPoints();
+    mEdgeIndex.build(mImpassableNodes);
 
-    for(auto& p : points)
-        p += sf::Vector2f(300, 10);
+    // Linking and pass widths are only computed if there is no valid cache.
+    NavGraphCache cache(mImpassableNodes);
+    const std::string navGraphPath = mFilePath + ".nav";
+    if(!cache.load(navGraphPath, mNavGraph))
+    {
+        VisibilityGraphBuilder(mEdgeIndex).build(mImpassableNodes);
 
-    mImpassableNodes.push_back(std::move(NodePtr(new TerrainCollissionNode(points))));
-/*
+        for(NodePtr& pNode : mImpassableNodes)
+            pNode->computePassWidths(mEdgeIndex);
 
-    for(auto& p : points)
-        p += sf::Vector2f(300, -10);
+        mNavGraph.compile(mImpassableNodes);
+        cache.save(navGraphPath, mNavGraph);
+    }
+    else
+        restorePaths();
 
-    mImpassableNodes.push_back(std::move(NodePtr(new TerrainCollissionNode(points))));
+    buildClearanceGraphs();
+    buildDebugPaths();
+}
 
-*/
+void Map::numberPoints()
+{
+    // Number the points so that they can be flattened into the NavGraph.
+    int pointCount = 0;
+    for(NodePtr& pNode : mImpassableNodes)
+        for(TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+            point.index = pointCount++;
+}
 
-    for(int i = 0; i < 10; i++)
-    {
+void Map::restorePaths()
+{
+    // Obstacles can only be edited with the paths in place, so recreate them from the loaded graph.
+    std::vector<std::pair<TerrainCollissionNode*, TerrainCollissionNode::Point*>> points(mNavGraph.getVertexCount());
+    for(NodePtr& pNode : mImpassableNodes)
+        for(TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+            points[point.index] = std::make_pair(pNode.get(), &point);
 
-        for(auto& p : points)
-            p += sf::Vector2f(0, 70);
+    for(int i = 0; i < mNavGraph.getVertexCount(); i++)
+        for(const NavGraph::Edge* pEdge = mNavGraph.edgesBegin(i); pEdge != mNavGraph.edgesEnd(i); pEdge++)
+            points[i].first->connectPoints(*points[i].second, *points[pEdge->to].second, pEdge->isEdge)->passWidth = pEdge->passWidth;
+}
 
-        mImpassableNodes.push_back(std::move(NodePtr(new TerrainCollissionNode(points))));
-    }
+TerrainCollissionNode* Map::insertObstacle(NodePtr pObstacle)
+{
+    TerrainCollissionNode* pNode = pObstacle.get();
+    const sf::FloatRect area = pNode->getBoundingRect();
 
-/*
+    // The new points go last, so the existing points keep their indices.
+    std::vector<int> oldIndices(mNavGraph.getVertexCount());
+    for(unsigned int i = 0; i < oldIndices.size(); i++)
+        oldIndices[i] = i;
 
-    for(unsigned int x = 0; x < 10; x++)
+    for(TerrainCollissionNode::Point& point : pNode->getConvexAngles())
     {
-        for(unsigned int y = 0; y < 10; y++)
+        point.index = oldIndices.size();
+        oldIndices.push_back(-1);
+    }
+
+    // Lines of sight that got blocked must cross the obstacle.
+    for(NodePtr& pOther : mImpassableNodes)
+        pOther->removePaths([pNode, &area](const TerrainCollissionNode::Point& from, const TerrainCollissionNode::Path& path)
         {
-            for(auto& p : points)
-                p += sf::Vector2f(300, 0);
+            // Test both directions the same way, so that no path loses its reverse.
+            sf::Vector2f a = from.pos;
+            sf::Vector2f b = path.p->pos;
+            if(from.index > path.p->index)
+                std::swap(a, b);
 
-            node = NodePtr(new TerrainCollissionNode(points));
-            mImpassableNodes.push_back(std::move(node));
-        }
+            return intersects(a, b, area) && pNode->isLineIntersecting(a, b);
+        });
 
-        for(auto& p : points)
-            p += sf::Vector2f(-300 * 10, 70);
-    }
-*/
+    mImpassableNodes.push_back(std::move(pObstacle));
+    mEdgeIndex.build(mImpassableNodes);
 
-    for(auto i = mImpassableNodes.begin(); i != mImpassableNodes.end(); i++)
-    {
-        auto j = i;
-        while(j != mImpassableNodes.end())
+    VisibilityGraphBuilder(mEdgeIndex).insert(mImpassableNodes, *pNode);
+    computePassWidths(area);
+
+    NavGraph previous = std::move(mNavGraph);
+    mNavGraph.compile(mImpassableNodes);
+    updateClearanceGraphs(previous, oldIndices);
+    buildDebugPaths();
+
+    return pNode;
+}
+
+bool Map::removeObstacle(const TerrainCollissionNode* pObstacle)
+{
+    auto found = std::find_if(mImpassableNodes.begin(), mImpassableNodes.end(), [pObstacle](const NodePtr& pNode){return pNode.get() == pObstacle;});
+    if(found == mImpassableNodes.end())
+        return false;
+
+    const sf::FloatRect area = pObstacle->getBoundingRect();
+
+    std::unordered_set<const TerrainCollissionNode::Point*> obstaclePoints;
+    for(const TerrainCollissionNode::Point& point : (*found)->getConvexAngles())
+        obstaclePoints.insert(&point);
+
+    for(NodePtr& pNode : mImpassableNodes)
+        pNode->removePaths([&obstaclePoints](const TerrainCollissionNode::Point&, const TerrainCollissionNode::Path& path)
         {
-            (*i)->connectVisiblePoints(*j, mImpassableNodes);
-            j++;
-        }
-    }
+            return obstaclePoints.count(path.p) > 0;
+        });
+
+    mImpassableNodes.erase(found);
 
+    // The points after the obstacle's move up to fill its indices.
+    std::vector<int> oldIndices;
     for(NodePtr& pNode : mImpassableNodes)
-        pNode->computePassWidths(mImpassableNodes);
+        for(TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+            oldIndices.push_back(point.index);
 
+    numberPoints();
+    mEdgeIndex.build(mImpassableNodes);
 
-    mPaths.setPrimitiveType(sf::Lines);
+    VisibilityGraphBuilder(mEdgeIndex).reconnect(mImpassableNodes, area);
+    computePassWidths(area);
 
+    NavGraph previous = std::move(mNavGraph);
+    mNavGraph.compile(mImpassableNodes);
+    updateClearanceGraphs(previous, oldIndices);
+    buildDebugPaths();
 
-    sf::Vertex p1, p2, p3, p4;
-    p1.color = sf::Color::Red;
-    p2 = p3 = p4 = p1;
+    return true;
+}
 
+void Map::computePassWidths(sf::FloatRect area)
+{
+    const float margin = TerrainCollissionNode::MAX_PASS_WIDTH;
+    area.left -= margin;
+    area.top -= margin;
+    area.width += 2.f * margin;
+    area.height += 2.f * margin;
 
     for(NodePtr& pNode : mImpassableNodes)
-        for(const TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+        for(TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+            for(TerrainCollissionNode::Path* pPath : point.paths)
+                if(intersects(point.pos, pPath->p->pos, area))
+                    pNode->computePassWidth(point, *pPath, mEdgeIndex);
+}
+
+void Map::buildClearanceGraphs()
+{
+    mClearanceGraphs.resize(NavGraph::CLEARANCE_CLASS_COUNT);
+    for(int i = 0; i < NavGraph::CLEARANCE_CLASS_COUNT; i++)
+        mClearanceGraphs[i].extract(mNavGraph, i);
+}
+
+/**
+ * \brief Get the clearance classes whose subgraph differs between before and after.
+ *
+ * Vertex i of after was vertex oldIndices[i] of before, or is new if that
+ * is -1. Bit i of the result is set if class i gained or lost an edge, or
+ * if one of its edges changed.
+ */
+static unsigned short getChangedClasses(const NavGraph& before, const NavGraph& after, const std::vector<int>& oldIndices)
+{
+    std::vector<int> newIndices(before.getVertexCount(), -1);
+    for(unsigned int i = 0; i < oldIndices.size(); i++)
+        if(oldIndices[i] >= 0)
+            newIndices[oldIndices[i]] = i;
+
+    unsigned short changed = 0;
+    auto addEdges = [&changed](const NavGraph& graph, int vertex)
+    {
+        for(const NavGraph::Edge* pEdge = graph.edgesBegin(vertex); pEdge != graph.edgesEnd(vertex); pEdge++)
+            changed |= pEdge->clearanceMask;
+    };
+
+    for(int i = 0; i < before.getVertexCount(); i++)
+        if(newIndices[i] < 0)
+            addEdges(before, i);
+
+    auto byTarget = [](const NavGraph::Edge& lhs, const NavGraph::Edge& rhs){return lhs.to < rhs.to;};
+    std::vector<NavGraph::Edge> oldEdges, newEdges;
+    for(int i = 0; i < after.getVertexCount(); i++)
+    {
+        if(oldIndices[i] < 0)
         {
-            for(const TerrainCollissionNode::Path* pPath : point.paths)
-            {
-                //if(std::find(pNode->getPoints().begin(), pNode->getPoints().end(), pPath->p->pos) != pNode->getPoints().end()=// && pPath->isEdge)//pPath->p->pos != point.next && pPath->p->pos != point.prev)
-                {
-                    /*
-                    sf::Vector2f right(pPath->direction.y, -pPath->direction.x);
-                    p1.position = point.pos - right * pPath->passWidth;
-                    p2.position = p1.position + pPath->direction * pPath->length;
-                    p3.position = p2.position + right * pPath->passWidth * 2.f;
-                    p4.position = p3.position - pPath->direction * pPath->length;
-
-                    mPaths.append(p1);
-                    mPaths.append(p2);
-                    mPaths.append(p3);
-                    mPaths.append(p4);
-                    */
-
-                    p1.position = point.pos;
-                    p2.position = pPath->p->pos;
-
-                    mPaths.append(p1);
-                    mPaths.append(p2);
-
-/*
-                    if(pPath->p->pos == point.prev)
-                    {
-                        sf::Vector2f right(pPath->direction.y, -pPath->direction.x);
-                        p1.position = point.pos - right * pPath->passWidth;
-                        p2.position = p1.position + pPath->direction * pPath->length;
-                        p3.position = p2.position + right * pPath->passWidth;
-                        p4.position = p3.position - pPath->direction * pPath->length;
-
-                        mPaths.append(p1);
-                        mPaths.append(p2);
-                        mPaths.append(p3);
-                        mPaths.append(p4);
-                    }
-
-                    */
-
-                }
-            }
+            addEdges(after, i);
+            continue;
         }
 
-/*
-    for(NodePtr& pNode : mImpassableNodes)
-        for(const TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+        // Compare the edges of the vertex in both graphs by where they lead.
+        oldEdges.assign(before.edgesBegin(oldIndices[i]), before.edgesEnd(oldIndices[i]));
+        for(NavGraph::Edge& edge : oldEdges)
+            edge.to = newIndices[edge.to];
+
+        newEdges.assign(after.edgesBegin(i), after.edgesEnd(i));
+        std::sort(oldEdges.begin(), oldEdges.end(), byTarget);
+        std::sort(newEdges.begin(), newEdges.end(), byTarget);
+
+        auto iOld = oldEdges.begin();
+        auto iNew = newEdges.begin();
+        while(iOld != oldEdges.end() || iNew != newEdges.end())
         {
-            p1.position = point.pos;
-            for(const TerrainCollissionNode::Path* pPath : point.paths)
+            if(iNew == newEdges.end() || (iOld != oldEdges.end() && iOld->to < iNew->to))
+                changed |= (iOld++)->clearanceMask;
+            else if(iOld == oldEdges.end() || iNew->to < iOld->to)
+                changed |= (iNew++)->clearanceMask;
+            else
             {
-                p2.position = pPath->p->pos;
+                if(iOld->passWidth != iNew->passWidth || iOld->isEdge != iNew->isEdge)
+                    changed |= iOld->clearanceMask | iNew->clearanceMask;
 
-                mPaths.append(p1);
-                mPaths.append(p2);
+                iOld++;
+                iNew++;
             }
         }
-*/
+    }
+
+    return changed;
 }
 
+void Map::updateClearanceGraphs(const NavGraph& previous, const std::vector<int>& oldIndices)
+{
+    const unsigned short changed = getChangedClasses(previous, mNavGraph, oldIndices);
+    for(int i = 0; i < NavGraph::CLEARANCE_CLASS_COUNT; i++)
+    {
+        if(changed & (1 << i))
+            mClearanceGraphs[i].extract(mNavGraph, i);
+        else
+            mClearanceGraphs[i].renumber(mNavGraph, oldIndices);
+    }
+}
 
-std::list<const TerrainCollissionNode::Point*> Map::getVisiblePoints(sf::Vector2f p) const
+void Map::buildDebugPaths()
 {
-    std::list<const TerrainCollissionNode::Point*> visiblePoints;
-    for(const NodePtr& pNode : mImpassableNodes)
-        pNode->getVisiblePoints(p, mImpassableNodes, visiblePoints);
+    mPaths.clear();
+    mPaths.setPrimitiveType(sf::Lines);
+
+    sf::Vertex p1, p2;
+    p1.color = sf::Color::Red;
+    p2 = p1;
+
+    for(int i = 0; i < mNavGraph.getVertexCount(); i++)
+    {
+        p1.position = mNavGraph.getVertex(i).pos;
+        for(const NavGraph::Edge* pEdge = mNavGraph.edgesBegin(i); pEdge != mNavGraph.edgesEnd(i); pEdge++)
+        {
+            p2.position = mNavGraph.getVertex(pEdge->to).pos;
+
+            mPaths.append(p1);
+            mPaths.append(p2);
+        }
+    }
+}
+
+std::vector<int> Map::getVisiblePoints(sf::Vector2f p) const
+{
+    std::vector<int> visiblePoints;
+    for(int i = 0; i < mNavGraph.getVertexCount(); i++)
+        if(!mEdgeIndex.isLineIntersecting(p, mNavGraph.getVertex(i).pos))
+            visiblePoints.push_back(i);
 
-    assert(!visiblePoints.empty());
     return visiblePoints;
 }
 
@@ -205,6 +342,31 @@ const std::list<Map::NodePtr>& Map::getImpassableTerrain() const
     return mImpassableNodes;
 }
 
+const NavGraph& Map::getNavGraph() const
+{
+    return mNavGraph;
+}
+
+const NavGraph& Map::getNavGraph(int clearanceClass) const
+{
+    return mClearanceGraphs[clearanceClass];
+}
+
+const MapLoader::Stats& Map::getLoadStats() const
+{
+    return mLoadStats;
+}
+
+const EdgeIndex& Map::getEdgeIndex() const
+{
+    return mEdgeIndex;
+}
+
+BroadPhase::Type Map::getBroadPhase() const
+{
+    return mBroadPhase;
+}
+
 void Map::draw(sf::RenderTarget& target, sf::RenderStates states) const
 {
     target.draw(mDrawShape);
@@ -227,6 +389,8 @@ sf::FloatRect Map::getBounds() const
 
 void Map::load(const std::string& filePath)
 {
+    mFilePath = filePath;
+
     mTexture.loadFromFile(filePath);
     sf::Vector2f texSize(mTexture.getSize().x, mTexture.getSize().y);
 
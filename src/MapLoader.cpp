@@ -0,0 +1,355 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "MapLoader.hpp"
+#include "Utility.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+////////////////////////////////////////////////
+
+////////////////////////////////////////////////
+// SFML - Simple and Fast Media Library
+#include "SFML/Graphics/Image.hpp"
+#include "SFML/System/Clock.hpp"
+////////////////////////////////////////////////
+
+const float MapLoader::SIMPLIFY_TOLERANCE = 0.75f;
+
+static long long getKey(sf::Vector2i p)
+{
+    // Contour points may lie half a sample outside the image.
+    return (long long)(p.y + 2) << 32 | (p.x + 2);
+}
+
+static float getSignedArea(const MapLoader::Polygon& polygon)
+{
+    // Positive for clockwise polygons, since y points down.
+    float area = 0.f;
+    for(unsigned int i = 0; i < polygon.size(); i++)
+    {
+        const sf::Vector2f& a = polygon[i];
+        const sf::Vector2f& b = polygon[(i + 1) % polygon.size()];
+        area += a.x * b.y - b.x * a.y;
+    }
+
+    return area / 2.f;
+}
+
+static float getDistanceSqrd(sf::Vector2f a, sf::Vector2f b, sf::Vector2f p)
+{
+    sf::Vector2f ab = b - a;
+    float abLengthSqrd = lengthSqrd(ab);
+    if(abLengthSqrd == 0.f)
+        return lengthSqrd(p - a);
+
+    float t = std::max(0.f, std::min(1.f, dot(p - a, ab) / abLengthSqrd));
+    return lengthSqrd(p - (a + ab * t));
+}
+
+/*
+ * Douglas-Peucker on a closed ring. The ring is split at the point
+ * farthest from its first point and both halves are simplified as
+ * open lines.
+ */
+static MapLoader::Polygon simplify(const MapLoader::Polygon& ring, float tolerance)
+{
+    const unsigned int pointCount = ring.size();
+    if(pointCount < 4)
+        return ring;
+
+    unsigned int farthest = 0;
+    float maxDistanceSqrd = 0.f;
+    for(unsigned int i = 1; i < pointCount; i++)
+    {
+        float distanceSqrd = lengthSqrd(ring[i] - ring[0]);
+        if(distanceSqrd > maxDistanceSqrd)
+        {
+            maxDistanceSqrd = distanceSqrd;
+            farthest = i;
+        }
+    }
+
+    // Index pointCount is the first point again.
+    std::vector<bool> isKept(pointCount + 1, false);
+    isKept[0] = isKept[farthest] = isKept[pointCount] = true;
+
+    std::vector<std::pair<unsigned int, unsigned int>> ranges = {std::make_pair(0u, farthest), std::make_pair(farthest, pointCount)};
+    while(!ranges.empty())
+    {
+        unsigned int first = ranges.back().first;
+        unsigned int last = ranges.back().second;
+        ranges.pop_back();
+
+        unsigned int index = first;
+        maxDistanceSqrd = tolerance * tolerance;
+        for(unsigned int i = first + 1; i < last; i++)
+        {
+            float distanceSqrd = getDistanceSqrd(ring[first], ring[last % pointCount], ring[i]);
+            if(distanceSqrd > maxDistanceSqrd)
+            {
+                maxDistanceSqrd = distanceSqrd;
+                index = i;
+            }
+        }
+
+        if(index != first)
+        {
+            isKept[index] = true;
+            ranges.push_back(std::make_pair(first, index));
+            ranges.push_back(std::make_pair(index, last));
+        }
+    }
+
+    MapLoader::Polygon simplified;
+    for(unsigned int i = 0; i < pointCount; i++)
+        if(isKept[i])
+            simplified.push_back(ring[i]);
+
+    return simplified;
+}
+
+MapLoader::MapLoader(const sf::Transform& pixelToWorld)
+: mPixelToWorld(pixelToWorld)
+, mNextChainId(0)
+{
+    mStats.polygonCount = 0;
+    mStats.vertexCount = 0;
+}
+
+bool MapLoader::loadPolygonFile(const std::string& filePath)
+{
+    std::ifstream file(filePath);
+    if(!file)
+        return false;
+
+    sf::Clock clock;
+    mPolygons.clear();
+    mStats.vertexCount = 0;
+
+    std::string line;
+    while(std::getline(file, line))
+    {
+        std::istringstream stream(line);
+        std::string first;
+        if(!(stream >> first) || first[0] == '#')
+            continue;
+
+        stream.clear();
+        stream.seekg(0);
+
+        // Count the values, since reading a lone x at the end of the line fails just like reading past it.
+        std::vector<float> values;
+        float value;
+        while(stream >> value)
+            values.push_back(value);
+
+        Polygon polygon;
+        for(unsigned int i = 0; i + 1 < values.size(); i += 2)
+            polygon.push_back(sf::Vector2f(values[i], values[i + 1]));
+
+        if(!stream.eof() || values.size() % 2 != 0 || polygon.size() < 3)
+        {
+            mPolygons.clear();
+            mStats.vertexCount = 0;
+            return false;
+        }
+
+        // Accept either winding.
+        if(getSignedArea(polygon) < 0.f)
+            std::reverse(polygon.begin(), polygon.end());
+
+        addPolygon(polygon);
+    }
+
+    mStats.polygonCount = mPolygons.size();
+    mStats.loadTime = clock.getElapsedTime();
+    return true;
+}
+
+void MapLoader::traceImage(const sf::Image& image)
+{
+    sf::Clock clock;
+    mPolygons.clear();
+    mStats.vertexCount = 0;
+
+    const sf::Vector2u size = image.getSize();
+    const sf::Uint8* pPixels = image.getPixelsPtr();
+
+    // Everything outside the image is passable, so that contours touching the border close.
+    auto isImpassable = [size, pPixels](int x, int y)
+    {
+        if(x < 0 || y < 0 || x >= (int)size.x || y >= (int)size.y)
+            return false;
+
+        const sf::Uint8* pPixel = pPixels + 4 * (y * size.x + x);
+        return pPixel[3] >= 128 && (pPixel[0] + pPixel[1] + pPixel[2]) / 3u < IMPASSABLE_LUMINANCE;
+    };
+
+    /*
+     * Cell (x, y) lies between the samples (x - 1, y - 1) and (x, y).
+     * Segments are directed with the impassable side on their right,
+     * so outlines come out clockwise and holes counter clockwise.
+     */
+    const int cellsX = size.x + 1;
+    const int cellsY = size.y + 1;
+    for(int tileTop = 0; tileTop < cellsY; tileTop += TILE_SIZE)
+        for(int tileLeft = 0; tileLeft < cellsX; tileLeft += TILE_SIZE)
+            for(int cellY = tileTop; cellY < std::min<int>(tileTop + TILE_SIZE, cellsY); cellY++)
+                for(int cellX = tileLeft; cellX < std::min<int>(tileLeft + TILE_SIZE, cellsX); cellX++)
+                {
+                    const int x = cellX - 1;
+                    const int y = cellY - 1;
+
+                    int type = isImpassable(x, y)
+                             | isImpassable(x + 1, y) << 1
+                             | isImpassable(x + 1, y + 1) << 2
+                             | isImpassable(x, y + 1) << 3;
+
+                    // Midpoints of the cell's sides, at twice the sample resolution.
+                    const sf::Vector2i top(2 * x + 1, 2 * y);
+                    const sf::Vector2i right(2 * x + 2, 2 * y + 1);
+                    const sf::Vector2i bottom(2 * x + 1, 2 * y + 2);
+                    const sf::Vector2i left(2 * x, 2 * y + 1);
+
+                    switch(type)
+                    {
+                        case 1:     addSegment(top, left);      break;
+                        case 2:     addSegment(right, top);     break;
+                        case 3:     addSegment(right, left);    break;
+                        case 4:     addSegment(bottom, right);  break;
+                        case 5:     addSegment(top, left);
+                                    addSegment(bottom, right);  break; // Diagonal corners are kept apart.
+                        case 6:     addSegment(bottom, top);    break;
+                        case 7:     addSegment(bottom, left);   break;
+                        case 8:     addSegment(left, bottom);   break;
+                        case 9:     addSegment(top, bottom);    break;
+                        case 10:    addSegment(right, top);
+                                    addSegment(left, bottom);   break;
+                        case 11:    addSegment(right, bottom);  break;
+                        case 12:    addSegment(left, right);    break;
+                        case 13:    addSegment(top, right);     break;
+                        case 14:    addSegment(left, top);      break;
+                        default:    break;
+                    }
+                }
+
+    mChains.clear();
+    mChainStarts.clear();
+    mChainEnds.clear();
+
+    mStats.polygonCount = mPolygons.size();
+    mStats.loadTime = clock.getElapsedTime();
+}
+
+void MapLoader::addSegment(sf::Vector2i from, sf::Vector2i to)
+{
+    auto ending = mChainEnds.find(getKey(from));
+    auto starting = mChainStarts.find(getKey(to));
+
+    if(ending != mChainEnds.end() && starting != mChainStarts.end())
+    {
+        int endingId = ending->second;
+        int startingId = starting->second;
+        mChainEnds.erase(ending);
+        mChainStarts.erase(starting);
+
+        if(endingId == startingId)
+        {
+            closeChain(mChains[endingId]);
+            mChains.erase(endingId);
+            return;
+        }
+
+        // Join the two chains.
+        Chain& chain = mChains[endingId];
+        Chain& next = mChains[startingId];
+        chain.insert(chain.end(), next.begin(), next.end());
+        mChainEnds[getKey(next.back())] = endingId;
+        mChains.erase(startingId);
+    }
+    else if(ending != mChainEnds.end())
+    {
+        int id = ending->second;
+        mChainEnds.erase(ending);
+        mChains[id].push_back(to);
+        mChainEnds[getKey(to)] = id;
+    }
+    else if(starting != mChainStarts.end())
+    {
+        int id = starting->second;
+        mChainStarts.erase(starting);
+        mChains[id].push_front(from);
+        mChainStarts[getKey(from)] = id;
+    }
+    else
+    {
+        int id = mNextChainId++;
+        Chain& chain = mChains[id];
+        chain.push_back(from);
+        chain.push_back(to);
+        mChainStarts[getKey(from)] = id;
+        mChainEnds[getKey(to)] = id;
+    }
+}
+
+void MapLoader::closeChain(const Chain& chain)
+{
+    // From doubled sample coordinates to pixel coordinates, samples being at pixel centres.
+    Polygon ring;
+    ring.reserve(chain.size());
+    for(sf::Vector2i p : chain)
+        ring.push_back(sf::Vector2f(p.x / 2.f + 0.5f, p.y / 2.f + 0.5f));
+
+    Polygon polygon = simplify(ring, SIMPLIFY_TOLERANCE);
+    if(polygon.size() < 3)
+        return;
+
+    for(sf::Vector2f& p : polygon)
+        p = mPixelToWorld.transformPoint(p);
+
+    // Skip holes in the terrain, they cannot be reached anyway.
+    if(getSignedArea(polygon) <= 0.f)
+        return;
+
+    addPolygon(polygon);
+}
+
+void MapLoader::addPolygon(const Polygon& polygon)
+{
+    mPolygons.push_back(polygon);
+    mStats.vertexCount += polygon.size();
+}
+
+const std::vector<MapLoader::Polygon>& MapLoader::getPolygons() const
+{
+    return mPolygons;
+}
+
+const MapLoader::Stats& MapLoader::getStats() const
+{
+    return mStats;
+}
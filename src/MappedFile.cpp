@@ -0,0 +1,156 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "MappedFile.hpp"
+
+#ifdef _WIN32
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+
+MappedFile::MappedFile()
+: mData(nullptr)
+, mSize(0)
+#ifdef _WIN32
+, mFile(INVALID_HANDLE_VALUE)
+, mMapping(nullptr)
+#endif
+{
+
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+#ifdef _WIN32
+
+bool MappedFile::open(const std::string& filePath)
+{
+    close();
+
+    mFile = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if(mFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(mFile, &size) || size.QuadPart == 0)
+    {
+        close();
+        return false;
+    }
+
+    mMapping = CreateFileMappingA(mFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(!mMapping)
+    {
+        close();
+        return false;
+    }
+
+    mData = static_cast<const char*>(MapViewOfFile(mMapping, FILE_MAP_READ, 0, 0, 0));
+    if(!mData)
+    {
+        close();
+        return false;
+    }
+
+    mSize = size.QuadPart;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(mData)
+        UnmapViewOfFile(mData);
+
+    if(mMapping)
+        CloseHandle(mMapping);
+
+    if(mFile != INVALID_HANDLE_VALUE)
+        CloseHandle(mFile);
+
+    mData = nullptr;
+    mSize = 0;
+    mMapping = nullptr;
+    mFile = INVALID_HANDLE_VALUE;
+}
+
+#else
+
+bool MappedFile::open(const std::string& filePath)
+{
+    close();
+
+    int file = ::open(filePath.c_str(), O_RDONLY);
+    if(file < 0)
+        return false;
+
+    struct stat status;
+    if(fstat(file, &status) != 0 || status.st_size == 0)
+    {
+        ::close(file);
+        return false;
+    }
+
+    // The mapping stays valid after the file is closed.
+    void* pData = mmap(nullptr, status.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+    ::close(file);
+
+    if(pData == MAP_FAILED)
+        return false;
+
+    mData = static_cast<const char*>(pData);
+    mSize = status.st_size;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if(mData)
+        munmap(const_cast<char*>(mData), mSize);
+
+    mData = nullptr;
+    mSize = 0;
+}
+
+#endif
+
+bool MappedFile::isOpen() const
+{
+    return mData != nullptr;
+}
+
+const char* MappedFile::getData() const
+{
+    return mData;
+}
+
+std::size_t MappedFile::getSize() const
+{
+    return mSize;
+}
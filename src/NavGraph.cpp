@@ -0,0 +1,282 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "NavGraph.hpp"
+#include "TerrainCollissionNode.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cassert>
+#include <cmath>
+#include <unordered_map>
+////////////////////////////////////////////////
+
+int NavGraph::getClearanceClass(float diameter)
+{
+    int clearanceClass = 0;
+    while(clearanceClass < CLEARANCE_CLASS_COUNT - 1 && diameter > getClassDiameter(clearanceClass))
+        clearanceClass++;
+
+    return clearanceClass;
+}
+
+float NavGraph::getClassDiameter(int clearanceClass)
+{
+    return 2.f * std::pow(2.f, clearanceClass / 2.f);
+}
+
+NavGraph::NavGraph()
+: mEdgeOffsets(1, 0)
+, mVersion(0)
+{
+
+}
+
+void NavGraph::compile(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes)
+{
+    clear();
+
+    int vertexCount = 0;
+    int edgeCount = 0;
+    for(const std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
+        for(const TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+        {
+            vertexCount++;
+            edgeCount += point.paths.size();
+        }
+
+    mVertices.resize(vertexCount);
+    mEdgeOffsets.assign(vertexCount + 1, 0);
+    mEdges.reserve(edgeCount);
+
+    // Count the edges of each vertex.
+    for(const std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
+        for(const TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+        {
+            assert(point.index >= 0 && point.index < vertexCount);
+
+            Vertex& vertex = mVertices[point.index];
+            vertex.pos = point.pos;
+            vertex.bisector = point.bisector;
+
+            mEdgeOffsets[point.index + 1] = point.paths.size();
+        }
+
+    for(int i = 0; i < vertexCount; i++)
+        mEdgeOffsets[i + 1] += mEdgeOffsets[i];
+
+    mEdges.resize(edgeCount);
+    for(const std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
+        for(const TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+        {
+            Edge* pEdge = &mEdges[mEdgeOffsets[point.index]];
+            for(const TerrainCollissionNode::Path* pPath : point.paths)
+            {
+                pEdge->to = pPath->p->index;
+                pEdge->length = pPath->length;
+                pEdge->direction = pPath->direction;
+                pEdge->passWidth = pPath->passWidth;
+                pEdge->isEdge = pPath->isEdge;
+                pEdge->clearanceMask = getClearanceMask(*pEdge);
+                pEdge++;
+            }
+        }
+
+    linkReverseEdges();
+}
+
+void NavGraph::linkReverseEdges()
+{
+    const int vertexCount = mVertices.size();
+
+    // Link opposite edges, so that searches can walk the graph backwards.
+    std::unordered_map<unsigned long long, int> edgeIndices;
+    edgeIndices.reserve(mEdges.size());
+    for(int from = 0; from < vertexCount; from++)
+        for(int i = mEdgeOffsets[from]; i < mEdgeOffsets[from + 1]; i++)
+            edgeIndices[(unsigned long long)from << 32 | mEdges[i].to] = i;
+
+    for(int from = 0; from < vertexCount; from++)
+        for(int i = mEdgeOffsets[from]; i < mEdgeOffsets[from + 1]; i++)
+        {
+            auto found = edgeIndices.find((unsigned long long)mEdges[i].to << 32 | from);
+            mEdges[i].reverse = found != edgeIndices.end() ? found->second : -1;
+        }
+}
+
+void NavGraph::clear()
+{
+    mVertices.clear();
+    mEdgeOffsets.assign(1, 0);
+    mEdges.clear();
+    mVersion++;
+}
+
+void NavGraph::assign(std::vector<Vertex> vertices, std::vector<int> edgeOffsets, std::vector<Edge> edges)
+{
+    assert(edgeOffsets.size() == vertices.size() + 1);
+    assert(edgeOffsets.back() == (int)edges.size());
+
+    mVertices.swap(vertices);
+    mEdgeOffsets.swap(edgeOffsets);
+    mEdges.swap(edges);
+    mVersion++;
+
+    for(Edge& edge : mEdges)
+        edge.clearanceMask = getClearanceMask(edge);
+}
+
+void NavGraph::extract(const NavGraph& graph, int clearanceClass)
+{
+    const unsigned short classBit = 1 << clearanceClass;
+
+    mVertices = graph.mVertices;
+    mEdgeOffsets.assign(1, 0);
+    mEdges.clear();
+
+    mEdgeOffsets.reserve(graph.mEdgeOffsets.size());
+    std::vector<int> newEdgeIndices(graph.mEdges.size(), -1);
+    for(int i = 0; i < graph.getVertexCount(); i++)
+    {
+        for(int j = graph.mEdgeOffsets[i]; j < graph.mEdgeOffsets[i + 1]; j++)
+            if(graph.mEdges[j].clearanceMask & classBit)
+            {
+                newEdgeIndices[j] = mEdges.size();
+                mEdges.push_back(graph.mEdges[j]);
+            }
+
+        mEdgeOffsets.push_back(mEdges.size());
+    }
+
+    // An edge keeps its reverse if that fits the class too, which saves linking them again.
+    for(Edge& edge : mEdges)
+        if(edge.reverse >= 0)
+            edge.reverse = newEdgeIndices[edge.reverse];
+
+    mVersion = graph.mVersion;
+}
+
+void NavGraph::renumber(const NavGraph& graph, const std::vector<int>& oldIndices)
+{
+    assert(oldIndices.size() == graph.mVertices.size());
+
+    std::vector<int> newIndices(mVertices.size(), -1);
+    for(int i = 0; i < (int)oldIndices.size(); i++)
+        if(oldIndices[i] >= 0)
+            newIndices[oldIndices[i]] = i;
+
+    // Edges keep their order within a vertex, so only the blocks move.
+    std::vector<int> edgeOffsets(1, 0);
+    std::vector<Edge> edges;
+    std::vector<int> newEdgeIndices(mEdges.size(), -1);
+    edgeOffsets.reserve(oldIndices.size() + 1);
+    edges.reserve(mEdges.size());
+
+    for(int oldIndex : oldIndices)
+    {
+        if(oldIndex >= 0)
+            for(int i = mEdgeOffsets[oldIndex]; i < mEdgeOffsets[oldIndex + 1]; i++)
+            {
+                newEdgeIndices[i] = edges.size();
+                edges.push_back(mEdges[i]);
+                edges.back().to = newIndices[mEdges[i].to];
+                assert(edges.back().to >= 0);
+            }
+
+        edgeOffsets.push_back(edges.size());
+    }
+
+    assert(edges.size() == mEdges.size());
+    for(Edge& edge : edges)
+        if(edge.reverse >= 0)
+            edge.reverse = newEdgeIndices[edge.reverse];
+
+    mVertices = graph.mVertices;
+    mEdgeOffsets.swap(edgeOffsets);
+    mEdges.swap(edges);
+    mVersion = graph.mVersion;
+}
+
+unsigned short NavGraph::getClearanceMask(const Edge& edge)
+{
+    // Edges run along the terrain, so the whole body must fit beside them.
+    // Other paths pass between terrain and may use the space on both sides.
+    const float width = edge.isEdge ? edge.passWidth : 2.f * edge.passWidth;
+
+    unsigned short mask = 0;
+    for(int i = 0; i < CLEARANCE_CLASS_COUNT; i++)
+        if(getClassDiameter(i) < width)
+            mask |= 1 << i;
+
+    return mask;
+}
+
+int NavGraph::getVertexCount() const
+{
+    return mVertices.size();
+}
+
+int NavGraph::getEdgeCount() const
+{
+    return mEdges.size();
+}
+
+const NavGraph::Vertex& NavGraph::getVertex(int index) const
+{
+    return mVertices[index];
+}
+
+const NavGraph::Edge* NavGraph::edgesBegin(int vertex) const
+{
+    return mEdges.data() + mEdgeOffsets[vertex];
+}
+
+const NavGraph::Edge* NavGraph::edgesEnd(int vertex) const
+{
+    return mEdges.data() + mEdgeOffsets[vertex + 1];
+}
+
+const NavGraph::Edge& NavGraph::getEdge(int index) const
+{
+    return mEdges[index];
+}
+
+unsigned int NavGraph::getVersion() const
+{
+    return mVersion;
+}
+
+const std::vector<NavGraph::Vertex>& NavGraph::getVertices() const
+{
+    return mVertices;
+}
+
+const std::vector<int>& NavGraph::getEdgeOffsets() const
+{
+    return mEdgeOffsets;
+}
+
+const std::vector<NavGraph::Edge>& NavGraph::getEdges() const
+{
+    return mEdges;
+}
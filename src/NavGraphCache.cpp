@@ -0,0 +1,220 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "NavGraphCache.hpp"
+#include "NavGraph.hpp"
+#include "MappedFile.hpp"
+#include "TerrainCollissionNode.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+////////////////////////////////////////////////
+
+static const char MAGIC[4] = {'T', 'N', 'A', 'V'};
+
+static void hashBytes(uint64_t& hash, const void* pData, std::size_t size)
+{
+    const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+    for(std::size_t i = 0; i < size; i++)
+    {
+        hash ^= pBytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+// Copy a record out of the mapping, which gives no alignment guarantees.
+template<typename T>
+static const char* read(const char* pData, T& value)
+{
+    std::memcpy(&value, pData, sizeof(T));
+    return pData + sizeof(T);
+}
+
+template<typename T>
+static void write(std::ofstream& file, const T& value)
+{
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+NavGraphCache::NavGraphCache(const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes)
+: mHash(14695981039346656037ULL)
+{
+    uint32_t nodeCount = nodes.size();
+    hashBytes(mHash, &nodeCount, sizeof(nodeCount));
+
+    for(const std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
+    {
+        const std::vector<sf::Vector2f>& points = pNode->getPoints();
+
+        uint32_t pointCount = points.size();
+        hashBytes(mHash, &pointCount, sizeof(pointCount));
+        for(sf::Vector2f point : points)
+        {
+            hashBytes(mHash, &point.x, sizeof(point.x));
+            hashBytes(mHash, &point.y, sizeof(point.y));
+        }
+
+        mBounds.push_back(pNode->getBoundingRect());
+    }
+}
+
+std::size_t NavGraphCache::getFileSize(const Header& header)
+{
+    return sizeof(Header)
+        + sizeof(VertexRecord) * header.vertexCount
+        + sizeof(int32_t) * (header.vertexCount + 1)
+        + sizeof(EdgeRecord) * header.edgeCount
+        + sizeof(BoundsRecord) * header.nodeCount;
+}
+
+bool NavGraphCache::load(const std::string& filePath, NavGraph& navGraph) const
+{
+    MappedFile file;
+    if(!file.open(filePath) || file.getSize() < sizeof(Header))
+        return false;
+
+    Header header;
+    const char* pData = read(file.getData(), header);
+
+    if(     std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+        ||  header.version != VERSION
+        ||  header.hash != mHash
+        ||  header.nodeCount != mBounds.size()
+        ||  file.getSize() != getFileSize(header))
+        return false;
+
+    std::vector<NavGraph::Vertex> vertices(header.vertexCount);
+    for(NavGraph::Vertex& vertex : vertices)
+    {
+        VertexRecord record;
+        pData = read(pData, record);
+
+        vertex.pos = sf::Vector2f(record.x, record.y);
+        vertex.bisector = sf::Vector2f(record.bisectorX, record.bisectorY);
+    }
+
+    std::vector<int> edgeOffsets(header.vertexCount + 1);
+    for(int& offset : edgeOffsets)
+    {
+        int32_t record;
+        pData = read(pData, record);
+        offset = record;
+    }
+
+    if(edgeOffsets.front() != 0 || edgeOffsets.back() != (int)header.edgeCount)
+        return false;
+
+    for(unsigned int i = 0; i < header.vertexCount; i++)
+        if(edgeOffsets[i] > edgeOffsets[i + 1])
+            return false;
+
+    std::vector<NavGraph::Edge> edges(header.edgeCount);
+    for(NavGraph::Edge& edge : edges)
+    {
+        EdgeRecord record;
+        pData = read(pData, record);
+
+        if(record.to < 0 || record.to >= (int)header.vertexCount || record.reverse < -1 || record.reverse >= (int)header.edgeCount)
+            return false;
+
+        edge.to = record.to;
+        edge.reverse = record.reverse;
+        edge.length = record.length;
+        edge.direction = sf::Vector2f(record.directionX, record.directionY);
+        edge.passWidth = record.passWidth;
+        edge.isEdge = record.isEdge != 0;
+    }
+
+    for(const sf::FloatRect& bounds : mBounds)
+    {
+        BoundsRecord record;
+        pData = read(pData, record);
+
+        if(bounds != sf::FloatRect(record.left, record.top, record.width, record.height))
+            return false;
+    }
+
+    navGraph.assign(std::move(vertices), std::move(edgeOffsets), std::move(edges));
+    return true;
+}
+
+bool NavGraphCache::save(const std::string& filePath, const NavGraph& navGraph) const
+{
+    // Write to a temporary file first, so that a failed write never leaves a broken cache.
+    const std::string tempPath = filePath + ".tmp";
+
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if(!file)
+            return false;
+
+        Header header;
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.hash = mHash;
+        header.vertexCount = navGraph.getVertexCount();
+        header.edgeCount = navGraph.getEdgeCount();
+        header.nodeCount = mBounds.size();
+        header.padding = 0;
+        write(file, header);
+
+        for(const NavGraph::Vertex& vertex : navGraph.getVertices())
+        {
+            VertexRecord record = {vertex.pos.x, vertex.pos.y, vertex.bisector.x, vertex.bisector.y};
+            write(file, record);
+        }
+
+        for(int offset : navGraph.getEdgeOffsets())
+        {
+            int32_t record = offset;
+            write(file, record);
+        }
+
+        for(const NavGraph::Edge& edge : navGraph.getEdges())
+        {
+            EdgeRecord record = {edge.to, edge.reverse, edge.length, edge.direction.x, edge.direction.y, edge.passWidth, edge.isEdge};
+            write(file, record);
+        }
+
+        for(const sf::FloatRect& bounds : mBounds)
+        {
+            BoundsRecord record = {bounds.left, bounds.top, bounds.width, bounds.height};
+            write(file, record);
+        }
+
+        if(!file)
+            return false;
+    }
+
+    // std::rename does not replace existing files on every platform.
+    std::remove(filePath.c_str());
+    return std::rename(tempPath.c_str(), filePath.c_str()) == 0;
+}
+
+uint64_t NavGraphCache::getHash() const
+{
+    return mHash;
+}
@@ -0,0 +1,306 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "NavHierarchy.hpp"
+#include "NavGraph.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cmath>
+#include <limits>
+#include <queue>
+#include <functional>
+#include <algorithm>
+#include <cassert>
+////////////////////////////////////////////////
+
+const float NavHierarchy::CLUSTER_SIZE = 512.f;
+
+NavHierarchy::NavHierarchy()
+: mClusterOffsets(1, 0)
+, mLinkOffsets(1, 0)
+, mClusterSize(CLUSTER_SIZE)
+, mColumns(0)
+, mRows(0)
+, mVersion(0)
+{
+
+}
+
+void NavHierarchy::build(const NavGraph& graph, float clusterSize)
+{
+    const int vertexCount = graph.getVertexCount();
+
+    mVersion = graph.getVersion();
+    mClusterSize = clusterSize;
+    mVertexClusters.assign(vertexCount, 0);
+    mVertexPortals.assign(vertexCount, -1);
+    mPortalVertices.clear();
+    mLinkOffsets.assign(1, 0);
+    mLinks.clear();
+
+    sf::Vector2f min(std::numeric_limits<float>::max(), std::numeric_limits<float>::max());
+    sf::Vector2f max(-min);
+    for(int i = 0; i < vertexCount; i++)
+    {
+        sf::Vector2f pos = graph.getVertex(i).pos;
+        min.x = std::min(min.x, pos.x);
+        min.y = std::min(min.y, pos.y);
+        max.x = std::max(max.x, pos.x);
+        max.y = std::max(max.y, pos.y);
+    }
+
+    if(vertexCount == 0)
+    {
+        mOrigin = sf::Vector2f();
+        mColumns = 0;
+        mRows = 0;
+        mClusterOffsets.assign(1, 0);
+        mClusterVertices.clear();
+        return;
+    }
+
+    mOrigin = min;
+    mColumns = (max.x - min.x) / mClusterSize + 1;
+    mRows = (max.y - min.y) / mClusterSize + 1;
+
+    // Sort the vertices by cluster.
+    const int clusterCount = mColumns * mRows;
+    mClusterOffsets.assign(clusterCount + 1, 0);
+    for(int i = 0; i < vertexCount; i++)
+    {
+        sf::Vector2i coords = getClusterCoords(graph.getVertex(i).pos);
+        mVertexClusters[i] = coords.y * mColumns + coords.x;
+        mClusterOffsets[mVertexClusters[i] + 1]++;
+    }
+
+    for(int i = 0; i < clusterCount; i++)
+        mClusterOffsets[i + 1] += mClusterOffsets[i];
+
+    mClusterVertices.resize(vertexCount);
+    std::vector<int> fill(mClusterOffsets.begin(), mClusterOffsets.end() - 1);
+    for(int i = 0; i < vertexCount; i++)
+        mClusterVertices[fill[mVertexClusters[i]]++] = i;
+
+    // Both ends of an edge between two clusters are portals.
+    for(int i = 0; i < vertexCount; i++)
+        for(const NavGraph::Edge* pEdge = graph.edgesBegin(i); pEdge != graph.edgesEnd(i); pEdge++)
+            if(mVertexClusters[i] != mVertexClusters[pEdge->to])
+            {
+                mVertexPortals[i] = 0;
+                mVertexPortals[pEdge->to] = 0;
+            }
+
+    for(int i = 0; i < vertexCount; i++)
+        if(mVertexPortals[i] == 0)
+        {
+            mVertexPortals[i] = mPortalVertices.size();
+            mPortalVertices.push_back(i);
+        }
+
+    for(int i = 0; i < getPortalCount(); i++)
+    {
+        linkPortal(graph, i);
+        mLinkOffsets.push_back(mLinks.size());
+    }
+}
+
+void NavHierarchy::linkPortal(const NavGraph& graph, int portal)
+{
+    const int vertex = mPortalVertices[portal];
+    const int cluster = mVertexClusters[vertex];
+
+    for(const NavGraph::Edge* pEdge = graph.edgesBegin(vertex); pEdge != graph.edgesEnd(vertex); pEdge++)
+        if(mVertexClusters[pEdge->to] != cluster)
+        {
+            Link link = {mVertexPortals[pEdge->to], pEdge->length, true};
+            mLinks.push_back(link);
+        }
+
+    // The costs through the cluster to its other portals.
+    ClusterSearch search;
+    searchClusters(graph, Seeds(1, std::make_pair(vertex, 0.f)), false, search);
+
+    for(const int* pVertex = verticesBegin(cluster); pVertex != verticesEnd(cluster); pVertex++)
+    {
+        if(*pVertex == vertex || mVertexPortals[*pVertex] < 0)
+            continue;
+
+        auto found = search.find(*pVertex);
+        if(found == search.end())
+            continue;
+
+        Link link = {mVertexPortals[*pVertex], found->second.distance, false};
+        mLinks.push_back(link);
+    }
+}
+
+void NavHierarchy::searchClusters(const NavGraph& graph, const Seeds& seeds, bool isBackwards, ClusterSearch& search) const
+{
+    typedef std::pair<float, int> OpenNode;
+    std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> openSet;
+
+    search.clear();
+    for(const std::pair<int, float>& seed : seeds)
+    {
+        auto inserted = search.insert(std::make_pair(seed.first, Step()));
+        Step& step = inserted.first->second;
+        if(!inserted.second && step.distance <= seed.second)
+            continue;
+
+        step.distance = seed.second;
+        step.next = -1;
+        step.isClosed = false;
+        openSet.push(OpenNode(seed.second, seed.first));
+    }
+
+    while(!openSet.empty())
+    {
+        const int index = openSet.top().second;
+        openSet.pop();
+
+        // Elements of an unordered_map stay put when it grows.
+        Step& step = search[index];
+        if(step.isClosed)
+            continue;
+
+        step.isClosed = true;
+
+        for(const NavGraph::Edge* pEdge = graph.edgesBegin(index); pEdge != graph.edgesEnd(index); pEdge++)
+        {
+            if(mVertexClusters[pEdge->to] != mVertexClusters[index])
+                continue;
+
+            // Walking backwards, the edge taken is the one coming from pEdge->to.
+            float cost = pEdge->length;
+            if(isBackwards)
+            {
+                if(pEdge->reverse < 0)
+                    continue;
+
+                cost = graph.getEdge(pEdge->reverse).length;
+            }
+
+            const float distance = step.distance + cost;
+            auto inserted = search.insert(std::make_pair(pEdge->to, Step()));
+            Step& neighbor = inserted.first->second;
+            if(!inserted.second && (neighbor.isClosed || neighbor.distance <= distance))
+                continue;
+
+            neighbor.distance = distance;
+            neighbor.next = index;
+            neighbor.isClosed = false;
+            openSet.push(OpenNode(distance, pEdge->to));
+        }
+    }
+}
+
+bool NavHierarchy::findRoute(const NavGraph& graph, int from, int to, std::vector<int>& corners) const
+{
+    assert(mVertexClusters[from] == mVertexClusters[to]);
+
+    ClusterSearch search;
+    searchClusters(graph, Seeds(1, std::make_pair(from, 0.f)), false, search);
+
+    corners.clear();
+    auto found = search.find(to);
+    if(found == search.end())
+        return false;
+
+    for(int index = found->second.next; index != from; index = search[index].next)
+        corners.push_back(index);
+
+    std::reverse(corners.begin(), corners.end());
+
+    return true;
+}
+
+sf::Vector2i NavHierarchy::getClusterCoords(sf::Vector2f pos) const
+{
+    int column = std::floor((pos.x - mOrigin.x) / mClusterSize);
+    int row = std::floor((pos.y - mOrigin.y) / mClusterSize);
+
+    return sf::Vector2i(std::max(0, std::min(mColumns - 1, column)), std::max(0, std::min(mRows - 1, row)));
+}
+
+void NavHierarchy::getClusters(sf::Vector2f pos, int radius, std::vector<int>& clusters) const
+{
+    clusters.clear();
+    if(mColumns == 0 || mRows == 0)
+        return;
+
+    sf::Vector2i coords = getClusterCoords(pos);
+    for(int row = std::max(0, coords.y - radius); row <= std::min(mRows - 1, coords.y + radius); row++)
+        for(int column = std::max(0, coords.x - radius); column <= std::min(mColumns - 1, coords.x + radius); column++)
+            clusters.push_back(row * mColumns + column);
+}
+
+int NavHierarchy::getClusterCount() const
+{
+    return mColumns * mRows;
+}
+
+int NavHierarchy::getCluster(int vertex) const
+{
+    return mVertexClusters[vertex];
+}
+
+const int* NavHierarchy::verticesBegin(int cluster) const
+{
+    return mClusterVertices.data() + mClusterOffsets[cluster];
+}
+
+const int* NavHierarchy::verticesEnd(int cluster) const
+{
+    return mClusterVertices.data() + mClusterOffsets[cluster + 1];
+}
+
+int NavHierarchy::getPortalCount() const
+{
+    return mPortalVertices.size();
+}
+
+int NavHierarchy::getPortal(int vertex) const
+{
+    return mVertexPortals[vertex];
+}
+
+int NavHierarchy::getPortalVertex(int portal) const
+{
+    return mPortalVertices[portal];
+}
+
+const NavHierarchy::Link* NavHierarchy::linksBegin(int portal) const
+{
+    return mLinks.data() + mLinkOffsets[portal];
+}
+
+const NavHierarchy::Link* NavHierarchy::linksEnd(int portal) const
+{
+    return mLinks.data() + mLinkOffsets[portal + 1];
+}
+
+unsigned int NavHierarchy::getVersion() const
+{
+    return mVersion;
+}
@@ -0,0 +1,183 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+
+#include "PathCache.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cmath>
+////////////////////////////////////////////////
+
+PathCache::Route::Route()
+: first(-1)
+{
+
+}
+
+PathCache::Metrics::Metrics()
+: hits(0)
+, misses(0)
+, size(0)
+, capacity(0)
+, hitRate(0.f)
+{
+
+}
+
+bool PathCache::Key::operator==(const Key& other) const
+{
+    return start == other.start && goal == other.goal && clearanceClass == other.clearanceClass;
+}
+
+size_t PathCache::KeyHash::operator()(const Key& key) const
+{
+    size_t hash = key.start.x;
+    hash = hash * 31 + key.start.y;
+    hash = hash * 31 + key.goal.x;
+    hash = hash * 31 + key.goal.y;
+    return hash * 31 + key.clearanceClass;
+}
+
+const float PathCache::REGION_SIZE = 32.f;
+
+PathCache::PathCache(unsigned int capacity)
+: mCapacity(capacity)
+, mVersion(0)
+, mHits(0)
+, mMisses(0)
+{
+    mLookup.reserve(capacity);
+}
+
+sf::Vector2i PathCache::getRegion(sf::Vector2f pos)
+{
+    return sf::Vector2i(std::floor(pos.x / REGION_SIZE), std::floor(pos.y / REGION_SIZE));
+}
+
+bool PathCache::get(const Key& key, unsigned int version, Route& route)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    setVersion(version);
+
+    auto found = mLookup.find(key);
+    if(found == mLookup.end())
+    {
+        mMisses++;
+        return false;
+    }
+
+    // Move it to the front.
+    mEntries.splice(mEntries.begin(), mEntries, found->second);
+    route = found->second->second;
+    mHits++;
+
+    return true;
+}
+
+bool PathCache::find(const Key& key, unsigned int version, Route& route)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    setVersion(version);
+
+    auto found = mLookup.find(key);
+    if(found == mLookup.end())
+    {
+        mMisses++;
+        return false;
+    }
+
+    route = found->second->second;
+    mHits++;
+
+    return true;
+}
+
+void PathCache::touch(const Key& key, unsigned int version)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    setVersion(version);
+
+    auto found = mLookup.find(key);
+    if(found != mLookup.end())
+        mEntries.splice(mEntries.begin(), mEntries, found->second);
+}
+
+void PathCache::insert(const Key& key, unsigned int version, const Route& route)
+{
+    if(mCapacity == 0)
+        return;
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    setVersion(version);
+
+    auto found = mLookup.find(key);
+    if(found != mLookup.end())
+    {
+        found->second->second = route;
+        mEntries.splice(mEntries.begin(), mEntries, found->second);
+        return;
+    }
+
+    if(mEntries.size() >= mCapacity)
+    {
+        mLookup.erase(mEntries.back().first);
+        mEntries.pop_back();
+    }
+
+    mEntries.push_front(std::make_pair(key, route));
+    mLookup[key] = mEntries.begin();
+}
+
+void PathCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    mEntries.clear();
+    mLookup.clear();
+}
+
+void PathCache::setVersion(unsigned int version)
+{
+    if(version == mVersion)
+        return;
+
+    mEntries.clear();
+    mLookup.clear();
+    mVersion = version;
+}
+
+PathCache::Metrics PathCache::getMetrics() const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+
+    Metrics metrics;
+    metrics.hits = mHits;
+    metrics.misses = mMisses;
+    metrics.size = mEntries.size();
+    metrics.capacity = mCapacity;
+
+    if(mHits + mMisses > 0)
+        metrics.hitRate = (float)mHits / (mHits + mMisses);
+
+    return metrics;
+}
@@ -0,0 +1,250 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "PathRequestQueue.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <algorithm>
+#include <cassert>
+////////////////////////////////////////////////
+
+PathRequestQueue::Metrics::Metrics()
+: queueDepth(0)
+, expansions(0)
+, medianLatency(0.f)
+, p99Latency(0.f)
+{
+
+}
+
+PathRequestQueue::Result::Result()
+: isSolved(false)
+, expansions(0)
+{
+
+}
+
+PathRequestQueue::PathRequestQueue(const Pathfinder& pathfinder, unsigned int expansionBudget, unsigned int workerCount)
+: mPathfinder(pathfinder)
+, mExpansionBudget(expansionBudget)
+, mNextHandle(1)
+, mNextRequest(0)
+, mInProgress(0)
+, mExpansions(0)
+, mIsSolving(false)
+, mIsStopping(false)
+, mLatencyIndex(0)
+{
+    // The simulation thread waits while the workers solve, so one per core.
+    if(workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency());
+
+    mLatencies.reserve(LATENCY_SAMPLES);
+
+    for(unsigned int i = 0; i < workerCount; i++)
+        mWorkers.push_back(std::thread(&PathRequestQueue::work, this));
+}
+
+PathRequestQueue::~PathRequestQueue()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mCondition.notify_all();
+
+    for(std::thread& worker : mWorkers)
+        worker.join();
+}
+
+PathRequestQueue::Handle PathRequestQueue::request(float diameter, sf::Vector2f pos, sf::Vector2f destination, Callback callback)
+{
+    Request request;
+    request.diameter = diameter;
+    request.pos = pos;
+    request.destination = destination;
+    request.enqueueTime = mClock.getElapsedTime();
+
+    std::lock_guard<std::mutex> lock(mMutex);
+    request.handle = mNextHandle++;
+
+    // Skip 0 if the handles wrap around.
+    if(mNextHandle == 0)
+        mNextHandle++;
+
+    mCallbacks[request.handle] = callback;
+    mRequests.push_back(request);
+
+    return request.handle;
+}
+
+void PathRequestQueue::cancel(Handle handle)
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    if(mCallbacks.erase(handle) == 0)
+        return;
+
+    // The workers pick requests up by index while solving, so the
+    // result is dropped by update() then instead.
+    if(mIsSolving)
+        return;
+
+    auto isCancelled = [handle](const Request& request){return request.handle == handle;};
+    mRequests.erase(std::remove_if(mRequests.begin(), mRequests.end(), isCancelled), mRequests.end());
+}
+
+bool PathRequestQueue::isPending(Handle handle) const
+{
+    std::lock_guard<std::mutex> lock(mMutex);
+    return mCallbacks.find(handle) != mCallbacks.end();
+}
+
+void PathRequestQueue::update()
+{
+    std::vector<Result> results;
+    std::vector<Handle> handles;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mResults.clear();
+        mNextRequest = 0;
+        mIsSolving = true;
+        mCondition.notify_all();
+
+        // Take the results in request order, so that the budget always ends at the same request.
+        unsigned int solvedCount = 0;
+        unsigned int expansions = 0;
+        while(solvedCount < mRequests.size() && expansions < mExpansionBudget)
+        {
+            mCondition.wait(lock, [this, solvedCount](){return solvedCount < mResults.size() && mResults[solvedCount].isSolved;});
+            expansions += mResults[solvedCount].expansions;
+            solvedCount++;
+        }
+
+        // Requests after those are solved again next tick, when the cache may have changed.
+        mIsSolving = false;
+        mCondition.wait(lock, [this](){return mInProgress == 0;});
+
+        mResults.resize(solvedCount);
+        results.swap(mResults);
+        mExpansions = expansions;
+
+        for(unsigned int i = 0; i < solvedCount; i++)
+            handles.push_back(mRequests[i].handle);
+
+        mRequests.erase(mRequests.begin(), mRequests.begin() + solvedCount);
+    }
+
+    for(Result& result : results)
+        mPathfinder.applyCacheUse(result.cacheUse);
+
+    for(unsigned int i = 0; i < results.size(); i++)
+    {
+        Callback callback;
+        {
+            // An earlier callback may have cancelled it.
+            std::lock_guard<std::mutex> lock(mMutex);
+            auto found = mCallbacks.find(handles[i]);
+            if(found == mCallbacks.end())
+                continue;
+
+            // Erase before calling, since the callback may issue a new request.
+            callback = found->second;
+            mCallbacks.erase(found);
+        }
+
+        // Called without the lock, so that it can request and cancel.
+        callback(results[i].path, results[i].remainder);
+    }
+}
+
+void PathRequestQueue::work()
+{
+    std::unique_lock<std::mutex> lock(mMutex);
+    while(true)
+    {
+        mCondition.wait(lock, [this](){return mIsStopping || (mIsSolving && mNextRequest < mRequests.size());});
+
+        if(mIsStopping)
+            return;
+
+        unsigned int index = mNextRequest++;
+        Request request = mRequests[index];
+        if(mResults.size() <= index)
+            mResults.resize(index + 1);
+
+        mInProgress++;
+
+        lock.unlock();
+
+        Result result;
+        result.path = mPathfinder.getPath(request.diameter, request.pos, request.destination, &result.expansions, &result.remainder, &result.cacheUse);
+        result.isSolved = true;
+
+        sf::Time latency = mClock.getElapsedTime() - request.enqueueTime;
+
+        lock.lock();
+
+        mInProgress--;
+        mResults[index] = std::move(result);
+        recordLatency(latency);
+
+        // update() is waiting for this result, or for the last request in progress.
+        mCondition.notify_all();
+    }
+}
+
+void PathRequestQueue::recordLatency(sf::Time latency)
+{
+    if(mLatencies.size() < LATENCY_SAMPLES)
+        mLatencies.push_back(latency.asSeconds());
+    else
+        mLatencies[mLatencyIndex] = latency.asSeconds();
+
+    mLatencyIndex = (mLatencyIndex + 1) % LATENCY_SAMPLES;
+}
+
+PathRequestQueue::Metrics PathRequestQueue::getMetrics() const
+{
+    Metrics metrics;
+    std::vector<float> latencies;
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        metrics.queueDepth = mRequests.size();
+        metrics.expansions = mExpansions;
+        latencies = mLatencies;
+    }
+
+    if(latencies.empty())
+        return metrics;
+
+    auto median = latencies.begin() + latencies.size() / 2;
+    std::nth_element(latencies.begin(), median, latencies.end());
+    metrics.medianLatency = *median;
+
+    auto p99 = latencies.begin() + (latencies.size() * 99) / 100;
+    std::nth_element(latencies.begin(), p99, latencies.end());
+    metrics.p99Latency = *p99;
+
+    return metrics;
+}
@@ -35,22 +35,79 @@
 #include <cmath>
 #include <cassert>
 #include <limits>
+#include <queue>
+#include <vector>
+#include <functional>
+#include <algorithm>
 ////////////////////////////////////////////////
 
-Pathfinder::Pathfinder(const Map& map)
+const float Pathfinder::HIERARCHY_DISTANCE = 3.f * 512.f; // Three clusters.
+const float Pathfinder::CHASE_REPAIR_DISTANCE = 512.f; // One cluster.
+
+Pathfinder::Pathfinder(const Map& map, unsigned int pathCacheSize)
 : mMap(map)
+, mPathCache(pathCacheSize)
+, mHierarchyDistance(HIERARCHY_DISTANCE)
+, mHierarchies(NavGraph::CLEARANCE_CLASS_COUNT)
+{
+
+}
+
+Pathfinder::SearchNode::SearchNode()
+: distanceTravelled(std::numeric_limits<float>::max())
+, pEdge(nullptr)
+, parent(-1)
+, isClosed(false)
+{
+
+}
+
+Pathfinder::OpenNode::OpenNode(float f, int index)
+: f(f)
+, index(index)
+{
+
+}
+
+bool Pathfinder::OpenNode::operator>(const OpenNode& other) const
+{
+    return f > other.f;
+}
+
+Pathfinder::CacheUse::CacheUse()
+: isHit(false)
+, isNew(false)
+, version(0)
+{
+
+}
+
+Pathfinder::Chase::Chase(float diameter)
+: diameter(diameter)
+, version(0)
+, keyModifier(0.f)
+{
+
+}
+
+int Pathfinder::Chase::getGoal() const
 {
+    return goalCosts.size();
+}
 
+int Pathfinder::Chase::getStart() const
+{
+    return goalCosts.size() + 1;
 }
 
-Pathfinder::PathNode::PathNode(float distanceTravelled, float distanceLeft, std::list<PathNode>::iterator iParent, const TerrainCollissionNode::Point* pPoint)
-: distanceTravelled(distanceTravelled)
-, distanceLeft(distanceLeft)
-, iParent(iParent)
-, pPoint(pPoint)
-, pPath(nullptr)
+bool Pathfinder::Chase::Key::operator<(const Key& other) const
 {
+    return primary < other.primary || (primary == other.primary && secondary < other.secondary);
+}
 
+bool Pathfinder::Chase::Key::operator==(const Key& other) const
+{
+    return primary == other.primary && secondary == other.secondary;
 }
 
 Pathfinder::Waypoint::Waypoint(sf::Vector2f from, sf::Vector2f to)
@@ -61,641 +118,976 @@ Pathfinder::Waypoint::Waypoint(sf::Vector2f from, sf::Vector2f to)
     direction = dVec / distance;
 }
 
-Pathfinder::Waypoint::Waypoint(const TerrainCollissionNode::Path* pPath)
-: destination(pPath->p->pos)
-, distance(pPath->length)
-, direction(pPath->direction)
+void Pathfinder::draw(sf::RenderTarget& target) const
 {
-
 }
 
-float Pathfinder::PathNode::f()
+bool Pathfinder::pathIsObstructed(sf::Vector2f from, sf::Vector2f to) const
 {
-    return distanceTravelled + distanceLeft;
+    return mMap.getEdgeIndex().isLineIntersecting(from, to);
 }
 
-void Pathfinder::draw(sf::RenderTarget& target) const
+void Pathfinder::setHierarchyDistance(float distance)
 {
+    mHierarchyDistance = distance;
 }
 
-bool Pathfinder::lineIntersectsRect(sf::Vector2f p1, sf::Vector2f p2, sf::FloatRect rect) const
+std::list<Pathfinder::Waypoint> Pathfinder::getPath(float diameter, sf::Vector2f pos, sf::Vector2f destination, unsigned int* pExpansions, AbstractPathPtr* pRemainder, CacheUse* pCacheUse) const
 {
-    float rectRight = rect.left + rect.width;
-    float rectBot = rect.top + rect.height;
+    std::list<Waypoint> wayPoints;
 
+    if(!pathIsObstructed(pos, destination))
+    {
+        wayPoints.push_back(Waypoint(pos, destination));
+        return wayPoints;
+    }
 
-    if(p1.x < rect.left && p2.x < rect.left)
-        return false;
-    if(p1.x > rectRight && p2.x > rectRight)
-        return false;
+    PathCache::Key key;
+    key.start = PathCache::getRegion(pos);
+    key.goal = PathCache::getRegion(destination);
+    key.clearanceClass = NavGraph::getClearanceClass(diameter);
 
-    if(p1.y < rect.top && p2.y < rect.top)
-        return false;
-    if(p1.y > rectBot && p2.y > rectBot)
-        return false;
+    // Every edge of the subgraph fits the unit.
+    const NavGraph& graph = mMap.getNavGraph(key.clearanceClass);
+    const unsigned int version = graph.getVersion();
 
+    PathCache::Route route;
+    bool isCached = pCacheUse ? mPathCache.find(key, version, route) : mPathCache.get(key, version, route);
+    if(!isCached || !cutCorners(graph, route, pos, destination))
+    {
+        // Long paths are found over the portals, and refined as the unit gets there.
+        AbstractPathPtr pPath(new AbstractPath());
+        pPath->diameter = diameter;
+        if(length(destination - pos) > mHierarchyDistance && findAbstractRoute(key.clearanceClass, pos, destination, *pPath, pExpansions))
+        {
+            wayPoints = refinePath(*pPath);
+            if(pRemainder && !pPath->corners.empty())
+                *pRemainder = pPath;
 
-    sf::Vector2f halfRectSize(rect.width / 2, rect.height / 2);
-    sf::Vector2f rectCenter(rect.left + halfRectSize.x, rect.top + halfRectSize.y);
+            while(!pRemainder && !pPath->corners.empty())
+                wayPoints.splice(wayPoints.end(), refinePath(*pPath));
 
-    if(     intersects(p1, p2, sf::Vector2f(rect.left, rect.top), sf::Vector2f(rectRight, rectBot))
-        ||  intersects(p1, p2, sf::Vector2f(rectRight, rect.top), sf::Vector2f(rect.left, rectBot))
-       )
-       return true;
-    else
-        return false;
+            return wayPoints;
+        }
 
+        // No route fits.
+        if(!findRoute(graph, pos, destination, route, pExpansions))
+            return wayPoints;
 
-    float rectRadiusSqrd = (halfRectSize.x + halfRectSize.y) * (halfRectSize.x + halfRectSize.y);
-    sf::Vector2f dVec = p1 - rectCenter;
-    float dSqrd = dVec.x * dVec.x + dVec.y * dVec.y;
-    if(dSqrd < rectRadiusSqrd)
-        return true;
+        if(pCacheUse)
+        {
+            pCacheUse->isNew = true;
+            pCacheUse->key = key;
+            pCacheUse->version = version;
+            pCacheUse->route = route;
+        }
+        else
+            mPathCache.insert(key, version, route);
+    }
+    else if(pCacheUse)
+    {
+        pCacheUse->isHit = true;
+        pCacheUse->key = key;
+        pCacheUse->version = version;
+    }
 
-    dVec = p2 - rectCenter;
-    dSqrd = dVec.x * dVec.x + dVec.y * dVec.y;
-    if(dSqrd < rectRadiusSqrd)
-        return true;
+    std::vector<int> corners(1, route.first);
+    for(int edgeIndex : route.edges)
+        corners.push_back(graph.getEdge(edgeIndex).to);
 
-    return false;
+    return smoothPath(graph, corners, diameter, pos, destination);
 }
 
-float Pathfinder::getF(PathPtr pPath, sf::Vector2f target) const
+bool Pathfinder::cutCorners(const NavGraph& graph, PathCache::Route& route, sf::Vector2f pos, sf::Vector2f destination) const
 {
-    // F = G + H
-    // G = length of path
-    // H = distance from path's point to target.
-    return pPath->lengthSqrd + lengthSqrd(target - pPath->p->pos);
-}
+    std::vector<int> corners(1, route.first);
+    for(int edgeIndex : route.edges)
+        corners.push_back(graph.getEdge(edgeIndex).to);
+
+    /*
+     * The route was found for other positions in the same regions. Enter
+     * it at the last corner pos can see and leave it at the first corner
+     * after that which can see destination. Skipping corners never makes
+     * the route longer.
+     */
+    int first = corners.size() - 1;
+    while(first >= 0 && pathIsObstructed(pos, graph.getVertex(corners[first]).pos))
+        first--;
+
+    if(first < 0)
+        return false;
 
-float Pathfinder::getF(sf::Vector2f start, sf::Vector2f p, sf::Vector2f target) const
-{
-    // F = G + H
-    // G = length of path
-    // H = distance from path's point to target.
-    return lengthSqrd(p - start) + lengthSqrd(p - target);
-}
+    int last = first;
+    while(last < (int)corners.size() && pathIsObstructed(graph.getVertex(corners[last]).pos, destination))
+        last++;
 
-bool Pathfinder::pathIsObstructed(sf::Vector2f from, sf::Vector2f to) const
-{
-    for(const Map::NodePtr& pNode : mMap.getImpassableTerrain())
-        if(lineIntersectsRect(from, to, pNode->getBoundingRect()) && pNode->isLineIntersecting(from, to))
-            return true;
+    if(last == (int)corners.size())
+        return false;
 
-    return false;
-}
+    route.first = corners[first];
+    route.edges = std::vector<int>(route.edges.begin() + first, route.edges.begin() + last);
 
+    return true;
+}
 
-Pathfinder::PointPtr Pathfinder::findSmallestF(sf::Vector2f pos, sf::Vector2f destination, std::list<PointPtr> points) const
+bool Pathfinder::findRoute(const NavGraph& graph, sf::Vector2f pos, sf::Vector2f destination, PathCache::Route& route, unsigned int* pExpansions) const
 {
-    assert(!points.empty());
-
-    float minF = std::numeric_limits<float>::max();
-    PointPtr pMinPoint = points.front();
-    for(PointPtr pPoint : points)
+    /*
+     * A* over the visibility graph. The start and destination positions
+     * are not vertices of the graph, so they are connected to it through
+     * the vertices visible from them. The destination is represented by
+     * goalIndex in the open set, which is only pushed through vertices
+     * that can see it.
+     */
+    const int goalIndex = graph.getVertexCount();
+
+    std::vector<SearchNode> nodes(goalIndex + 1);
+    std::vector<float> distancesToGoal(goalIndex, -1.f); // Negative if destination is not visible.
+    std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> openSet;
+
+    for(int i : mMap.getVisiblePoints(destination))
+        distancesToGoal[i] = length(destination - graph.getVertex(i).pos);
+
+    for(int i : mMap.getVisiblePoints(pos))
     {
-        float f = getF(pos, pPoint->pos, destination);
-        if(f < minF)
-        {
-            minF = f;
-            pMinPoint = pPoint;
-        }
+        sf::Vector2f vertexPos = graph.getVertex(i).pos;
+        float distanceTravelled = length(vertexPos - pos);
+
+        nodes[i].distanceTravelled = distanceTravelled;
+        openSet.push(OpenNode(distanceTravelled + length(destination - vertexPos), i));
     }
 
-    return pMinPoint;
-}
+    while(!openSet.empty())
+    {
+        const int index = openSet.top().index;
+        openSet.pop();
 
-Pathfinder::PathPtr Pathfinder::findSmallestF(float diameter, sf::Vector2f destination, std::list<TerrainCollissionNode::Path*> paths) const
-{
-    assert(!paths.empty());
+        SearchNode& node = nodes[index];
+        if(node.isClosed)
+            continue;
 
-    float minF = std::numeric_limits<float>::max();
-    PathPtr pMinPath = paths.front();
-    for(PathPtr pPath : paths)
-    {
+        node.isClosed = true;
+
+        if(index == goalIndex)
+            break;
 
-        bool fitsPath = pPath->isEdge ? diameter < pPath->passWidth : diameter / 2 < pPath->passWidth;
+        if(pExpansions)
+            (*pExpansions)++;
 
-        if(fitsPath)
+        // Try to reach the destination directly from this vertex.
+        if(distancesToGoal[index] >= 0.f)
         {
-            float f = getF(pPath, destination);
-            if(f < minF)
+            SearchNode& goal = nodes[goalIndex];
+            float distanceTravelled = node.distanceTravelled + distancesToGoal[index];
+            if(distanceTravelled < goal.distanceTravelled)
             {
-                minF = f;
-                pMinPath = pPath;
+                goal.distanceTravelled = distanceTravelled;
+                goal.parent = index;
+                openSet.push(OpenNode(distanceTravelled, goalIndex));
+            }
+        }
+
+        for(const NavGraph::Edge* pEdge = graph.edgesBegin(index); pEdge != graph.edgesEnd(index); pEdge++)
+        {
+            SearchNode& neighbor = nodes[pEdge->to];
+            if(neighbor.isClosed)
+                continue;
+
+            float distanceTravelled = node.distanceTravelled + pEdge->length;
+            if(distanceTravelled < neighbor.distanceTravelled)
+            {
+                neighbor.distanceTravelled = distanceTravelled;
+                neighbor.parent = index;
+                neighbor.pEdge = pEdge;
+
+                // H is the euclidean distance left, which never overestimates.
+                openSet.push(OpenNode(distanceTravelled + length(destination - graph.getVertex(pEdge->to).pos), pEdge->to));
             }
         }
     }
 
-    return pMinPath;
-}
+    if(!nodes[goalIndex].isClosed)
+        return false;
+
+    // Trace the route backwards from the destination.
+    route.edges.clear();
+
+    int index = nodes[goalIndex].parent;
+    while(nodes[index].pEdge)
+    {
+        route.edges.push_back(nodes[index].pEdge - graph.getEdges().data());
+        index = nodes[index].parent;
+    }
 
+    route.first = index;
+    std::reverse(route.edges.begin(), route.edges.end());
 
+    return true;
+}
 
-std::list<Pathfinder::Waypoint> Pathfinder::getPath(float diameter, sf::Vector2f pos, sf::Vector2f destination)
+std::shared_ptr<const NavHierarchy> Pathfinder::getHierarchy(int clearanceClass) const
 {
-    std::list<Waypoint> wayPoints;
+    const NavGraph& graph = mMap.getNavGraph(clearanceClass);
 
-    if(pathIsObstructed(pos, destination))
+    std::lock_guard<std::mutex> lock(mHierarchyMutex);
+    std::shared_ptr<const NavHierarchy>& pHierarchy = mHierarchies[clearanceClass];
+    if(!pHierarchy || pHierarchy->getVersion() != graph.getVersion())
     {
-        std::list<PointPtr> visibleGoalPoints = mMap.getVisiblePoints(destination);
-        PointPtr goal = findSmallestF(pos, destination, visibleGoalPoints);
+        // Paths being refined keep the old hierarchy alive until they notice the new version.
+        std::shared_ptr<NavHierarchy> pBuilt(new NavHierarchy());
+        pBuilt->build(graph);
+        pHierarchy = pBuilt;
+    }
 
-        std::list<PointPtr> visibleStartPoints = mMap.getVisiblePoints(pos);
-        PointPtr start = findSmallestF(pos, goal->pos, visibleStartPoints);
+    return pHierarchy;
+}
 
-        sf::Vector2f goalPos = goal->pos;
-        auto sortComparator = [&](PathPtr a, PathPtr b)
-        {
-            return getF(a, goalPos) < getF(b, goalPos);
-        };
+bool Pathfinder::findAbstractRoute(int clearanceClass, sf::Vector2f pos, sf::Vector2f destination, AbstractPath& path, unsigned int* pExpansions) const
+{
+    const NavGraph& graph = mMap.getNavGraph(clearanceClass);
+    std::shared_ptr<const NavHierarchy> pHierarchy = getHierarchy(clearanceClass);
+    const NavHierarchy& hierarchy = *pHierarchy;
 
+    if(hierarchy.getPortalCount() == 0)
+        return false;
 
-        bool hasReachedGoal = false;
-        int count = 0;
-        std::list<PathPtr> breadCrumbs;
-        std::list<PointPtr> visitedPoints;
+    // Join the ends to the vertices they see in the clusters around them.
+    NavHierarchy::Seeds startSeeds, goalSeeds;
+    std::vector<int> clusters;
 
-        std::function<void(PointPtr point)> heuristicDFS;
-        heuristicDFS = [&](PointPtr point)
-        {
-            visitedPoints.push_front(point);
+    hierarchy.getClusters(pos, CLUSTER_RADIUS, clusters);
+    for(int cluster : clusters)
+        for(const int* pVertex = hierarchy.verticesBegin(cluster); pVertex != hierarchy.verticesEnd(cluster); pVertex++)
+            if(!pathIsObstructed(pos, graph.getVertex(*pVertex).pos))
+                startSeeds.push_back(std::make_pair(*pVertex, length(graph.getVertex(*pVertex).pos - pos)));
 
-            std::list<TerrainCollissionNode::Path*> paths = point->paths;
-            paths.sort(sortComparator);
+    hierarchy.getClusters(destination, CLUSTER_RADIUS, clusters);
+    for(int cluster : clusters)
+        for(const int* pVertex = hierarchy.verticesBegin(cluster); pVertex != hierarchy.verticesEnd(cluster); pVertex++)
+            if(!pathIsObstructed(graph.getVertex(*pVertex).pos, destination))
+                goalSeeds.push_back(std::make_pair(*pVertex, length(destination - graph.getVertex(*pVertex).pos)));
 
-            sf::Vector2f front = paths.front()->p->pos - goalPos;
-            sf::Vector2f back = paths.back()->p->pos - goalPos;
+    if(startSeeds.empty() || goalSeeds.empty())
+        return false;
 
-            for(PathPtr path : paths)
-            {
-                count++;
-                if(hasReachedGoal)
-                    return;
+    NavHierarchy::ClusterSearch startSearch, goalSearch;
+    hierarchy.searchClusters(graph, startSeeds, false, startSearch);
+    hierarchy.searchClusters(graph, goalSeeds, true, goalSearch);
 
-                breadCrumbs.push_back(path);
+    if(pExpansions)
+        (*pExpansions) += startSearch.size() + goalSearch.size();
 
-                if(path->p->pos == goalPos || count >= 5000)
-                {
-                    hasReachedGoal = true;
-                    return;
-                }
+    // The ends may already meet without leaving their clusters.
+    int meeting = -1;
+    float bestDistance = std::numeric_limits<float>::max();
+    for(const auto& step : startSearch)
+    {
+        auto found = goalSearch.find(step.first);
+        if(found != goalSearch.end() && step.second.distance + found->second.distance < bestDistance)
+        {
+            bestDistance = step.second.distance + found->second.distance;
+            meeting = step.first;
+        }
+    }
 
-                if(std::find(visitedPoints.begin(), visitedPoints.end(), path->p) == visitedPoints.end())
-                    heuristicDFS(path->p);
-                if(hasReachedGoal)
-                    return;
+    /*
+     * A* over the portals, entered at the portals the start search
+     * reached. The destination is represented by goalIndex, which is
+     * pushed from the portals the goal search reached.
+     */
+    const int goalIndex = hierarchy.getPortalCount();
+    std::vector<float> distances(goalIndex + 1, std::numeric_limits<float>::max());
+    std::vector<int> parents(goalIndex + 1, -1); // -1 if entered from the start search.
+    std::vector<bool> isParentLinkRefined(goalIndex, true);
+    std::vector<bool> isClosed(goalIndex + 1, false);
+    std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> openSet;
+
+    distances[goalIndex] = bestDistance;
+    if(meeting >= 0)
+        openSet.push(OpenNode(bestDistance, goalIndex));
+
+    for(const auto& step : startSearch)
+    {
+        int portal = hierarchy.getPortal(step.first);
+        if(portal < 0)
+            continue;
 
-                breadCrumbs.pop_back();
-            }
+        distances[portal] = step.second.distance;
+        openSet.push(OpenNode(step.second.distance + length(destination - graph.getVertex(step.first).pos), portal));
+    }
 
+    while(!openSet.empty())
+    {
+        const int index = openSet.top().index;
+        openSet.pop();
 
-        };
+        if(isClosed[index])
+            continue;
 
-        heuristicDFS(start);
+        isClosed[index] = true;
 
+        if(index == goalIndex)
+            break;
 
+        if(pExpansions)
+            (*pExpansions)++;
 
-        auto it = breadCrumbs.end();
-        it--;
-        while(it != breadCrumbs.begin())
+        auto found = goalSearch.find(hierarchy.getPortalVertex(index));
+        if(found != goalSearch.end() && distances[index] + found->second.distance < distances[goalIndex])
         {
-            if(std::find(visibleStartPoints.begin(), visibleStartPoints.end(), (*it)->p) != visibleStartPoints.end())
-            {
-                start = (*it)->p;
-                it++;
-                breadCrumbs.erase(breadCrumbs.begin(), it);
-                break;
-            }
-            it--;
+            distances[goalIndex] = distances[index] + found->second.distance;
+            parents[goalIndex] = index;
+            openSet.push(OpenNode(distances[goalIndex], goalIndex));
         }
 
-
-        for(it = breadCrumbs.begin(); it != breadCrumbs.end(); it++)
+        for(const NavHierarchy::Link* pLink = hierarchy.linksBegin(index); pLink != hierarchy.linksEnd(index); pLink++)
         {
-            if(std::find(visibleGoalPoints.begin(), visibleGoalPoints.end(), (*it)->p) != visibleGoalPoints.end())
-            {
-                it++;
-                breadCrumbs.erase(it, breadCrumbs.end());
-                break;
-            }
-        }
-/*
-        for(it = breadCrumbs.begin(); it != breadCrumbs.end(); it++)
-        {
-            for(PathPtr p : goal->paths)
+            if(isClosed[pLink->to])
+                continue;
+
+            float distance = distances[index] + pLink->cost;
+            if(distance < distances[pLink->to])
             {
-                if(p->p == (*it)->p)
-                {
-                    it++;
-                    breadCrumbs.erase(it, breadCrumbs.end());
-                    break;
-                }
+                distances[pLink->to] = distance;
+                parents[pLink->to] = index;
+                isParentLinkRefined[pLink->to] = pLink->isInterCluster;
+
+                sf::Vector2f portalPos = graph.getVertex(hierarchy.getPortalVertex(pLink->to)).pos;
+                openSet.push(OpenNode(distance + length(destination - portalPos), pLink->to));
             }
         }
-*/
-/*
-        for(it = breadCrumbs.begin(); it != breadCrumbs.end(); it++)
-        {
-            PointPtr point = (*it)->p;
+    }
 
-            auto it2 = breadCrumbs.end();
-            it2--;
-            while(it2 != it)
-            {
-                for(PathPtr path : point->paths)
-                {
+    // Neither the portals nor the clusters around the ends join them.
+    if(distances[goalIndex] == std::numeric_limits<float>::max())
+        return false;
 
-                    if(path->p->pos == (*it2)->p->pos)
-                    {
-                        PathPtr path1 = *it;
-                        PathPtr path2 = *it2;
+    std::vector<int> portals;
+    for(int portal = parents[goalIndex]; portal >= 0; portal = parents[portal])
+        portals.push_back(portal);
 
+    std::reverse(portals.begin(), portals.end());
 
-                        *it = path;
+    const int first = portals.empty() ? meeting : hierarchy.getPortalVertex(portals.front());
+    const int last = portals.empty() ? meeting : hierarchy.getPortalVertex(portals.back());
 
-                        while(it2 != it)
-                            breadCrumbs.erase(it2--);
-                        it2++;
+    path.start = pos;
+    path.isStartCorner = false;
+    path.destination = destination;
+    path.version = graph.getVersion();
 
-                        break;
-                    }
-                }
+    // Into the portals along the start search, through them, and out along the goal search.
+    path.corners.clear();
+    for(int index = first; index >= 0; index = startSearch[index].next)
+        path.corners.push_front(index);
 
-                it2--;
-            }
+    path.isRefined.assign(path.corners.size(), true);
 
+    for(unsigned int i = 1; i < portals.size(); i++)
+    {
+        path.isRefined.back() = isParentLinkRefined[portals[i]];
+        path.corners.push_back(hierarchy.getPortalVertex(portals[i]));
+        path.isRefined.push_back(true);
+    }
 
+    for(int index = goalSearch[last].next; index >= 0; index = goalSearch[index].next)
+    {
+        path.corners.push_back(index);
+        path.isRefined.push_back(true);
+    }
+
+    return true;
+}
+
+std::list<Pathfinder::Waypoint> Pathfinder::refinePath(AbstractPath& path) const
+{
+    const int clearanceClass = NavGraph::getClearanceClass(path.diameter);
+    const NavGraph& graph = mMap.getNavGraph(clearanceClass);
+
+    if(path.corners.empty())
+        return std::list<Waypoint>();
+
+    std::shared_ptr<const NavHierarchy> pHierarchy = getHierarchy(clearanceClass);
+    bool isStale = path.version != graph.getVersion();
+
+    /*
+     * Find the routes through the clusters the next few corners cross,
+     * up to and including the one leaving the corner at end, which is
+     * where these waypoints stop.
+     */
+    std::vector<int> route;
+    unsigned int end = 0;
+    while(!isStale && end + 1 < path.corners.size())
+    {
+        if(!path.isRefined[end])
+        {
+            isStale = !pHierarchy->findRoute(graph, path.corners[end], path.corners[end + 1], route);
+            path.corners.insert(path.corners.begin() + end + 1, route.begin(), route.end());
+            path.isRefined.insert(path.isRefined.begin() + end + 1, route.size(), true);
+            path.isRefined[end] = true;
         }
-        */
 
-        for(PathPtr path : breadCrumbs)
-            wayPoints.push_back(Waypoint(path));
+        if(end + 1 == REFINED_CORNERS)
+            break;
 
-        /*if(!wayPoints.empty())
-        wayPoints.pop_front();
-        if(!wayPoints.empty())
-        wayPoints.pop_back();
-*/
-        wayPoints.push_front(Waypoint(pos, start->pos));
+        end++;
+    }
 
-        if(breadCrumbs.empty())
-            wayPoints.push_back(Waypoint(start->pos, destination));
-        else
-            wayPoints.push_back(Waypoint(breadCrumbs.back()->p->pos, destination));
+    if(isStale)
+    {
+        // Units refine their paths while updating in parallel, so the cache is only read.
+        CacheUse cacheUse;
+        std::list<Waypoint> wayPoints = getPath(path.diameter, path.start, path.destination, nullptr, nullptr, &cacheUse);
+        path.corners.clear();
+        path.isRefined.clear();
 
+        return wayPoints;
+    }
 
-        //PointPtr goal = findSmallestF(pos, destination, mMap.getVisiblePoints(destination));
-        //PointPtr start = findSmallestF(pos, goal->pos, mMap.getVisiblePoints(pos));
+    // The last corner of the path is followed by the destination.
+    if(end + 1 == path.corners.size())
+    {
+        std::vector<int> corners(path.corners.begin(), path.corners.end());
+        path.corners.clear();
+        path.isRefined.clear();
 
-        // Code in here might get used later on.
-        {
-            /*
-            typedef const TerrainCollissionNode::Point* PointPtr;
-            std::list<const TerrainCollissionNode*> intersectingNodes;
-            std::list<PointPtr> entries;
-            std::list<PointPtr> exits;
-            for(const Map::NodePtr& pNode : mImpassableTerrain)
-            {
-                std::pair<PointPtr, PointPtr> entry, exit;
-                if(lineIntersectsRect(pos, destination, pNode->getBoundingRect()) && pNode->isLineIntersecting(pos, destination, entry, exit))
-                {
-                    intersectingNodes.push_back(pNode.get());
-                    entries.push_back(entry.first);
-                    entries.push_back(entry.second);
-                    exits.push_back(exit.first);
-                    exits.push_back(exit.second);
-                }
-            }
+        return smoothPath(graph, corners, path.diameter, path.start, path.destination, path.isStartCorner, false);
+    }
 
-            if(intersectingNodes.empty())
-            {
-                Waypoint wp;
-                wp.destination = destination;
+    // Stop at a corner, so that the next waypoints can carry on from it.
+    std::vector<int> corners(path.corners.begin(), path.corners.begin() + end);
+    sf::Vector2f stop = graph.getVertex(path.corners[end]).pos;
+    std::list<Waypoint> wayPoints = smoothPath(graph, corners, path.diameter, path.start, stop, path.isStartCorner, true);
 
-                sf::Vector2f dVec = destination - pos;
-                float d = sqrt(dVec.x * dVec.x + dVec.y * dVec.y);
+    path.start = stop;
+    path.isStartCorner = true;
+    path.corners.erase(path.corners.begin(), path.corners.begin() + end + 1);
+    path.isRefined.erase(path.isRefined.begin(), path.isRefined.begin() + end + 1);
 
-                wp.distance = d;
-                wp.direction = dVec / d;
+    return wayPoints;
+}
 
-                return {wp};
-            }
+Pathfinder::SearchTreePtr Pathfinder::getSearchTree(float diameter, sf::Vector2f destination) const
+{
+    const NavGraph& graph = mMap.getNavGraph();
+    const int vertexCount = graph.getVertexCount();
+    const unsigned short classBit = 1 << NavGraph::getClearanceClass(diameter);
+
+    std::shared_ptr<SearchTree> pTree(new SearchTree());
+    pTree->destination = destination;
+    pTree->diameter = diameter;
+    pTree->version = graph.getVersion();
+    pTree->distances.assign(vertexCount, std::numeric_limits<float>::max());
+    pTree->edges.assign(vertexCount, nullptr);
+
+    /*
+     * Dijkstra from the destination, walking edges backwards. An edge
+     * u -> v is relaxed from v's side, so clearance is checked on the
+     * direction entities will actually move in. That may not fit when
+     * v -> u does, which is why the full graph is walked rather than
+     * the subgraph of the clearance class.
+     */
+    std::vector<bool> isClosed(vertexCount, false);
+    std::priority_queue<OpenNode, std::vector<OpenNode>, std::greater<OpenNode>> openSet;
+
+    for(int i : mMap.getVisiblePoints(destination))
+    {
+        pTree->distances[i] = length(destination - graph.getVertex(i).pos);
+        openSet.push(OpenNode(pTree->distances[i], i));
+    }
 
+    while(!openSet.empty())
+    {
+        const int index = openSet.top().index;
+        openSet.pop();
 
-            auto comparatorStart = [pos](PointPtr a, PointPtr b)
-            {
-                return lengthSqrd(a->pos - pos) < lengthSqrd(b->pos - pos);
-            };
-            PointPtr start = *std::min_element(entries.begin(), entries.end(), comparatorStart);
+        if(isClosed[index])
+            continue;
 
-            auto comparatorGoal = [destination](PointPtr a, PointPtr b)
-            {
-                return lengthSqrd(a->pos - destination) < lengthSqrd(b->pos - destination);
-            };
-            PointPtr goal = *std::max_element(exits.begin(), exits.end(), comparatorGoal);
-            */
-
-            /*
-            float minSqrd = 99999999999999;
-            float dSqrd;
-            PointPtr start = nullptr;
-            for(const TerrainCollissionNode* pNode : intersectingNodes)
-            {
-                PointPtr p = pNode->getClosestPoint(pos, &dSqrd);
+        isClosed[index] = true;
 
-                if(dSqrd < minSqrd)
-                {
-                    minSqrd = dSqrd;
-                    start = p;
-                }
-            }
+        for(const NavGraph::Edge* pEdge = graph.edgesBegin(index); pEdge != graph.edgesEnd(index); pEdge++)
+        {
+            if(pEdge->reverse < 0 || isClosed[pEdge->to])
+                continue;
 
-            minSqrd = 999999999999999999;
-            PointPtr goal = nullptr;
-            for(const TerrainCollissionNode* pNode : intersectingNodes)
-            {
-                PointPtr p = pNode->getClosestPoint(destination, &dSqrd);
+            const NavGraph::Edge& towardsIndex = graph.getEdge(pEdge->reverse);
+            if(!(towardsIndex.clearanceMask & classBit))
+                continue;
 
-                if(dSqrd < minSqrd)
-                {
-                    minSqrd = dSqrd;
-                    goal = p;
-                }
+            float distance = pTree->distances[index] + towardsIndex.length;
+            if(distance < pTree->distances[pEdge->to])
+            {
+                pTree->distances[pEdge->to] = distance;
+                pTree->edges[pEdge->to] = &towardsIndex;
+                openSet.push(OpenNode(distance, pEdge->to));
             }
-            */
         }
+    }
 
-/**
-        std::list<PointPtr> visibleStartPoints = mMap.getVisiblePoints(pos);
-        std::list<PointPtr> visibleGoalPoints = mMap.getVisiblePoints(destination);
+    return pTree;
+}
 
-        assert(!visibleStartPoints.empty());
-        assert(!visibleGoalPoints.empty());
+std::list<Pathfinder::Waypoint> Pathfinder::getPath(const SearchTree& tree, sf::Vector2f pos, sf::Vector2f destination) const
+{
+    std::list<Waypoint> wayPoints;
 
-        std::list<PathNode> allNodes; // All nodes are stored here.
-        std::list<std::list<PathNode>::iterator> visitedNodes; // Iterators to visited nodes in allNodes.
-        std::list<std::list<PathNode>::iterator> checkList; // Iterators to nodes to be checked in allNodes.
+    if(!pathIsObstructed(pos, destination))
+    {
+        wayPoints.push_back(Waypoint(pos, destination));
+        return wayPoints;
+    }
+
+    const NavGraph& graph = mMap.getNavGraph();
+    // Like refinePath(), only read the cache.
+    CacheUse cacheUse;
+    if(tree.version != graph.getVersion())
+        return getPath(tree.diameter, pos, destination, nullptr, nullptr, &cacheUse);
+
+    // Enter the tree where the total distance is the shortest.
+    int index = -1;
+    float minDistance = std::numeric_limits<float>::max();
+    for(int i : mMap.getVisiblePoints(pos))
+    {
+        if(tree.distances[i] == std::numeric_limits<float>::max())
+            continue;
 
-        TerrainCollissionNode::Point startPoint(sf::Vector2f(0, 0), pos, sf::Vector2f(0, 0));
-        std::list<TerrainCollissionNode::Path> startPointPaths;
-        auto iParent = allNodes.insert(allNodes.end(), PathNode(0.f, lengthSqrd(pos - destination), allNodes.end(), &startPoint));
-        auto iParentCheckList = checkList.insert(checkList.end(), iParent);
-        for(PointPtr pPoint : visibleStartPoints)
+        float distance = length(graph.getVertex(i).pos - pos) + tree.distances[i];
+        if(distance < minDistance)
         {
-            startPointPaths.push_back(TerrainCollissionNode::Path(&startPoint, pPoint, false));
-            startPoint.paths.push_back(&startPointPaths.back());
-            checkList.push_back(allNodes.insert(allNodes.end(), PathNode(lengthSqrd(pPoint->pos - pos), lengthSqrd(pPoint->pos - destination), iParent, pPoint)));
+            minDistance = distance;
+            index = i;
         }
+    }
 
-        checkList.erase(iParentCheckList);
-        visitedNodes.push_back(iParent);
+    // No route fits.
+    if(index < 0)
+        return wayPoints;
 
-        auto isLessThan = [](std::list<PathNode>::iterator& a, std::list<PathNode>::iterator& b)
-        {
-            return a->f() < b->f();
-        };
-*/
+    std::vector<int> corners(1, index);
+    while(tree.edges[index])
+    {
+        index = tree.edges[index]->to;
+        corners.push_back(index);
+    }
+
+    if(pathIsObstructed(graph.getVertex(index).pos, destination))
+        destination = tree.destination;
+
+    return smoothPath(graph, corners, tree.diameter, pos, destination);
+}
+
+std::vector<int> Pathfinder::getNearbyVisiblePoints(int clearanceClass, sf::Vector2f p) const
+{
+    const NavGraph& graph = mMap.getNavGraph(clearanceClass);
+    std::shared_ptr<const NavHierarchy> pHierarchy = getHierarchy(clearanceClass);
+
+    std::vector<int> clusters;
+    std::vector<int> visiblePoints;
+    pHierarchy->getClusters(p, CLUSTER_RADIUS, clusters);
+    for(int cluster : clusters)
+        for(const int* pVertex = pHierarchy->verticesBegin(cluster); pVertex != pHierarchy->verticesEnd(cluster); pVertex++)
+            if(!pathIsObstructed(p, graph.getVertex(*pVertex).pos))
+                visiblePoints.push_back(*pVertex);
 
-/*
-        iParentCheckList = std::min_element(checkList.begin(), checkList.end(), isLessThan);
-        iParent = *iParentCheckList;
-        checkList.erase(iParentCheckList);
-        visitedNodes.push_back(iParent);
-*/
+    if(visiblePoints.empty())
+        return mMap.getVisiblePoints(p);
+
+    return visiblePoints;
+}
+
+std::list<Pathfinder::Waypoint> Pathfinder::getPath(Chase& chase, sf::Vector2f pos, sf::Vector2f destination, unsigned int* pExpansions) const
+{
+    std::list<Waypoint> wayPoints;
+
+    // Most of a chase is spent in sight of the target.
+    if(!pathIsObstructed(pos, destination))
+    {
+        wayPoints.push_back(Waypoint(pos, destination));
+        return wayPoints;
+    }
 
+    const NavGraph& graph = mMap.getNavGraph(NavGraph::getClearanceClass(chase.diameter));
 
-        //void findPath(std::list<std::list<PathNode>::iterator>& visitedNodes
-/**
-        std::function<void()> findNext = [&]()
+    if(chase.version != graph.getVersion() || length(destination - chase.destination) > CHASE_REPAIR_DISTANCE || length(pos - chase.start) > CHASE_REPAIR_DISTANCE)
+    {
+        resetChase(chase, graph);
+        chase.start = pos;
+        chase.destination = destination;
+
+        chase.lookaheads[chase.getGoal()] = 0.f;
+        updateChaseNode(chase, graph, chase.getGoal());
+        linkChase(chase, graph, true, pos);
+        linkChase(chase, graph, false, destination);
+    }
+    else
+    {
+        // The heuristic of every queued key shrinks by at most how far the start moved.
+        if(pos != chase.start)
         {
-            sf::Vector2f poss = pos;
-            float minF = std::numeric_limits<float>::max();
-            auto iNextCheckList = checkList.end();
-            auto derp = *iParent;
-            for(PathPtr pPath : iParent->pPoint->paths)
-            {
+            chase.keyModifier += length(pos - chase.start);
+            linkChase(chase, graph, true, pos);
+        }
+
+        if(destination != chase.destination)
+            linkChase(chase, graph, false, destination);
+    }
+
+    unsigned int expansions = searchChase(chase, graph);
+    if(pExpansions)
+        (*pExpansions) += expansions;
+
+    const int goal = chase.getGoal();
+    const int start = chase.getStart();
 
-                bool isVisited = false;
-                for(auto& iVisited : visitedNodes)
+    // No route fits.
+    if(chase.lookaheads[start] == std::numeric_limits<float>::max())
+        return wayPoints;
+
+    // Follow the cheapest successors to the target.
+    std::vector<int> corners;
+    int node = start;
+    while(node != goal && corners.size() < chase.goalCosts.size())
+    {
+        int next = goal;
+        float minDistance = std::numeric_limits<float>::max();
+        if(node == start)
+        {
+            for(int i : chase.startLinks)
+                if(chase.startCosts[i] + chase.distances[i] < minDistance)
                 {
-                    if(iVisited->pPoint && iVisited->pPoint == pPath->p)
-                    {
-                        isVisited = true;
-                        break;
-                    }
+                    minDistance = chase.startCosts[i] + chase.distances[i];
+                    next = i;
                 }
+        }
+        else
+        {
+            corners.push_back(node);
 
-                if(!isVisited)
-                {
-                    // Check if path's point exists in the checklist.
-                    auto iChecked = allNodes.end();
-                    auto iCheckedCheckList = checkList.begin();
-                    while(iCheckedCheckList != checkList.end())
-                    {
-                        if((*iCheckedCheckList)->pPoint == pPath->p)
-                        {
-                            iChecked = *iCheckedCheckList;
-                            break;
-                        }
-                        iCheckedCheckList++;
-                    }
-
-                    float distanceTravelled = iParent->distanceTravelled + pPath->lengthSqrd;
-                    float distanceLeft = lengthSqrd(pPath->p->pos - destination);
-                    float f = distanceTravelled + distanceLeft;
-                    // If found in checkList.
-                    if(iCheckedCheckList != checkList.end())
-                    {
-                        float checkedF = iChecked->f();
-                        // If f value from iParent is smaller than from iChecked's
-                        // parent, assign iChecked to iParent and this f.
-                        if(f < checkedF)
-                        {
-                            //iChecked->iParent = iParent;
-                            //iChecked->distanceTravelled = distanceTravelled;
-                            //iChecked->distanceLeft = distanceLeft;
-                            //checkedF = iChecked->f();
-                        }
-
-                        if(checkedF <= minF)
-                        {
-                            minF = checkedF;
-                            iNextCheckList = iCheckedCheckList;
-                            iParent->pPath = pPath;
-                        }
-
-                    }
-                    else
-                    {
-                        auto iInsertedCheckList = checkList.insert(checkList.end(), allNodes.insert(allNodes.end(), PathNode(distanceTravelled, distanceLeft, iParent, pPath->p)));
-                        if(f <= minF)
-                        {
-                            minF = f;
-                            iNextCheckList = iInsertedCheckList;
-                            iParent->pPath = pPath;
-                        }
-                    }
+            if(chase.goalCosts[node] >= 0.f)
+                minDistance = chase.goalCosts[node];
 
+            for(const NavGraph::Edge* pEdge = graph.edgesBegin(node); pEdge != graph.edgesEnd(node); pEdge++)
+                if(pEdge->length + chase.distances[pEdge->to] < minDistance)
+                {
+                    minDistance = pEdge->length + chase.distances[pEdge->to];
+                    next = pEdge->to;
                 }
-            }
+        }
 
-            // If no unvisited nodes are found.
-            if(iNextCheckList == checkList.end())
-            {
-                assert(iParent->pPoint != &startPoint);
+        if(minDistance == std::numeric_limits<float>::max())
+            return wayPoints;
 
-                // Roll back to previous node.
-                iParent = iParent->iParent;
-            }
-            else
-            {
-                derp = *iParent;
+        node = next;
+    }
 
-                assert(iParent->pPath);
-                iParent = *iNextCheckList;
+    return smoothPath(graph, corners, chase.diameter, pos, destination);
+}
 
-                derp = *iParent;
+void Pathfinder::resetChase(Chase& chase, const NavGraph& graph) const
+{
+    const int vertexCount = graph.getVertexCount();
+    const int nodeCount = vertexCount + 2;
+
+    chase.version = graph.getVersion();
+    chase.keyModifier = 0.f;
+    chase.distances.assign(nodeCount, std::numeric_limits<float>::max());
+    chase.lookaheads.assign(nodeCount, std::numeric_limits<float>::max());
+    chase.startCosts.assign(vertexCount, -1.f);
+    chase.goalCosts.assign(vertexCount, -1.f);
+    chase.startLinks.clear();
+    chase.goalLinks.clear();
+    chase.keys.assign(nodeCount, Chase::Key());
+    chase.isQueued.assign(nodeCount, false);
+    chase.openSet = decltype(chase.openSet)();
+}
 
-                checkList.erase(iNextCheckList);
-                visitedNodes.push_back(iParent);
+void Pathfinder::linkChase(Chase& chase, const NavGraph& graph, bool isStart, sf::Vector2f p) const
+{
+    std::vector<float>& costs = isStart ? chase.startCosts : chase.goalCosts;
+    std::vector<int>& links = isStart ? chase.startLinks : chase.goalLinks;
 
+    std::vector<int> oldLinks;
+    oldLinks.swap(links);
+    for(int i : oldLinks)
+        costs[i] = -1.f;
 
-            }
+    links = getNearbyVisiblePoints(NavGraph::getClearanceClass(chase.diameter), p);
+    for(int i : links)
+        costs[i] = length(graph.getVertex(i).pos - p);
 
-        };
+    if(isStart)
+    {
+        chase.start = p;
+        updateChaseNode(chase, graph, chase.getStart());
+        return;
+    }
 
+    // Edges into the target changed cost, or appeared or disappeared.
+    chase.destination = p;
+    for(int i : oldLinks)
+        updateChaseNode(chase, graph, i);
 
-        auto parentIsGoalPoint = [&]()
-        {
-            for(PointPtr goalPoint : visibleGoalPoints)
-                if(iParent->pPoint == goalPoint)
-                    return true;
+    for(int i : links)
+        updateChaseNode(chase, graph, i);
+}
 
-            return false;
-        };
+Pathfinder::Chase::Key Pathfinder::getChaseKey(const Chase& chase, const NavGraph& graph, int node) const
+{
+    sf::Vector2f pos = chase.start;
+    if(node == chase.getGoal())
+        pos = chase.destination;
+    else if(node < chase.getGoal())
+        pos = graph.getVertex(node).pos;
 
-        while(!checkList.empty() && !parentIsGoalPoint())
-        {
-            findNext();
-        }
-*/
-        /*
-        do
-        {
-            findNext();
-        } while(!checkList.empty() && !parentIsGoalPoint());
-*/
-        // If empty, no path was found.
-        /**
-        if(!checkList.empty())
-        {
-            // exit point -> destination
-            Waypoint exit(iParent->pPoint->pos, destination);
-            wayPoints.push_front(Waypoint(iParent->pPoint->pos, destination));
+    // H is the euclidean distance from the start, which never overestimates.
+    const float distance = std::min(chase.distances[node], chase.lookaheads[node]);
+    Chase::Key key = {distance + length(pos - chase.start) + chase.keyModifier, distance};
 
-            Waypoint derp = wayPoints.front();
+    return key;
+}
 
-            // pos -> entry point -> ... -> exit point
-            do
-            {
-                wayPoints.push_front(Waypoint(iParent->iParent->pPath));
-                derp = wayPoints.front();
-                iParent = iParent->iParent;
-            } while(iParent->pPoint != &startPoint);
-*/
-/*
-            if(iParent->iParent->pPoint)
-            {
-                iParent = iParent->iParent;
+void Pathfinder::updateChaseNode(Chase& chase, const NavGraph& graph, int node) const
+{
+    const int goal = chase.getGoal();
+    const int start = chase.getStart();
 
-                // pos -> entry point -> ... -> exit point
-                while(iParent->iParent->pPoint)
-                {
-                    if(!iParent->pPath)
-                        int flurp = 0;
-                    wayPoints.push_front(Waypoint(iParent->pPath));
-                    iParent = iParent->iParent;
-                }
+    if(node == start)
+    {
+        float lookahead = std::numeric_limits<float>::max();
+        for(int i : chase.startLinks)
+            lookahead = std::min(lookahead, chase.startCosts[i] + chase.distances[i]);
 
-                // Entry point's path
-                wayPoints.push_front(Waypoint(iParent->pPath));
-            }
-            */
+        chase.lookaheads[node] = lookahead;
+    }
+    else if(node != goal)
+    {
+        float lookahead = std::numeric_limits<float>::max();
+        if(chase.goalCosts[node] >= 0.f)
+            lookahead = chase.goalCosts[node] + chase.distances[goal];
 
-            // pos -> entry point
-            //wayPoints.push_front(Waypoint(pos, iParent->pPoint->pos));
+        for(const NavGraph::Edge* pEdge = graph.edgesBegin(node); pEdge != graph.edgesEnd(node); pEdge++)
+            lookahead = std::min(lookahead, pEdge->length + chase.distances[pEdge->to]);
 
-/**        }
+        chase.lookaheads[node] = lookahead;
+    }
+
+    queueChaseNode(chase, graph, node);
+}
 
-        for(Waypoint p : wayPoints)
+void Pathfinder::queueChaseNode(Chase& chase, const NavGraph& graph, int node) const
+{
+    chase.isQueued[node] = chase.distances[node] != chase.lookaheads[node];
+    if(chase.isQueued[node])
+    {
+        chase.keys[node] = getChaseKey(chase, graph, node);
+        chase.openSet.push(Chase::OpenNode(chase.keys[node], node));
+    }
+}
+
+void Pathfinder::updateChasePredecessor(Chase& chase, const NavGraph& graph, int predecessor, float cost, int node, float oldDistance) const
+{
+    if(predecessor == chase.getGoal())
+        return;
+
+    /*
+     * A shorter distance can only lower the predecessor's lookahead. A
+     * longer one only matters if node was the predecessor's best
+     * successor, in which case all of them are looked at again.
+     */
+    if(chase.distances[node] < oldDistance)
+    {
+        if(cost + chase.distances[node] < chase.lookaheads[predecessor])
         {
-            int flerp = 0;
-        }*/
+            chase.lookaheads[predecessor] = cost + chase.distances[node];
+            queueChaseNode(chase, graph, predecessor);
+        }
     }
-    else
-        wayPoints.push_back(Waypoint(pos, destination));
+    else if(chase.lookaheads[predecessor] == cost + oldDistance)
+        updateChaseNode(chase, graph, predecessor);
+}
 
-    return wayPoints;
+void Pathfinder::updateChasePredecessors(Chase& chase, const NavGraph& graph, int node, float oldDistance) const
+{
+    if(node == chase.getStart())
+        return;
 
+    if(node == chase.getGoal())
+    {
+        for(int i : chase.goalLinks)
+            updateChasePredecessor(chase, graph, i, chase.goalCosts[i], node, oldDistance);
 
+        return;
+    }
 
-/*
+    // Reverse edges lead to the vertices with an edge into node.
+    for(const NavGraph::Edge* pEdge = graph.edgesBegin(node); pEdge != graph.edgesEnd(node); pEdge++)
+        if(pEdge->reverse >= 0)
+            updateChasePredecessor(chase, graph, pEdge->to, graph.getEdge(pEdge->reverse).length, node, oldDistance);
 
-        assert(start && goal);
-        auto point = start;
-        std::list<PathPtr> paths;
-        while(point != goal)
-        {
-            const std::list<TerrainCollissionNode::Path*>& possiblePaths = point->paths;
-            assert(possiblePaths.size() > 0);
+    if(chase.startCosts[node] >= 0.f)
+        updateChasePredecessor(chase, graph, chase.getStart(), chase.startCosts[node], node, oldDistance);
+}
 
+unsigned int Pathfinder::searchChase(Chase& chase, const NavGraph& graph) const
+{
+    const int start = chase.getStart();
+    unsigned int expansions = 0;
 
-            paths.push_back(findSmallestF(diameter, goal->pos, possiblePaths));
-            point = paths.back()->p;
-        }
-*/
+    while(true)
+    {
+        // Skip the entries of nodes that have been queued again or dropped since.
+        while(!chase.openSet.empty() && !(chase.isQueued[chase.openSet.top().second] && chase.keys[chase.openSet.top().second] == chase.openSet.top().first))
+            chase.openSet.pop();
+
+        if(chase.openSet.empty())
+            break;
 
-/*
-        Waypoint wp;
-        wp.destination = start->pos;
-        sf::Vector2f dVec = start->pos - pos;
-        wp.distance = sqrtf(lengthSqrd(dVec));
-        wp.direction = dVec / wp.distance;
+        const Chase::OpenNode top = chase.openSet.top();
+        if(!(top.first < getChaseKey(chase, graph, start)) && chase.lookaheads[start] == chase.distances[start])
+            break;
 
-        wayPoints.push_back(wp);
+        const int node = top.second;
+        chase.openSet.pop();
+        chase.isQueued[node] = false;
 
-        sf::Vector2f prev = start->pos;
-        for(auto path : paths)
+        // The key was computed before the start last moved.
+        Chase::Key key = getChaseKey(chase, graph, node);
+        if(top.first < key)
         {
-            wp.destination = path->p->pos;
-            wp.distance = sqrtf(path->lengthSqrd);
-            wp.direction = (path->p->pos - prev) / wp.distance;
+            chase.keys[node] = key;
+            chase.isQueued[node] = true;
+            chase.openSet.push(Chase::OpenNode(key, node));
+            continue;
+        }
+
+        expansions++;
 
-            prev = path->p->pos;
-            wayPoints.push_back(wp);
+        const float oldDistance = chase.distances[node];
+        if(oldDistance > chase.lookaheads[node])
+        {
+            chase.distances[node] = chase.lookaheads[node];
+            updateChasePredecessors(chase, graph, node, oldDistance);
         }
+        else
+        {
+            chase.distances[node] = std::numeric_limits<float>::max();
+            updateChaseNode(chase, graph, node);
+            updateChasePredecessors(chase, graph, node, oldDistance);
+        }
+    }
+
+    return expansions;
+}
 
+std::list<Pathfinder::Waypoint> Pathfinder::smoothPath(const NavGraph& graph, const std::vector<int>& corners, float diameter, sf::Vector2f pos, sf::Vector2f destination, bool isPosCorner, bool isDestinationCorner) const
+{
+    const int last = corners.size() + 1;
+
+    std::vector<sf::Vector2f> points;
+    std::vector<bool> isOnTerrain; // Lines of sight between two of these may cut through the terrain.
+    points.reserve(last + 1);
+    isOnTerrain.reserve(last + 1);
 
-        wp.destination = destination;
-        dVec = destination - goal->pos;
-        wp.distance = sqrtf(lengthSqrd(dVec));
-        wp.direction = dVec / wp.distance;
+    points.push_back(pos);
+    isOnTerrain.push_back(isPosCorner);
 
-        wayPoints.push_back(wp);
+    // Keep the unit's body off the terrain by rounding corners on the outside.
+    for(int corner : corners)
+    {
+        const NavGraph::Vertex& vertex = graph.getVertex(corner);
+        sf::Vector2f offset = vertex.pos + vertex.bisector * (diameter / 2.f);
+        bool isBlocked = pathIsObstructed(vertex.pos, offset);
 
+        points.push_back(isBlocked ? vertex.pos : offset);
+        isOnTerrain.push_back(isBlocked);
     }
-    else
+
+    points.push_back(destination);
+    isOnTerrain.push_back(isDestinationCorner);
+
+    /*
+     * The corners themselves see each other, since they are joined by
+     * the graph. Moving two of them may break that, in which case they
+     * are put back. Repeat until every leg is clear.
+     */
+    bool isMoved = true;
+    while(isMoved)
     {
-        Waypoint wp;
-        wp.destination = destination;
-        sf::Vector2f dVec = destination - pos;
-        wp.distance = sqrtf(lengthSqrd(dVec));
-        wp.direction = dVec / wp.distance;
-        wayPoints = {wp};
+        isMoved = false;
+        for(int i = 0; i < last; i++)
+        {
+            if(!pathIsObstructed(points[i], points[i + 1]))
+                continue;
+
+            for(int j = std::max(i, 1); j <= std::min(i + 1, last - 1); j++)
+                if(!isOnTerrain[j])
+                {
+                    points[j] = graph.getVertex(corners[j - 1]).pos;
+                    isOnTerrain[j] = true;
+                    isMoved = true;
+                }
+        }
     }
 
+    /*
+     * Pull the string tight by heading for the furthest point in sight.
+     * Two corners of the same polygon see each other through it as far
+     * as the edge index is concerned, so those are never joined.
+     */
+    std::list<Waypoint> wayPoints;
+    int i = 0;
+    while(i < last)
+    {
+        int j = i + 1;
+        while(j < last && !(isOnTerrain[i] && isOnTerrain[j + 1]) && !pathIsObstructed(points[i], points[j + 1]))
+            j++;
+
+        if(points[i] != points[j])
+            wayPoints.push_back(Waypoint(points[i], points[j]));
+
+        i = j;
+    }
 
     return wayPoints;
-*/
+}
+
+Pathfinder::FlowFieldPtr Pathfinder::getFlowField(float diameter, sf::Vector2f destination) const
+{
+    const float classDiameter = NavGraph::getClassDiameter(NavGraph::getClearanceClass(diameter));
+    const unsigned int version = mMap.getNavGraph().getVersion();
+    const float matchDistance = FlowField::CELL_SIZE / 2.f;
+
+    std::lock_guard<std::mutex> lock(mFlowFieldMutex);
+    for(const std::weak_ptr<const FlowField>& pWeakField : mFlowFields)
+    {
+        FlowFieldPtr pField = pWeakField.lock();
+        if(pField && pField->getDiameter() == classDiameter && pField->getVersion() == version
+           && lengthSqrd(pField->getTarget() - destination) < matchDistance * matchDistance)
+            return pField;
+    }
+
+    mFlowFields.erase(std::remove_if(mFlowFields.begin(), mFlowFields.end(), [](const std::weak_ptr<const FlowField>& pWeakField)
+    {
+        return pWeakField.expired();
+    }), mFlowFields.end());
+
+    std::shared_ptr<FlowField> pBuilt(new FlowField());
+    pBuilt->build(mMap.getImpassableTerrain(), mMap.getBounds(), version, destination, classDiameter);
+    mFlowFields.push_back(pBuilt);
+
+    return pBuilt;
+}
+
+void Pathfinder::applyCacheUse(const CacheUse& cacheUse) const
+{
+    if(cacheUse.isNew)
+        mPathCache.insert(cacheUse.key, cacheUse.version, cacheUse.route);
+    else if(cacheUse.isHit)
+        mPathCache.touch(cacheUse.key, cacheUse.version);
+}
+
+PathCache::Metrics Pathfinder::getPathCacheMetrics() const
+{
+    return mPathCache.getMetrics();
 }
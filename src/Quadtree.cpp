@@ -20,348 +20,377 @@
 ****************************************************************
 ****************************************************************/
 
-#include "Quadtree.hpp"
-#include <Utility.hpp>
-
-
 
+#include "Quadtree.hpp"
+#include "EntityNode.hpp"
 
 ////////////////////////////////////////////////
-// For debugging
-#include <string>
-#include <sstream>
-#include <iostream>
+// STD - C++ Standard Library
 #include <cassert>
+#include <algorithm>
+#include <limits>
 ////////////////////////////////////////////////
 
-Quadtree::Quadtree(sf::FloatRect bounds, std::list<Node>& nodes)
-: mLevel(0)
-, mBounds(bounds)
-, mNodes(nodes)
+Quadtree::Quad::Quad(sf::FloatRect cell, int level)
+: cell(cell)
+, level(level)
+, firstChild(-1)
+, firstElement(-1)
+, elementCount(0)
+, left(1.f)
+, top(1.f)
+, right(0.f)
+, bottom(0.f)
 {
 }
 
-Quadtree::Quadtree(int level, sf::FloatRect bounds, std::list<Node>& nodes)
-: mLevel(level)
-, mBounds(bounds)
-, mNodes(nodes)
+static bool touches(const sf::FloatRect& rect, float left, float top, float right, float bottom)
 {
+    return rect.left < right && left < rect.left + rect.width && rect.top < bottom && top < rect.top + rect.height;
 }
 
-void Quadtree::update()
+Quadtree::Quadtree(sf::FloatRect bounds)
+: mFreeQuads(-1)
+, mFreeElements(-1)
+, mEntityCount(0)
 {
-    std::list<Node*> updatedNodes;
-    updateNodes(updatedNodes);
-
-    for(Node* node : updatedNodes)
-        insertNode(node);
-
-    updateTree();
+    mQuads.push_back(Quad(bounds, 0));
+    fitBounds(0);
 }
 
-void Quadtree::updateTree()
+void Quadtree::update()
 {
-    if(mChildren.empty())
+    for(int i = 0; i < (int)mElements.size(); i++)
     {
-        if(mQuadNodes.size() > MAX_NODES && mLevel < MAX_LEVELS)
+        Element& element = mElements[i];
+        if(!element.entity)
+            continue;
+
+        // Entities also move on their last tick of moving, or when pushed, so look at every rect.
+        sf::FloatRect rect = element.entity->getBoundingRect();
+        if(rect == element.rect)
+            continue;
+
+        element.rect = rect;
+        int quad = findQuad(element.rect);
+        if(quad != element.quad)
         {
-            split();
-
-            for(Node* node : mQuadNodes)
-            {
-                unsigned char indices = getPartialIndices(node->entity->getBoundingRect());
-
-                if(indices & (1 << 0))
-                    mChildren[0].insertNode(node);
-                if(indices & (1 << 1))
-                    mChildren[1].insertNode(node);
-                if(indices & (1 << 2))
-                    mChildren[2].insertNode(node);
-                if(indices & (1 << 3))
-                    mChildren[3].insertNode(node);
-            }
+            unlink(i);
+            link(i, quad);
         }
-
     }
-    else if(mQuadNodes.size() < MAX_NODES)
-        merge();
 
-    for(Quadtree& child : mChildren)
-        child.updateTree();
+    updateQuad(0);
 }
 
 void Quadtree::insertEntity(EntityNode* entity)
 {
-    // Do nothing if entity is marked for removal.
-    if(entity->isMarkedForRemoval())
+    // Do nothing if entity is marked for removal or already in a tree.
+    if(entity->isMarkedForRemoval() || entity->getCollissionHandle() >= 0)
         return;
 
-    // Do nothing if entity already exists in tree.
-    for(Node& node : mNodes)
-        if(node.entity == entity)
-            return;
+    int element = mFreeElements;
+    if(element >= 0)
+        mFreeElements = mElements[element].next;
+    else
+    {
+        element = mElements.size();
+        mElements.push_back(Element());
+    }
 
-    Node node;
-    node.entity = entity;
+    mElements[element].entity = entity;
+    mElements[element].rect = entity->getBoundingRect();
+    link(element, findQuad(mElements[element].rect));
 
-    auto insertionIt = mNodes.insert(mNodes.end(), node);
-    insertNode(&(*insertionIt));
+    entity->setCollissionHandle(element);
+    mEntityCount++;
 }
 
 void Quadtree::eraseEntity(EntityNode* entity)
 {
-    for(auto it = mNodes.begin(); it != mNodes.end(); it++)
-    {
-        if(it->entity == entity)
-        {
-            eraseNode(it);
-            return;
-        }
-    }
+    int element = entity->getCollissionHandle();
+    if(element >= 0 && element < (int)mElements.size() && mElements[element].entity == entity)
+        eraseElement(element);
 }
 
-void Quadtree::updateNodes(std::list<Node*>& updatedNodes)
+void Quadtree::removeWrecks()
 {
-    for(Node& node : mNodes)
-        if(node.entity->isMoving())
-        {
-            sf::FloatRect entityRect = node.entity->getBoundingRect();
-            std::list<Quadtree*> markedForErasion;
-            auto iQuad = node.quads.begin();
-            while(iQuad != node.quads.end())
-            {
-                if(!intersects(entityRect, (*iQuad)->getBoundingRect()) && !intersects((*iQuad)->getBoundingRect(), entityRect))
-                    markedForErasion.push_back(*iQuad);
+    for(int i = 0; i < (int)mElements.size(); i++)
+        if(mElements[i].entity && mElements[i].entity->isMarkedForRemoval())
+            eraseElement(i);
+}
 
+void Quadtree::eraseElement(int element)
+{
+    unlink(element);
+
+    Element& erased = mElements[element];
+    erased.entity->setCollissionHandle(-1);
+    erased.entity = nullptr;
+    erased.next = mFreeElements;
+    mFreeElements = element;
+    mEntityCount--;
+}
 
+void Quadtree::link(int element, int quad)
+{
+    Element& linked = mElements[element];
+    Quad& owner = mQuads[quad];
 
-                iQuad++;
-            }
-            updatedNodes.push_back(&node);
+    linked.quad = quad;
+    linked.prev = -1;
+    linked.next = owner.firstElement;
+    if(owner.firstElement >= 0)
+        mElements[owner.firstElement].prev = element;
 
-            for(Quadtree* quad : markedForErasion)
-                quad->eraseQuadNode(&node);
-        }
+    owner.firstElement = element;
+    owner.elementCount++;
 }
 
-void Quadtree::eraseNode(std::list<Node>::iterator iNode)
+void Quadtree::unlink(int element)
 {
-    std::list<Quadtree*> markedForRemoval;
-    for(Quadtree* quad : iNode->quads)
-        markedForRemoval.push_back(quad);
+    Element& unlinked = mElements[element];
+    Quad& owner = mQuads[unlinked.quad];
 
-    Node* pNode = &(*iNode);
-    for(Quadtree* quad : markedForRemoval)
-        quad->eraseQuadNode(pNode);
+    if(unlinked.prev >= 0)
+        mElements[unlinked.prev].next = unlinked.next;
+    else
+        owner.firstElement = unlinked.next;
 
-    mNodes.erase(iNode);
-}
+    if(unlinked.next >= 0)
+        mElements[unlinked.next].prev = unlinked.prev;
 
-sf::FloatRect Quadtree::getBoundingRect() const
-{
-    return mBounds;
+    owner.elementCount--;
 }
 
-void Quadtree::eraseQuadNode(Node* node)
+int Quadtree::findQuad(sf::FloatRect rect) const
 {
-    auto iNode = std::find(mQuadNodes.begin(), mQuadNodes.end(), node);
-    if(iNode != mQuadNodes.end())
-    {
-        mQuadNodes.erase(iNode);
+    int quad = 0;
+    for(int child = getChild(quad, rect); child >= 0; child = getChild(quad, rect))
+        quad = child;
 
-        auto iQuad = std::find(node->quads.begin(), node->quads.end(), this);
-        if(iQuad != node->quads.end())
-            node->quads.erase(iQuad);
-    }
+    return quad;
 }
 
-bool Quadtree::isOutOfBounds(EntityNode* node)
+int Quadtree::getChild(int quad, sf::FloatRect rect) const
 {
-    sf::FloatRect rect = node->getBoundingRect();
-
-    if(rect.left < mBounds.left)
-        return true;
-    if(rect.top < mBounds.top)
-        return true;
-    if(rect.left + rect.width > mBounds.left + mBounds.width)
-        return true;
-    if(rect.top + rect.height > mBounds.top + mBounds.height)
-        return true;
-
-    return false;
+    const Quad& parent = mQuads[quad];
+    if(parent.firstChild < 0)
+        return -1;
+
+    float childWidth = parent.cell.width / 2;
+    float childHeight = parent.cell.height / 2;
+    if(rect.width > childWidth || rect.height > childHeight)
+        return -1;
+
+    // A rect centred outside the root cell would stick out of the loose bounds of any child.
+    sf::Vector2f centre(rect.left + rect.width / 2, rect.top + rect.height / 2);
+    if(!parent.cell.contains(centre))
+        return -1;
+
+    int index = (centre.x >= parent.cell.left + childWidth ? 1 : 0) + (centre.y >= parent.cell.top + childHeight ? 2 : 0);
+    return parent.firstChild + index;
 }
 
-
-void Quadtree::insertNode(Node* node)
+int Quadtree::updateQuad(int quad)
 {
-    if(!mChildren.empty())
+    if(mQuads[quad].firstChild < 0)
     {
-        unsigned char indices = getPartialIndices(node->entity->getBoundingRect());
-
-        if(indices & (1 << 0))
-            mChildren[0].insertNode(node);
-        if(indices & (1 << 1))
-            mChildren[1].insertNode(node);
-        if(indices & (1 << 2))
-            mChildren[2].insertNode(node);
-        if(indices & (1 << 3))
-            mChildren[3].insertNode(node);
-    }
+        if(mQuads[quad].elementCount <= MAX_ELEMENTS || mQuads[quad].level >= MAX_LEVELS)
+        {
+            fitBounds(quad);
+            return mQuads[quad].elementCount;
+        }
 
-    // Only insert the node if it doesn't already exist here.
-    if(std::find(mQuadNodes.begin(), mQuadNodes.end(), node) == mQuadNodes.end())
-    {
-        mQuadNodes.push_back(node);
-        node->quads.push_back(this);
+        split(quad);
     }
+
+    int count = mQuads[quad].elementCount;
+    int firstChild = mQuads[quad].firstChild;
+    for(int i = 0; i < 4; i++)
+        count += updateQuad(firstChild + i);
+
+    // Merging only well below the split threshold keeps a quad from splitting and merging every other tick.
+    if(count <= MAX_ELEMENTS / 2)
+        merge(quad);
+
+    fitBounds(quad);
+    return count;
 }
 
-void Quadtree::removeWrecks()
+void Quadtree::fitBounds(int quad)
 {
-    std::list<std::list<Node>::iterator> markedForRemoval;
-    auto it = mNodes.begin();
-    while(it != mNodes.end())
-    {
-        if(it->entity->isMarkedForRemoval() || it->quads.empty())
-            markedForRemoval.push_back(it);
+    Quad& fitted = mQuads[quad];
+    fitted.left = fitted.top = std::numeric_limits<float>::max();
+    fitted.right = fitted.bottom = -std::numeric_limits<float>::max();
 
-        it++;
+    for(int element = fitted.firstElement; element >= 0; element = mElements[element].next)
+    {
+        const sf::FloatRect& rect = mElements[element].rect;
+        fitted.left = std::min(fitted.left, rect.left);
+        fitted.top = std::min(fitted.top, rect.top);
+        fitted.right = std::max(fitted.right, rect.left + rect.width);
+        fitted.bottom = std::max(fitted.bottom, rect.top + rect.height);
     }
 
-    for(auto it : markedForRemoval)
-        eraseNode(it);
+    if(fitted.firstChild >= 0)
+        for(int i = 0; i < 4; i++)
+        {
+            const Quad& child = mQuads[fitted.firstChild + i];
+            fitted.left = std::min(fitted.left, child.left);
+            fitted.top = std::min(fitted.top, child.top);
+            fitted.right = std::max(fitted.right, child.right);
+            fitted.bottom = std::max(fitted.bottom, child.bottom);
+        }
 }
 
-void Quadtree::split()
+void Quadtree::split(int quad)
 {
-    float childWidth = mBounds.width / 2;
-    float childHeight = mBounds.height / 2;
+    int firstChild = mFreeQuads;
+    if(firstChild >= 0)
+        mFreeQuads = mQuads[firstChild].firstChild;
+    else
+    {
+        firstChild = mQuads.size();
+        mQuads.resize(mQuads.size() + 4);
+    }
 
-    float x = mBounds.left;
-    float y = mBounds.top;
+    const Quad& parent = mQuads[quad];
+    float childWidth = parent.cell.width / 2;
+    float childHeight = parent.cell.height / 2;
+    float x = parent.cell.left;
+    float y = parent.cell.top;
 
-    mChildren.push_back(Quadtree(mLevel + 1, sf::FloatRect(x, y, childWidth, childHeight), mNodes)); //Top left
-    mChildren.push_back(Quadtree(mLevel + 1, sf::FloatRect(x + childWidth, y, childWidth, childHeight), mNodes)); //Top right
-    mChildren.push_back(Quadtree(mLevel + 1, sf::FloatRect(x, y + childHeight, childWidth, childHeight), mNodes)); //Bottom left
-    mChildren.push_back(Quadtree(mLevel + 1, sf::FloatRect(x + childWidth, y + childHeight, childWidth, childHeight), mNodes)); //Bottom right
-}
+    Quad children[4] =
+    {
+        Quad(sf::FloatRect(x, y, childWidth, childHeight), parent.level + 1), // Top left
+        Quad(sf::FloatRect(x + childWidth, y, childWidth, childHeight), parent.level + 1), // Top right
+        Quad(sf::FloatRect(x, y + childHeight, childWidth, childHeight), parent.level + 1), // Bottom left
+        Quad(sf::FloatRect(x + childWidth, y + childHeight, childWidth, childHeight), parent.level + 1), // Bottom right
+    };
 
+    for(int i = 0; i < 4; i++)
+        mQuads[firstChild + i] = children[i];
 
-void Quadtree::merge()
-{
-    for(Quadtree& child : mChildren)
-        child.clear();
+    mQuads[quad].firstChild = firstChild;
+
+    // Push the entities that fit in the children down into them.
+    int element = mQuads[quad].firstElement;
+    while(element >= 0)
+    {
+        int next = mElements[element].next;
+        int child = getChild(quad, mElements[element].rect);
+        if(child >= 0)
+        {
+            unlink(element);
+            link(element, child);
+        }
 
-    mChildren.clear();
+        element = next;
+    }
 }
 
-void Quadtree::clear()
+void Quadtree::merge(int quad)
 {
-    for(Quadtree& child : mChildren)
-        child.clear();
+    int firstChild = mQuads[quad].firstChild;
+    if(firstChild < 0)
+        return;
 
-    std::list<Node*> nodes = mQuadNodes;
-    for(Node* node : nodes)
-        eraseQuadNode(node);
+    for(int i = 0; i < 4; i++)
+    {
+        int child = firstChild + i;
+        merge(child);
 
-    mChildren.clear();
-}
+        int element = mQuads[child].firstElement;
+        while(element >= 0)
+        {
+            int next = mElements[element].next;
+            unlink(element);
+            link(element, quad);
+            element = next;
+        }
+    }
 
+    mQuads[firstChild].firstChild = mFreeQuads;
+    mFreeQuads = firstChild;
+    mQuads[quad].firstChild = -1;
+}
 
-unsigned char Quadtree::getPartialIndices(sf::FloatRect nodeBounds)
+void Quadtree::getNearbyEntities(std::vector<Pair>& pairs) const
 {
-    float midQuadX = mBounds.left + mBounds.width / 2;
-    float midQuadY = mBounds.top + mBounds.height / 2;
+    pairs.clear();
 
-    bool overlapsTopQuads = (nodeBounds.top < midQuadY);
-    bool overlapsBottomQuads = (nodeBounds.top + nodeBounds.height > midQuadY);
+    for(int element = 0; element < (int)mElements.size(); element++)
+        if(mElements[element].entity)
+            getNearbyEntities(0, element, pairs);
+}
 
-    bool overlapsLeftQuads = (nodeBounds.left < midQuadX);
-    bool overlapsRightQuads = (nodeBounds.left + nodeBounds.width > midQuadX);
+void Quadtree::getNearbyEntities(int quad, int element, std::vector<Pair>& pairs) const
+{
+    const Quad& current = mQuads[quad];
+    const Element& searched = mElements[element];
 
-    unsigned char partialIndices = 0;
-    if(overlapsLeftQuads)
-    {
-        if(overlapsTopQuads)
-            partialIndices |= (1 << 0);
-        if(overlapsBottomQuads)
-            partialIndices |= (1 << 2);
-    }
-    if(overlapsRightQuads)
-    {
-        if(overlapsTopQuads)
-            partialIndices |= (1 << 1);
-        if(overlapsBottomQuads)
-            partialIndices |= (1 << 3);
-    }
+    // Each pair is found from both of its entities. Only the one with the lower index reports it.
+    for(int other = current.firstElement; other >= 0; other = mElements[other].next)
+        if(other > element && mElements[other].rect.intersects(searched.rect))
+            pairs.push_back(Pair(searched.entity, mElements[other].entity));
 
-    return partialIndices;
+    if(current.firstChild >= 0)
+        for(int i = 0; i < 4; i++)
+        {
+            const Quad& child = mQuads[current.firstChild + i];
+            if(touches(searched.rect, child.left, child.top, child.right, child.bottom))
+                getNearbyEntities(current.firstChild + i, element, pairs);
+        }
 }
 
-void Quadtree::getBottomQuads(std::list<Quadtree*>& quads)
+void Quadtree::getEntitiesIn(sf::FloatRect area, std::vector<Proxy>& proxies) const
 {
-    if(mChildren.empty())
-        quads.push_back(this);
-    else
-        for(Quadtree& child : mChildren)
-            child.getBottomQuads(quads);
+    proxies.clear();
+    getEntitiesIn(0, area, proxies);
 }
 
-std::set<std::pair<EntityNode*, EntityNode*>> Quadtree::getNearbyEntities()
+void Quadtree::getEntitiesIn(int quad, sf::FloatRect area, std::vector<Proxy>& proxies) const
 {
-    std::set<std::pair<EntityNode*, EntityNode*>> nearbyPairs;
-
-    std::list<Quadtree*> bottomQuads;
-    getBottomQuads(bottomQuads);
-
-    for(Quadtree* quad : bottomQuads)
-    {
-        std::list<Node*> nearbyNodes = quad->getQuadNodes();
+    const Quad& current = mQuads[quad];
 
-        auto iNodeA = nearbyNodes.begin();
-        auto iNodeB = iNodeA;
-        while(iNodeA != nearbyNodes.end())
+    for(int element = current.firstElement; element >= 0; element = mElements[element].next)
+        if(mElements[element].rect.intersects(area))
         {
-            iNodeB++;
-            auto it = iNodeB;
-            while(it != nearbyNodes.end())
-            {
-                // Order pair by pointer value.
-                if((*iNodeA)->entity < (*it)->entity)
-                    nearbyPairs.insert(std::make_pair((*iNodeA)->entity, (*it)->entity));
-                else
-                    nearbyPairs.insert(std::make_pair((*it)->entity, (*iNodeA)->entity));
-
-                it++;
-            }
-
-            iNodeA++;
+            Proxy proxy = {mElements[element].entity, mElements[element].rect};
+            proxies.push_back(proxy);
         }
-    }
-
 
-    // Move the list out of here to avoid copying large-sized lists.
-    return std::move(nearbyPairs);
+    if(current.firstChild >= 0)
+        for(int i = 0; i < 4; i++)
+        {
+            const Quad& child = mQuads[current.firstChild + i];
+            if(touches(area, child.left, child.top, child.right, child.bottom))
+                getEntitiesIn(current.firstChild + i, area, proxies);
+        }
 }
 
-
-bool Quadtree::hasChildren()
+sf::FloatRect Quadtree::getBoundingRect() const
 {
-    return !mChildren.empty();
+    return mQuads[0].cell;
 }
 
-std::list<Quadtree::Node*> Quadtree::getQuadNodes()
+int Quadtree::getEntityCount() const
 {
-    return mQuadNodes;
+    return mEntityCount;
 }
 
-
-void Quadtree::getQuadtree(std::list<const Quadtree*>& qtree) const
+void Quadtree::getCells(std::vector<sf::FloatRect>& cells) const
 {
-    qtree.push_back(this);
-
-    for(const Quadtree& child : mChildren)
+    std::vector<int> stack(1, 0);
+    while(!stack.empty())
     {
-        child.getQuadtree(qtree);
+        int quad = stack.back();
+        stack.pop_back();
+
+        cells.push_back(mQuads[quad].cell);
+        if(mQuads[quad].firstChild >= 0)
+            for(int i = 0; i < 4; i++)
+                stack.push_back(mQuads[quad].firstChild + i);
     }
 }
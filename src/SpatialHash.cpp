@@ -0,0 +1,283 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "SpatialHash.hpp"
+#include "EntityNode.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <algorithm>
+#include <set>
+#include <cmath>
+////////////////////////////////////////////////
+
+const float SpatialHash::CELL_SIZE_FACTOR = 2.f;
+const float SpatialHash::MIN_CELL_SIZE = 1.f;
+
+SpatialHash::SpatialHash()
+: mCellSize(MIN_CELL_SIZE)
+, mBucketMask(0)
+{
+    clearBuckets();
+}
+
+void SpatialHash::update()
+{
+    for(int i = 0; i < (int)mEntities.size(); i++)
+    {
+        sf::FloatRect rect = mEntities[i]->getBoundingRect();
+        mLefts[i] = rect.left;
+        mTops[i] = rect.top;
+        mRights[i] = rect.left + rect.width;
+        mBottoms[i] = rect.top + rect.height;
+    }
+
+    fitCellSize();
+    sortIntoBuckets();
+}
+
+void SpatialHash::insertEntity(EntityNode* entity)
+{
+    // Do nothing if entity is marked for removal or already in a broad phase.
+    if(entity->isMarkedForRemoval() || entity->getCollissionHandle() >= 0)
+        return;
+
+    sf::FloatRect rect = entity->getBoundingRect();
+    entity->setCollissionHandle(mEntities.size());
+    mEntities.push_back(entity);
+    mLefts.push_back(rect.left);
+    mTops.push_back(rect.top);
+    mRights.push_back(rect.left + rect.width);
+    mBottoms.push_back(rect.top + rect.height);
+
+    clearBuckets();
+}
+
+void SpatialHash::eraseEntity(EntityNode* entity)
+{
+    int index = entity->getCollissionHandle();
+    if(index >= 0 && index < (int)mEntities.size() && mEntities[index] == entity)
+    {
+        eraseAt(index);
+        clearBuckets();
+    }
+}
+
+void SpatialHash::removeWrecks()
+{
+    int entityCount = mEntities.size();
+    for(int i = mEntities.size() - 1; i >= 0; i--)
+        if(mEntities[i]->isMarkedForRemoval())
+            eraseAt(i);
+
+    if((int)mEntities.size() != entityCount)
+        clearBuckets();
+}
+
+void SpatialHash::eraseAt(int index)
+{
+    // Fill the gap with the last entity.
+    mEntities[index]->setCollissionHandle(-1);
+
+    int last = mEntities.size() - 1;
+    if(index != last)
+    {
+        mEntities[index] = mEntities[last];
+        mEntities[index]->setCollissionHandle(index);
+        mLefts[index] = mLefts[last];
+        mTops[index] = mTops[last];
+        mRights[index] = mRights[last];
+        mBottoms[index] = mBottoms[last];
+    }
+
+    mEntities.pop_back();
+    mLefts.pop_back();
+    mTops.pop_back();
+    mRights.pop_back();
+    mBottoms.pop_back();
+}
+
+void SpatialHash::clearBuckets()
+{
+    // The buckets refer to entities by index, which inserting and erasing shifts.
+    mBucketMask = 0;
+    mBucketStarts.assign(2, 0);
+    mBucketEntities.clear();
+}
+
+void SpatialHash::fitCellSize()
+{
+    if(mEntities.empty())
+        return;
+
+    std::vector<float> widths(mEntities.size());
+    for(int i = 0; i < (int)widths.size(); i++)
+        widths[i] = mRights[i] - mLefts[i];
+
+    std::vector<float>::iterator median = widths.begin() + widths.size() / 2;
+    std::nth_element(widths.begin(), median, widths.end());
+
+    mCellSize = std::max(*median * CELL_SIZE_FACTOR, MIN_CELL_SIZE);
+}
+
+int SpatialHash::getCell(float coordinate) const
+{
+    return (int)std::floor(coordinate / mCellSize);
+}
+
+int SpatialHash::getBucket(int x, int y) const
+{
+    unsigned int hash = (unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u;
+    return hash & mBucketMask;
+}
+
+void SpatialHash::sortIntoBuckets()
+{
+    mEntryBuckets.clear();
+    mEntryEntities.clear();
+
+    // One entry per cell that a rect touches, rounded up to a power of two buckets with room to spare.
+    int entryCount = 0;
+    for(int i = 0; i < (int)mEntities.size(); i++)
+        entryCount += (getCell(mRights[i]) - getCell(mLefts[i]) + 1) * (getCell(mBottoms[i]) - getCell(mTops[i]) + 1);
+
+    int bucketCount = 1;
+    while(bucketCount < entryCount * 2)
+        bucketCount *= 2;
+    mBucketMask = bucketCount - 1;
+
+    mCellLefts.resize(mEntities.size());
+    mCellTops.resize(mEntities.size());
+    for(int i = 0; i < (int)mEntities.size(); i++)
+    {
+        mCellLefts[i] = getCell(mLefts[i]);
+        mCellTops[i] = getCell(mTops[i]);
+
+        int first = mEntryBuckets.size();
+        for(int y = getCell(mTops[i]); y <= getCell(mBottoms[i]); y++)
+            for(int x = getCell(mLefts[i]); x <= getCell(mRights[i]); x++)
+            {
+                // Two cells of one rect may hash to the same bucket. Enter it only once.
+                int bucket = getBucket(x, y);
+                if(std::find(mEntryBuckets.begin() + first, mEntryBuckets.end(), bucket) == mEntryBuckets.end())
+                {
+                    mEntryBuckets.push_back(bucket);
+                    mEntryEntities.push_back(i);
+                }
+            }
+    }
+
+    // Counting sort the entries by bucket.
+    mBucketStarts.assign(bucketCount + 1, 0);
+    for(int bucket : mEntryBuckets)
+        mBucketStarts[bucket + 1]++;
+
+    for(int bucket = 0; bucket < bucketCount; bucket++)
+        mBucketStarts[bucket + 1] += mBucketStarts[bucket];
+
+    mBucketEntities.resize(mEntryBuckets.size());
+    std::vector<int> ends(mBucketStarts.begin(), mBucketStarts.end() - 1);
+    for(int entry = 0; entry < (int)mEntryBuckets.size(); entry++)
+        mBucketEntities[ends[mEntryBuckets[entry]]++] = mEntryEntities[entry];
+}
+
+void SpatialHash::getNearbyEntities(std::vector<Pair>& pairs) const
+{
+    pairs.clear();
+
+    for(int bucket = 0; bucket <= mBucketMask; bucket++)
+    {
+        int begin = mBucketStarts[bucket];
+        int end = mBucketStarts[bucket + 1];
+        for(int i = begin; i < end; i++)
+        {
+            int a = mBucketEntities[i];
+            for(int j = i + 1; j < end; j++)
+            {
+                int b = mBucketEntities[j];
+                if(mLefts[a] >= mRights[b] || mLefts[b] >= mRights[a] || mTops[a] >= mBottoms[b] || mTops[b] >= mBottoms[a])
+                    continue;
+
+                // Report the pair from one bucket only.
+                int cornerX = getCell(std::max(mLefts[a], mLefts[b]));
+                int cornerY = getCell(std::max(mTops[a], mTops[b]));
+                if(getBucket(cornerX, cornerY) != bucket)
+                    continue;
+
+                pairs.push_back(Pair(mEntities[a], mEntities[b]));
+            }
+        }
+    }
+}
+
+void SpatialHash::getEntitiesIn(sf::FloatRect area, std::vector<Proxy>& proxies) const
+{
+    proxies.clear();
+
+    float right = area.left + area.width;
+    float bottom = area.top + area.height;
+    int cellLeft = getCell(area.left);
+    int cellTop = getCell(area.top);
+    int cellRight = getCell(right);
+    int cellBottom = getCell(bottom);
+    for(int y = cellTop; y <= cellBottom; y++)
+        for(int x = cellLeft; x <= cellRight; x++)
+        {
+            int bucket = getBucket(x, y);
+            for(int i = mBucketStarts[bucket]; i < mBucketStarts[bucket + 1]; i++)
+            {
+                int entity = mBucketEntities[i];
+                if(mLefts[entity] >= right || area.left >= mRights[entity] || mTops[entity] >= bottom || area.top >= mBottoms[entity])
+                    continue;
+
+                // Report the entity from one cell only, the one holding the top left corner of where it touches area.
+                if(std::max(mCellLefts[entity], cellLeft) != x || std::max(mCellTops[entity], cellTop) != y)
+                    continue;
+
+                Proxy proxy = {mEntities[entity], sf::FloatRect(mLefts[entity], mTops[entity], mRights[entity] - mLefts[entity], mBottoms[entity] - mTops[entity])};
+                proxies.push_back(proxy);
+            }
+        }
+}
+
+int SpatialHash::getEntityCount() const
+{
+    return mEntities.size();
+}
+
+float SpatialHash::getCellSize() const
+{
+    return mCellSize;
+}
+
+void SpatialHash::getCells(std::vector<sf::FloatRect>& cells) const
+{
+    std::set<std::pair<int, int>> occupied;
+    for(int i = 0; i < (int)mEntities.size(); i++)
+        for(int y = getCell(mTops[i]); y <= getCell(mBottoms[i]); y++)
+            for(int x = getCell(mLefts[i]); x <= getCell(mRights[i]); x++)
+                occupied.insert(std::make_pair(x, y));
+
+    for(std::pair<int, int> cell : occupied)
+        cells.push_back(sf::FloatRect(cell.first * mCellSize, cell.second * mCellSize, mCellSize, mCellSize));
+}
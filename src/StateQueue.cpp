@@ -32,20 +32,20 @@ StateQueue::StateQueue(StatePtr defaultState)
 void StateQueue::update()
 {
     if(!mStateQueue.empty())
-    {
-        EntityState* pState = mStateQueue.front().get();
-        pState->update();
+        mStateQueue.front()->update();
+    else
+        mDefaultState->update();
+}
 
-        if(pState->isDone())
-        {
-            mStateQueue.pop();
+void StateQueue::advance()
+{
+    if(!mStateQueue.empty() && mStateQueue.front()->isDone())
+    {
+        mStateQueue.pop();
 
-            if(!mStateQueue.empty())
-                mStateQueue.front()->initialize();
-        }
+        if(!mStateQueue.empty())
+            mStateQueue.front()->initialize();
     }
-    else
-        mDefaultState->update();
 }
 
 void StateQueue::setState(StatePtr state)
@@ -0,0 +1,209 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "SweepAndPrune.hpp"
+#include "EntityNode.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <algorithm>
+////////////////////////////////////////////////
+
+SweepAndPrune::SweepAndPrune()
+: mSortedCount(0)
+, mMaxWidth(0.f)
+, mSwapCount(0)
+{
+}
+
+void SweepAndPrune::update()
+{
+    mMaxWidth = 0.f;
+    for(Box& box : mBoxes)
+    {
+        setRect(box, mEntities[box.slot]->getBoundingRect());
+        mMaxWidth = std::max(mMaxWidth, box.right - box.left);
+    }
+
+    sort();
+}
+
+void SweepAndPrune::setRect(Box& box, sf::FloatRect rect)
+{
+    box.left = rect.left;
+    box.right = rect.left + rect.width;
+    box.top = rect.top;
+    box.bottom = rect.top + rect.height;
+}
+
+void SweepAndPrune::sort()
+{
+    mSwapCount = 0;
+    for(int i = 1; i < mSortedCount; i++)
+    {
+        if(mBoxes[i - 1].left <= mBoxes[i].left)
+            continue;
+
+        Box box = mBoxes[i];
+        int j = i;
+        for(; j > 0 && mBoxes[j - 1].left > box.left; j--)
+            mBoxes[j] = mBoxes[j - 1];
+
+        mBoxes[j] = box;
+        mSwapCount += i - j;
+    }
+
+    // Boxes inserted since the last update are in no particular order. Sort them on their own and merge them in.
+    auto isLeftOf = [](const Box& lhs, const Box& rhs)
+    {
+        return lhs.left < rhs.left;
+    };
+
+    std::vector<Box>::iterator sortedEnd = mBoxes.begin() + mSortedCount;
+    std::sort(sortedEnd, mBoxes.end(), isLeftOf);
+    std::inplace_merge(mBoxes.begin(), sortedEnd, mBoxes.end(), isLeftOf);
+    mSortedCount = mBoxes.size();
+}
+
+void SweepAndPrune::getNearbyEntities(std::vector<Pair>& pairs) const
+{
+    pairs.clear();
+
+    // Only the boxes sorted by the last update.
+    for(int i = 0; i < mSortedCount; i++)
+    {
+        const Box& box = mBoxes[i];
+        for(int j = i + 1; j < mSortedCount && mBoxes[j].left < box.right; j++)
+        {
+            const Box& other = mBoxes[j];
+            if(other.top >= box.bottom || box.top >= other.bottom)
+                continue;
+
+            pairs.push_back(Pair(mEntities[box.slot], mEntities[other.slot]));
+        }
+    }
+}
+
+void SweepAndPrune::insertEntity(EntityNode* entity)
+{
+    // Do nothing if entity is marked for removal or already in a broad phase.
+    if(entity->isMarkedForRemoval() || entity->getCollissionHandle() >= 0)
+        return;
+
+    int slot = mEntities.size();
+    if(!mFreeSlots.empty())
+    {
+        slot = mFreeSlots.back();
+        mFreeSlots.pop_back();
+        mEntities[slot] = entity;
+    }
+    else
+        mEntities.push_back(entity);
+
+    entity->setCollissionHandle(slot);
+
+    // Sorted into place by the next update.
+    Box box;
+    setRect(box, entity->getBoundingRect());
+    box.slot = slot;
+    mBoxes.push_back(box);
+}
+
+void SweepAndPrune::eraseEntity(EntityNode* entity)
+{
+    int slot = entity->getCollissionHandle();
+    if(slot < 0 || slot >= (int)mEntities.size() || mEntities[slot] != entity)
+        return;
+
+    for(int i = 0; i < (int)mBoxes.size(); i++)
+        if(mBoxes[i].slot == slot)
+        {
+            mBoxes.erase(mBoxes.begin() + i);
+            if(i < mSortedCount)
+                mSortedCount--;
+            break;
+        }
+
+    eraseSlot(slot);
+}
+
+void SweepAndPrune::removeWrecks()
+{
+    for(int i = 0; i < (int)mBoxes.size(); i++)
+        if(mEntities[mBoxes[i].slot]->isMarkedForRemoval())
+        {
+            eraseSlot(mBoxes[i].slot);
+            if(i < mSortedCount)
+                mSortedCount--;
+        }
+
+    // Removing keeps the remaining boxes in order.
+    mBoxes.erase(std::remove_if(mBoxes.begin(), mBoxes.end(), [this](const Box& box)
+    {
+        return !mEntities[box.slot];
+    }), mBoxes.end());
+}
+
+void SweepAndPrune::eraseSlot(int slot)
+{
+    mEntities[slot]->setCollissionHandle(-1);
+    mEntities[slot] = nullptr;
+    mFreeSlots.push_back(slot);
+}
+
+void SweepAndPrune::getEntitiesIn(sf::FloatRect area, std::vector<Proxy>& proxies) const
+{
+    proxies.clear();
+
+    // No box starting further left than the widest one can reach area.
+    float right = area.left + area.width;
+    float bottom = area.top + area.height;
+    std::vector<Box>::const_iterator sortedEnd = mBoxes.begin() + mSortedCount;
+    std::vector<Box>::const_iterator box = std::lower_bound(mBoxes.begin(), sortedEnd, area.left - mMaxWidth, [](const Box& lhs, float left)
+    {
+        return lhs.left < left;
+    });
+
+    for(; box != sortedEnd && box->left < right; box++)
+        if(area.left < box->right && box->top < bottom && area.top < box->bottom)
+        {
+            Proxy proxy = {mEntities[box->slot], sf::FloatRect(box->left, box->top, box->right - box->left, box->bottom - box->top)};
+            proxies.push_back(proxy);
+        }
+}
+
+int SweepAndPrune::getEntityCount() const
+{
+    return mBoxes.size();
+}
+
+unsigned int SweepAndPrune::getSwapCount() const
+{
+    return mSwapCount;
+}
+
+void SweepAndPrune::getCells(std::vector<sf::FloatRect>& cells) const
+{
+    for(const Box& box : mBoxes)
+        cells.push_back(sf::FloatRect(box.left, box.top, box.right - box.left, box.bottom - box.top));
+}
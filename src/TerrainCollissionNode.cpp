@@ -22,8 +22,10 @@
 
 #include <TerrainCollissionNode.hpp>
 #include <Utility.hpp>
+#include <EdgeIndex.hpp>
 
 #include <cassert>
+#include <unordered_set>
 
 ////////////////////////////////////////////////
 // SFML - Simple and Fast Media Library
@@ -31,6 +33,8 @@
 ////////////////////////////////////////////////
 
 
+const float TerrainCollissionNode::MAX_PASS_WIDTH = 100.f;
+
 TerrainCollissionNode::TerrainCollissionNode(const std::vector<sf::Vector2f>& points)
 {
     setPoints(points);
@@ -56,15 +60,6 @@ void TerrainCollissionNode::setPoints(const std::vector<sf::Vector2f>& points)
 }
 
 
-bool TerrainCollissionNode::lineIntersects(sf::Vector2f p1, sf::Vector2f p2, const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes) const
-{
-    for(const std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
-        if(pNode->isLineIntersecting(p1, p2))
-            return true;
-
-    return false;
-}
-
 TerrainCollissionNode::Path::Path(const Point* from, const Point* to, bool isEdge, float passWidth)
 : p(to)
 , isEdge(isEdge)
@@ -80,6 +75,7 @@ TerrainCollissionNode::Point::Point(sf::Vector2f prev, sf::Vector2f pos, sf::Vec
 : pos(pos)
 , prev(prev)
 , next(next)
+, index(-1)
 {
     sf::Vector2f bisectorVec = (prev - pos) + (next - pos);
     float l = length(bisectorVec);
@@ -87,91 +83,6 @@ TerrainCollissionNode::Point::Point(sf::Vector2f prev, sf::Vector2f pos, sf::Vec
     bisector = -bisectorVec / l;
 }
 
-// Connect points to other nodes.
-void TerrainCollissionNode::connectVisiblePoints(std::unique_ptr<TerrainCollissionNode>& node, std::list<std::unique_ptr<TerrainCollissionNode>>& nodes)
-{
-    if(node.get() == this)
-    {
-        connectVisiblePoints(nodes);
-        return;
-    }
-
-    for(Point& p1 : mConvexPoints)
-    {
-        for(Point& p2 : node->getConvexAngles())
-        {
-            if(!convexAngleContains(p1.prev, p1.pos, p1.next, p2.pos) && !convexAngleContains(p2.prev, p2.pos, p2.next, p1.pos))
-                if(!lineIntersects(p1.pos, p2.pos, nodes))
-                {
-                    connectPoints(p1, p2, false);
-                    node->connectPoints(p2, p1, false);
-                }
-        }
-    }
-/*
-
-    // Make sure we have at least a triangle.
-    assert(mConvexPoints.size() > 2);
-
-    // Previous, current and the next point.
-    auto iPointsPrev = mPoints.begin();
-    auto iPointsCurr = mPoints.begin();
-    auto iPointsNext = mPoints.begin();
-
-    for(auto iCurr = mConvexPoints.begin(); iCurr != mConvexPoints.end(); iCurr++)
-    {
-        iPointsCurr = std::find(iPointsCurr, mPoints.end(), iCurr->pos);
-
-        // If this assert fails, this node has either removed a point from mPoint or
-        // added a faulty point to mConvexPoint.
-        assert(iPointsCurr != mPoints.end());
-
-        if(iPointsCurr == mPoints.begin())
-        {
-            iPointsPrev = mPoints.end();
-            iPointsPrev--;
-        }
-        else
-            iPointsPrev = iPointsCurr;
-
-        iPointsPrev--;
-
-        iPointsNext = iPointsCurr;
-        iPointsNext++;
-
-        assert(iPointsNext != mPoints.end());
-
-        for(Point& p : node->getConvexAngles())
-        {
-            if(p.pos != iCurr->pos)
-            {
-                bool isVisible = false;
-                bool isEdge = false;
-
-                if((node.get() == this) && (p.pos == *iPointsNext || p.pos == *iPointsPrev))
-                {
-                    if(!lineIntersects(iCurr->pos, p.pos, nodes))
-                    {
-                        isVisible = true;
-                        isEdge = true;
-                    }
-                }
-                else if(!convexAngleContains(*iPointsPrev, iCurr->pos, *iPointsNext, p.pos) && !convexAngleContains())
-                    if(!lineIntersects(iCurr->pos, p.pos, nodes))
-                        isVisible = true;
-
-                if(isVisible)
-                {
-                    connectPoints(*iCurr, p, isEdge);
-                    node->connectPoints(p, *iCurr, isEdge);
-                }
-            }
-        }
-    }
-    */
-}
-
-
 TerrainCollissionNode::Path* TerrainCollissionNode::connectPoints(Point& from, Point& to, bool isEdge)
 {
     mPaths.push_back(Path(&from, &to, isEdge));
@@ -180,92 +91,100 @@ TerrainCollissionNode::Path* TerrainCollissionNode::connectPoints(Point& from, P
     return &mPaths.back();
 }
 
+void TerrainCollissionNode::removePaths(const std::function<bool(const Point& from, const Path& path)>& isRemoved)
+{
+    std::unordered_set<const Path*> removedPaths;
+    for(Point& point : mConvexPoints)
+        point.paths.remove_if([&](const Path* pPath)
+        {
+            if(!isRemoved(point, *pPath))
+                return false;
+
+            removedPaths.insert(pPath);
+            return true;
+        });
+
+    if(!removedPaths.empty())
+        mPaths.remove_if([&removedPaths](const Path& path){return removedPaths.count(&path) > 0;});
+}
+
 const std::vector<sf::Vector2f>& TerrainCollissionNode::getPoints() const
 {
     return mPoints;
 }
 
-void TerrainCollissionNode::computePassWidths(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes)
+void TerrainCollissionNode::computePassWidths(const EdgeIndex& edgeIndex)
 {
     for(Point& p : mConvexPoints)
-    {
-        sf::Vector2f p1 = p.pos;
         for(Path* pPath : p.paths)
-        {
-            float shortestDistanceSqrd = 10000.f;
+            computePassWidth(p, *pPath, edgeIndex);
+}
+
+void TerrainCollissionNode::computePassWidth(const Point& from, Path& path, const EdgeIndex& edgeIndex)
+{
+    sf::Vector2f p1 = from.pos;
+    sf::Vector2f p2 = path.p->pos;
+
+    // Only the edges close enough to the path can narrow it.
+    sf::FloatRect area(std::min(p1.x, p2.x) - MAX_PASS_WIDTH, std::min(p1.y, p2.y) - MAX_PASS_WIDTH,
+                       std::fabs(p2.x - p1.x) + 2.f * MAX_PASS_WIDTH, std::fabs(p2.y - p1.y) + 2.f * MAX_PASS_WIDTH);
+
+    std::vector<EdgeIndex::Segment> segments;
+    edgeIndex.getSegments(area, segments);
+
+    float shortestDistanceSqrd = MAX_PASS_WIDTH * MAX_PASS_WIDTH;
+    for(const EdgeIndex::Segment& segment : segments)
+    {
+        const sf::Vector2f curr = segment.a;
+        const sf::Vector2f next = segment.b;
 
+        if(p1 == curr || p1 == next || p2 == curr || p2 == next)
+            continue;
 
-            sf::Vector2f p2 = pPath->p->pos;
-            for(auto& pNode : nodes)
+        if(path.isEdge)
+        {
+            float dCurrSqrd = shortestDistanceSqrd;
+            float dNextSqrd = shortestDistanceSqrd;
+
+            // If clockwise
+            if(p1 == path.p->prev)
             {
-                const std::vector<sf::Vector2f>& points = pNode->getPoints();
-
-                auto iCurr = points.begin();
-                auto iNext = iCurr;
-                iNext++;
-
-                while(iNext != points.end())
-                {
-                    if(p1 != *iCurr && p1 != *iNext && p2 != *iCurr && p2 != *iNext)
-                    {
-                        if(pPath->isEdge)
-                        {
-                            float dCurrSqrd = shortestDistanceSqrd;
-                            float dNextSqrd = shortestDistanceSqrd;
-
-                            bool isClockwise = p1 == pPath->p->prev;
-
-                            // If clockwise
-                            if(p1 == pPath->p->prev)
-                            {
-                                if(!isAngleConvex(p1, p2, *iCurr))
-                                    dCurrSqrd = minDistanceSqrd(p1, p2, *iCurr);
-
-                                if(!isAngleConvex(p1, p2, *iNext))
-                                    dNextSqrd = minDistanceSqrd(p1, p2, *iNext);
-                            }
-                            else
-                            {
-                                if(isAngleConvex(p1, p2, *iCurr))
-                                    dCurrSqrd = minDistanceSqrd(p1, p2, *iCurr);
-
-                                if(isAngleConvex(p1, p2, *iNext))
-                                    dNextSqrd = minDistanceSqrd(p1, p2, *iNext);
-                            }
-
-                            float dSqrd = dCurrSqrd < dNextSqrd ? dCurrSqrd : dNextSqrd;
-                            if(dSqrd < shortestDistanceSqrd)
-                                shortestDistanceSqrd = dSqrd;
-                        }
-                        else
-                        {
-                            const std::list<float> distances =
-                            {
-                                minDistanceSqrd(*iCurr, *iNext, p1), // distance from p1 to the line iCurr->iNext
-                                minDistanceSqrd(*iCurr, *iNext, p2), // distance from p2 to the line iCurr->iNext
-                                minDistanceSqrd(p1, p2, *iCurr), // distance from iCurr to the line p1->p2
-                                minDistanceSqrd(p1, p2, *iNext) // distance from iNext to the line p1->p2
-                            };
-
-                            float dSqrd = *std::min_element(distances.begin(), distances.end());
-                            if(dSqrd < shortestDistanceSqrd)
-                                shortestDistanceSqrd = dSqrd;
-                        }
-
-                    }
-
-                    iCurr++;
-                    iNext++;
-                }
+                if(!isAngleConvex(p1, p2, curr))
+                    dCurrSqrd = minDistanceSqrd(p1, p2, curr);
+
+                if(!isAngleConvex(p1, p2, next))
+                    dNextSqrd = minDistanceSqrd(p1, p2, next);
             }
+            else
+            {
+                if(isAngleConvex(p1, p2, curr))
+                    dCurrSqrd = minDistanceSqrd(p1, p2, curr);
 
+                if(isAngleConvex(p1, p2, next))
+                    dNextSqrd = minDistanceSqrd(p1, p2, next);
+            }
 
-            pPath->passWidth = sqrtf(shortestDistanceSqrd);
+            float dSqrd = dCurrSqrd < dNextSqrd ? dCurrSqrd : dNextSqrd;
+            if(dSqrd < shortestDistanceSqrd)
+                shortestDistanceSqrd = dSqrd;
+        }
+        else
+        {
+            const std::list<float> distances =
+            {
+                minDistanceSqrd(curr, next, p1), // distance from p1 to the line curr->next
+                minDistanceSqrd(curr, next, p2), // distance from p2 to the line curr->next
+                minDistanceSqrd(p1, p2, curr), // distance from curr to the line p1->p2
+                minDistanceSqrd(p1, p2, next) // distance from next to the line p1->p2
+            };
 
+            float dSqrd = *std::min_element(distances.begin(), distances.end());
+            if(dSqrd < shortestDistanceSqrd)
+                shortestDistanceSqrd = dSqrd;
         }
     }
 
-
+    path.passWidth = sqrtf(shortestDistanceSqrd);
 }
 
 // Get shortest distance between a line and a point
@@ -302,213 +221,6 @@ float TerrainCollissionNode::minDistanceSqrd(sf::Vector2f a, sf::Vector2f b, sf:
 }
 
 
-// Connect points on self.
-void TerrainCollissionNode::connectVisiblePoints(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes)
-{
-    for(auto i = mConvexPoints.begin(); i != mConvexPoints.end(); i++)
-    {
-        auto j = i;
-        j++;
-        while(j != mConvexPoints.end())
-        {
-            bool isVisible = false;
-            bool isEdge = false;
-
-            sf::Vector2f prev = i->prev;
-            sf::Vector2f next = i->next;
-            sf::Vector2f curr = i->pos;
-
-            if(j->pos == i->next || j->pos == i->prev)
-            {
-                if(!lineIntersects(i->pos, j->pos, nodes))
-                {
-                    isVisible = true;
-                    isEdge = true;
-                }
-            }
-            else if(!convexAngleContains(i->prev, i->pos, i->next, j->pos) && !lineIntersects(i->pos, j->pos, nodes))
-                isVisible = true;
-
-            if(isVisible)
-            {
-                connectPoints(*i, *j, isEdge);
-                connectPoints(*j, *i, isEdge);
-            }
-
-            j++;
-        }
-    }
-    // Code below might get used some day.
-    //{
-        /*
-        for(Point& p1 : mConvexPoints)
-        {
-            for(const Map::NodePtr& pNode : nodes)
-            {
-                // Only check other nodes.
-                if(pNode.get() != this)
-                {
-                    const std::list<Point>& points = pNode->getConvexAngles();
-
-                    for(const Point& p2 : points)
-                    {
-                        if(!lineIntersects(p1.pos, p2.pos, nodes))
-                        {
-                            mPaths.push_back(Path(&p1, &p2));
-                            p1.paths.push_back(&mPaths.back());
-                        }
-                    }
-                }
-            }
-        }
-        */
-        /*
-        for(Point& convexPoint : mConvexPoints)
-        {
-            // Sort nodes by shortest distance to the point.
-            auto comparator = [convexPoint](const std::unique_ptr<TerrainCollissionNode>& a, const std::unique_ptr<TerrainCollissionNode>& b)
-            {
-                sf::FloatRect aRect = a->getBoundingRect();
-                sf::FloatRect bRect = b->getBoundingRect();
-
-                return lengthSqrd(sf::Vector2f(aRect.left, aRect.top) - convexPoint.pos) < lengthSqrd(sf::Vector2f(bRect.left, bRect.top) - convexPoint.pos);
-            };
-
-            std::sort(nodes.begin(), nodes.end(), comparator);
-
-
-            // Get visible nodes.
-            typedef std::pair<double, double> TCNSector;
-            std::vector<TCNSector> sectors = {TCNSector(0, 0)};
-            std::vector<const TerrainCollissionNode*> visibleNodes;
-            std::vector<TCNSector> visibleNodesSectors;
-            for(const std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
-            {
-                TCNSector minMaxAngles = pNode->getMinMaxAngles(convexPoint.pos);
-                minMaxAngles.first += PI;
-                minMaxAngles.second += PI;
-
-                bool isVisible = false;
-                TCNSector& sector = sectors.front();
-
-                if(addSectorIfVisible(sectors, minMaxAngles))
-                {
-                    visibleNodes.push_back(pNode->get());
-                    visibleNodesSectors.push_back(minMaxAngles);
-                }
-
-
-                if(sectors.size() == 1 && (sectors[0].first == PI && sectors[0].second == PI * 3))
-                    break;
-            }
-
-            for(int i = 0; i < visibleNodes.size(); i++)
-            {
-                std::list<Point>& points = visibleNodes[i]->getConvexAngles();
-
-
-                for(int j = 0; i < points.size(); j++Point& p : points)
-                {
-                    if()
-                }
-            }
-        }
-        */
-    //}
-}
-
-
-// Angles in a range from 180 to 540 degrees (PI to 3 * PI)
-std::pair<double, double> TerrainCollissionNode::getMinMaxAngles(sf::Vector2f pos)
-{
-    std::pair<double, double> minMaxAngles = std::make_pair(PI * 3, 0);
-
-    double DOUBLE_PI = PI * 2;
-    for(const Point& p : mConvexPoints)
-    {
-        double angle = std::atan2(p.pos.y, p.pos.x) + DOUBLE_PI;
-        if(angle < minMaxAngles.first)
-            minMaxAngles.first = angle;
-        else if(angle > minMaxAngles.second)
-            minMaxAngles.second = angle;
-    }
-
-    return minMaxAngles;
-}
-
-bool TerrainCollissionNode::addSectorIfVisible(std::vector<std::pair<double, double>>& sectors, const std::pair<double, double>& sector)
-{
-    /*
-     * If sector is entirely contained by a sector, return false.
-     *
-     * If sector is partially obscured by a sector, update that
-     * sectors angles, update the sectors and return true.
-     *
-     * If sector does not intersect with any sector at all, insert
-     * sector into sectors, merge sectors and return true.
-     */
-    for(int i = 0; i < sectors.size(); i++)
-    {
-        if(sector.second <= sectors[i].second && sector.first >= sectors[i].first)
-            return false;
-
-        bool isVisible = false;
-        if(sector.first < sectors[i].first && sector.second >= sector.first)
-        {
-            isVisible = true;
-            sectors[i].first = sector.first;
-        }
-        if(sector.second > sectors[i].second && sector.first <= sector.second)
-        {
-            isVisible = true;
-            sectors[i].second = sector.second;
-        }
-
-        if(isVisible)
-        {
-            mergeSectors(sectors);
-            return true;
-        }
-    }
-
-    sectors.push_back(sector);
-    mergeSectors(sectors);
-    return true;
-}
-
-
-void TerrainCollissionNode::mergeSectors(std::vector<std::pair<double, double>>& sectors)
-{
-    bool isOverlapping = false;
-    for(auto i = sectors.begin(); i != sectors.end(); i++)
-    {
-        auto j = i;
-        j++;
-        while(j != sectors.end())
-        {
-            if(j->first < i->first && j->second >= i->first)
-            {
-                i->first = j->first;
-                isOverlapping = true;
-            }
-            if(j->second > i->second && j->first <= i->second)
-            {
-                i->second = j->second;
-                isOverlapping = true;
-            }
-
-            if(isOverlapping)
-            {
-                sectors.erase(j++);
-                isOverlapping = false;
-            }
-            else
-                j++;
-        }
-    }
-}
-
-
 void TerrainCollissionNode::computeConvexAngles()
 {
     // Make sure we have at least a triangle.
@@ -626,10 +338,10 @@ bool TerrainCollissionNode::isLineIntersecting(sf::Vector2f a, sf::Vector2f b, s
 }
 */
 
-void TerrainCollissionNode::getVisiblePoints(sf::Vector2f p, const std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, std::list<const Point*>& visiblePoints) const
+void TerrainCollissionNode::getVisiblePoints(sf::Vector2f p, const EdgeIndex& edgeIndex, std::list<const Point*>& visiblePoints) const
 {
     for(const Point& p1 : mConvexPoints)
-        if(!lineIntersects(p, p1.pos, nodes))
+        if(!edgeIndex.isLineIntersecting(p, p1.pos))
             visiblePoints.push_back(&p1);
 }
 
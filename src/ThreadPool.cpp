@@ -0,0 +1,163 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "ThreadPool.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <algorithm>
+////////////////////////////////////////////////
+
+// The pool and queue of the thread running a task, so that tasks it submits go on its own queue.
+static thread_local const ThreadPool*  tPool = nullptr;
+static thread_local unsigned int        tThread = 0;
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+: mQueuedCount(0)
+, mPendingCount(0)
+, mNextQueue(0)
+, mIsStopping(false)
+{
+    if(threadCount == 0)
+        threadCount = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for(unsigned int i = 0; i < threadCount; i++)
+        mQueues.emplace_back(new Queue());
+
+    for(unsigned int i = 1; i < threadCount; i++)
+        mThreads.push_back(std::thread(&ThreadPool::work, this, i));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mIsStopping = true;
+    }
+    mCondition.notify_all();
+
+    for(std::thread& thread : mThreads)
+        thread.join();
+}
+
+void ThreadPool::submit(Task task)
+{
+    unsigned int queue = tPool == this ? tThread : mNextQueue++ % mQueues.size();
+
+    mPendingCount++;
+    {
+        std::lock_guard<std::mutex> lock(mQueues[queue]->mutex);
+        mQueues[queue]->tasks.push_back(std::move(task));
+    }
+    mQueuedCount++;
+
+    notify();
+}
+
+void ThreadPool::wait()
+{
+    const ThreadPool* pPool = tPool;
+    unsigned int thread = tThread;
+    tPool = this;
+    tThread = 0;
+
+    while(mPendingCount > 0)
+    {
+        if(runTask(0))
+            continue;
+
+        // Tasks are still running elsewhere, and may submit more.
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this](){return mQueuedCount > 0 || mPendingCount == 0;});
+    }
+
+    tPool = pPool;
+    tThread = thread;
+}
+
+unsigned int ThreadPool::getThreadCount() const
+{
+    return mQueues.size();
+}
+
+void ThreadPool::work(unsigned int thread)
+{
+    tPool = this;
+    tThread = thread;
+
+    while(true)
+    {
+        if(runTask(thread))
+            continue;
+
+        std::unique_lock<std::mutex> lock(mMutex);
+        mCondition.wait(lock, [this](){return mQueuedCount > 0 || mIsStopping;});
+        if(mIsStopping)
+            return;
+    }
+}
+
+bool ThreadPool::runTask(unsigned int thread)
+{
+    Task task;
+
+    // Newest first from its own queue, then oldest first from the others.
+    for(unsigned int i = 0; i < mQueues.size() && !task; i++)
+    {
+        Queue& queue = *mQueues[(thread + i) % mQueues.size()];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if(queue.tasks.empty())
+            continue;
+
+        if(i == 0)
+        {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+    }
+
+    if(!task)
+        return false;
+
+    mQueuedCount--;
+    task(thread);
+
+    if(--mPendingCount == 0)
+        notify();
+
+    return true;
+}
+
+void ThreadPool::notify()
+{
+    // Taking the lock makes sure no thread is between checking its condition and starting to wait.
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+    }
+    mCondition.notify_all();
+}
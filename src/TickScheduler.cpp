@@ -0,0 +1,121 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "TickScheduler.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cassert>
+#include <algorithm>
+////////////////////////////////////////////////
+
+TickScheduler::TickScheduler(unsigned int threadCount)
+: mPool(new ThreadPool(threadCount))
+{
+}
+
+TickScheduler::JobId TickScheduler::addJob(Task task, std::vector<JobId> dependencies)
+{
+    return addParallelJob([](){return 1u;}, 1, [task](unsigned int, unsigned int, unsigned int){task();}, dependencies);
+}
+
+TickScheduler::JobId TickScheduler::addParallelJob(Counter itemCount, unsigned int rangeSize, RangeTask task, std::vector<JobId> dependencies)
+{
+    assert(rangeSize > 0);
+
+    JobId id = mJobs.size();
+    mJobs.emplace_back(new Job());
+
+    Job& job = *mJobs.back();
+    job.itemCount = itemCount;
+    job.rangeSize = rangeSize;
+    job.task = task;
+    job.dependencyCount = dependencies.size();
+    job.rangeCount = 0;
+
+    for(JobId dependency : dependencies)
+    {
+        assert(dependency < id);
+        mJobs[dependency]->dependants.push_back(id);
+    }
+
+    return id;
+}
+
+void TickScheduler::run()
+{
+    // Find them all first. Once one starts, its dependants may be released at any time.
+    std::vector<JobId> roots;
+    for(JobId id = 0; id < mJobs.size(); id++)
+        if(mJobs[id]->dependencyCount == 0)
+            roots.push_back(id);
+
+    for(JobId id : roots)
+        start(id);
+
+    mPool->wait();
+    mJobs.clear();
+}
+
+void TickScheduler::setThreadCount(unsigned int threadCount)
+{
+    mPool.reset(new ThreadPool(threadCount));
+}
+
+unsigned int TickScheduler::getThreadCount() const
+{
+    return mPool->getThreadCount();
+}
+
+void TickScheduler::start(JobId id)
+{
+    Job& job = *mJobs[id];
+    unsigned int itemCount = job.itemCount();
+    unsigned int rangeCount = (itemCount + job.rangeSize - 1) / job.rangeSize;
+
+    if(rangeCount == 0)
+    {
+        finish(id);
+        return;
+    }
+
+    job.rangeCount = rangeCount;
+    for(unsigned int first = 0; first < itemCount; first += job.rangeSize)
+    {
+        unsigned int end = std::min(first + job.rangeSize, itemCount);
+        mPool->submit([this, id, first, end](unsigned int thread)
+        {
+            mJobs[id]->task(first, end, thread);
+
+            if(--mJobs[id]->rangeCount == 0)
+                finish(id);
+        });
+    }
+}
+
+void TickScheduler::finish(JobId id)
+{
+    for(JobId dependant : mJobs[id]->dependants)
+        if(--mJobs[dependant]->dependencyCount == 0)
+            start(dependant);
+}
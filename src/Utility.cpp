@@ -344,6 +344,23 @@ bool intersects(sf::Vector2f a1, sf::Vector2f a2, sf::Vector2f b1, sf::Vector2f
 }
 
 
+bool intersects(sf::Vector2f a, sf::Vector2f b, sf::FloatRect rect)
+{
+    if(intersects(a, rect) || intersects(b, rect))
+        return true;
+
+    // Both ends are outside, so the segment has to cross a side of rect.
+    sf::Vector2f topLeft(rect.left, rect.top);
+    sf::Vector2f topRight(rect.left + rect.width, rect.top);
+    sf::Vector2f bottomLeft(rect.left, rect.top + rect.height);
+    sf::Vector2f bottomRight(rect.left + rect.width, rect.top + rect.height);
+
+    return intersects(a, b, topLeft, topRight)
+        || intersects(a, b, topRight, bottomRight)
+        || intersects(a, b, bottomRight, bottomLeft)
+        || intersects(a, b, bottomLeft, topLeft);
+}
+
 /**
  * a - b
  *     |
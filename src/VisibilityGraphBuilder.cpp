@@ -0,0 +1,492 @@
+/****************************************************************
+****************************************************************
+*
+* Territorial - 2D RTS game with dynamic territorial borders.
+* Copyright (C) 2015 Mikael Hernvall (mikael.hernvall@gmail.com)
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program. If not, see <http://www.gnu.org/licenses/>.
+*
+****************************************************************
+****************************************************************/
+
+
+#include "VisibilityGraphBuilder.hpp"
+#include "EdgeIndex.hpp"
+#include "Utility.hpp"
+
+////////////////////////////////////////////////
+// STD - C++ Standard Library
+#include <cmath>
+#include <algorithm>
+#include <limits>
+////////////////////////////////////////////////
+
+/*
+ * Exact for float input, since the products fit in a double. The sort
+ * order and the sweep events must agree on which side of the ray a point
+ * is, or edges may be left open behind the ray.
+ */
+static double orientation(sf::Vector2f a, sf::Vector2f b)
+{
+    return (double)a.x * b.y - (double)a.y * b.x;
+}
+
+// Which half of the turn, starting at the positive x axis, does v point into?
+static int getHalf(sf::Vector2f v)
+{
+    return v.y < 0.f || (v.y == 0.f && v.x < 0.f) ? 1 : 0;
+}
+
+/**
+ * \brief Get the directions from apex to the outermost corners of rect.
+ *
+ * Every segment from apex through rect lies in the cone from first to
+ * second, turning the way orientation() is positive. Returns false if
+ * apex is not outside rect, so that there is no such cone.
+ */
+static bool getCone(sf::Vector2f apex, sf::FloatRect rect, sf::Vector2f& first, sf::Vector2f& second)
+{
+    float right = rect.left + rect.width;
+    float bottom = rect.top + rect.height;
+    if(apex.x >= rect.left && apex.x <= right && apex.y >= rect.top && apex.y <= bottom)
+        return false;
+
+    const sf::Vector2f corners[4] =
+    {
+        sf::Vector2f(rect.left, rect.top) - apex,
+        sf::Vector2f(right, rect.top) - apex,
+        sf::Vector2f(right, bottom) - apex,
+        sf::Vector2f(rect.left, bottom) - apex,
+    };
+
+    // Seen from outside, the corners span less than half a turn.
+    first = second = corners[0];
+    for(sf::Vector2f corner : corners)
+    {
+        if(orientation(corner, first) > 0.0)
+            first = corner;
+        if(orientation(second, corner) > 0.0)
+            second = corner;
+    }
+
+    return orientation(first, second) > 0.0;
+}
+
+/**
+ * \brief Get the x range of the cone from apex between first and second within the band from top to bottom.
+ *
+ * Returns false if the cone misses the band.
+ */
+static bool getConeSpan(sf::Vector2f apex, sf::Vector2f first, sf::Vector2f second, float top, float bottom, float& minX, float& maxX)
+{
+    minX = std::numeric_limits<float>::max();
+    maxX = -minX;
+
+    // The part of the cone in the band is bounded by these points, unless it goes on sideways.
+    auto include = [&](float x)
+    {
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+    };
+
+    if(apex.y >= top && apex.y <= bottom)
+        include(apex.x);
+
+    for(sf::Vector2f direction : {first, second})
+        if(direction.y != 0.f)
+            for(float y : {top, bottom})
+            {
+                float s = (y - apex.y) / direction.y;
+                if(s >= 0.f)
+                    include(apex.x + s * direction.x);
+            }
+
+    if(minX > maxX)
+        return false;
+
+    auto contains = [&](sf::Vector2f direction){return orientation(first, direction) >= 0.0 && orientation(direction, second) >= 0.0;};
+    if(contains(sf::Vector2f(-1.f, 0.f)))
+        minX = -std::numeric_limits<float>::max();
+    if(contains(sf::Vector2f(1.f, 0.f)))
+        maxX = std::numeric_limits<float>::max();
+
+    return true;
+}
+
+VisibilityGraphBuilder::VisibilityGraphBuilder(const EdgeIndex& edgeIndex)
+: mEdgeIndex(edgeIndex)
+, mOpenEdges(CloserEdge(*this))
+{
+
+}
+
+void VisibilityGraphBuilder::build(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes)
+{
+    mPoints.clear();
+    for(std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
+        addPoints(*pNode);
+
+    const sf::Vector2i gridSize = mEdgeIndex.getGridSize();
+    if(gridSize.x * gridSize.y < SWEEP_CELLS_PER_POINT * (int)mPoints.size())
+    {
+        mPoints.clear();
+        testPairs(nodes);
+        return;
+    }
+
+    for(unsigned int i = 0; i < mPoints.size(); i++)
+        if(mPoints[i].pPoint)
+            sweep(i);
+
+    mOrder.clear();
+    mOpenEdges.clear();
+}
+
+void VisibilityGraphBuilder::insert(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, TerrainCollissionNode& node)
+{
+    std::list<TerrainCollissionNode::Point>& points = node.getConvexAngles();
+    for(auto iPoint = points.begin(); iPoint != points.end(); iPoint++)
+    {
+        // Points of the same node are only paired once.
+        for(auto iOther = std::next(iPoint); iOther != points.end(); iOther++)
+            if(!mEdgeIndex.isLineIntersecting(iPoint->pos, iOther->pos))
+                connect(node, *iPoint, node, *iOther);
+
+        for(std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
+        {
+            if(pNode.get() == &node)
+                continue;
+
+            for(TerrainCollissionNode::Point& other : pNode->getConvexAngles())
+                if(!mEdgeIndex.isLineIntersecting(iPoint->pos, other.pos))
+                    connect(node, *iPoint, *pNode, other);
+        }
+    }
+}
+
+void VisibilityGraphBuilder::reconnect(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes, sf::FloatRect area)
+{
+    const sf::Vector2i gridSize = mEdgeIndex.getGridSize();
+    const sf::Vector2f origin = mEdgeIndex.getOrigin();
+    const float cellSize = mEdgeIndex.getCellSize();
+    if(gridSize.x == 0 || gridSize.y == 0)
+        return;
+
+    auto getColumn = [&](float x){return std::max(0, std::min(gridSize.x - 1, (int)std::floor((x - origin.x) / cellSize)));};
+    auto getRow = [&](float y){return std::max(0, std::min(gridSize.y - 1, (int)std::floor((y - origin.y) / cellSize)));};
+
+    std::vector<std::pair<TerrainCollissionNode*, TerrainCollissionNode::Point*>> points;
+    for(std::unique_ptr<TerrainCollissionNode>& pNode : nodes)
+        for(TerrainCollissionNode::Point& point : pNode->getConvexAngles())
+            points.push_back(std::make_pair(pNode.get(), &point));
+
+    // Sort the points into the cells of the edge index. The points of cell i are [cellOffsets[i], cellOffsets[i + 1]) of cellPoints.
+    std::vector<int> cells(points.size());
+    std::vector<int> cellOffsets(gridSize.x * gridSize.y + 1, 0);
+    for(unsigned int i = 0; i < points.size(); i++)
+    {
+        sf::Vector2f pos = points[i].second->pos;
+        cells[i] = getRow(pos.y) * gridSize.x + getColumn(pos.x);
+        cellOffsets[cells[i] + 1]++;
+    }
+
+    for(unsigned int i = 1; i < cellOffsets.size(); i++)
+        cellOffsets[i] += cellOffsets[i - 1];
+
+    std::vector<int> cellPoints(points.size());
+    std::vector<int> cellSizes(cellOffsets.size() - 1, 0);
+    for(unsigned int i = 0; i < points.size(); i++)
+        cellPoints[cellOffsets[cells[i]] + cellSizes[cells[i]]++] = i;
+
+    // A little larger, so that rounding never drops a cell the cone just touches.
+    sf::FloatRect coneArea(area.left - 1.f, area.top - 1.f, area.width + 2.f, area.height + 2.f);
+
+    // Lines of sight that were blocked by what was removed cross area, so the other end lies in the cone from each point through it.
+    auto testPair = [&](unsigned int i, unsigned int j)
+    {
+        TerrainCollissionNode::Point& p1 = *points[i].second;
+        TerrainCollissionNode::Point& p2 = *points[j].second;
+
+        if(!intersects(p1.pos, p2.pos, area))
+            return;
+
+        auto leadsToP2 = [&p2](const TerrainCollissionNode::Path* pPath){return pPath->p == &p2;};
+        if(std::any_of(p1.paths.begin(), p1.paths.end(), leadsToP2))
+            return;
+
+        if(!mEdgeIndex.isLineIntersecting(p1.pos, p2.pos))
+            connect(*points[i].first, p1, *points[j].first, p2);
+    };
+
+    for(unsigned int i = 0; i < points.size(); i++)
+    {
+        sf::Vector2f apex = points[i].second->pos;
+        sf::Vector2f first, second;
+
+        // Every other point may see through area from within it.
+        if(!getCone(apex, coneArea, first, second))
+        {
+            for(unsigned int j = i + 1; j < points.size(); j++)
+                testPair(i, j);
+
+            continue;
+        }
+
+        for(int row = 0; row < gridSize.y; row++)
+        {
+            float minX, maxX;
+            float top = origin.y + row * cellSize;
+            if(!getConeSpan(apex, first, second, top, top + cellSize, minX, maxX))
+                continue;
+
+            // Each pair is tested from the point that comes first.
+            int firstCell = row * gridSize.x + getColumn(std::max(minX, origin.x));
+            int lastCell = row * gridSize.x + getColumn(std::min(maxX, origin.x + gridSize.x * cellSize));
+            for(int k = cellOffsets[firstCell]; k < cellOffsets[lastCell + 1]; k++)
+                if(cellPoints[k] > (int)i)
+                    testPair(i, cellPoints[k]);
+        }
+    }
+}
+
+void VisibilityGraphBuilder::addPoints(TerrainCollissionNode& node)
+{
+    // The first and last points of a node are the same.
+    const std::vector<sf::Vector2f>& points = node.getPoints();
+    const int pointCount = points.size() - 1;
+    const int first = mPoints.size();
+
+    for(int i = 0; i < pointCount; i++)
+    {
+        SweepPoint point;
+        point.pos = points[i];
+        point.prev = first + (i + pointCount - 1) % pointCount;
+        point.next = first + (i + 1) % pointCount;
+        point.pNode = &node;
+        point.pPoint = nullptr;
+
+        mPoints.push_back(point);
+    }
+
+    // Convex points are stored in the same order as the points.
+    int i = first;
+    for(TerrainCollissionNode::Point& convexPoint : node.getConvexAngles())
+    {
+        while(mPoints[i].pos != convexPoint.pos)
+            i++;
+
+        mPoints[i].pPoint = &convexPoint;
+    }
+}
+
+void VisibilityGraphBuilder::testPairs(std::list<std::unique_ptr<TerrainCollissionNode>>& nodes)
+{
+    for(auto iNode = nodes.begin(); iNode != nodes.end(); iNode++)
+    {
+        std::list<TerrainCollissionNode::Point>& points = (*iNode)->getConvexAngles();
+        for(auto iPoint = points.begin(); iPoint != points.end(); iPoint++)
+        {
+            // Each pair is tested from the point that comes first.
+            for(auto iOther = std::next(iPoint); iOther != points.end(); iOther++)
+                if(!mEdgeIndex.isLineIntersecting(iPoint->pos, iOther->pos))
+                    connect(**iNode, *iPoint, **iNode, *iOther);
+
+            for(auto iOtherNode = std::next(iNode); iOtherNode != nodes.end(); iOtherNode++)
+                for(TerrainCollissionNode::Point& other : (*iOtherNode)->getConvexAngles())
+                    if(!mEdgeIndex.isLineIntersecting(iPoint->pos, other.pos))
+                        connect(**iNode, *iPoint, **iOtherNode, other);
+        }
+    }
+}
+
+void VisibilityGraphBuilder::sweep(int source)
+{
+    const sf::Vector2f origin = mPoints[source].pos;
+
+    mOrder.clear();
+    mDirections.resize(mPoints.size());
+    mHalves.resize(mPoints.size());
+    for(unsigned int i = 0; i < mPoints.size(); i++)
+        if(mPoints[i].pos != origin)
+        {
+            mOrder.push_back(i);
+            mDirections[i] = mPoints[i].pos - origin;
+            mHalves[i] = getHalf(mDirections[i]);
+        }
+
+    // Sort counter clockwise from the positive x axis, closest first.
+    std::sort(mOrder.begin(), mOrder.end(), [this](int lhs, int rhs)
+    {
+        if(mHalves[lhs] != mHalves[rhs])
+            return mHalves[lhs] < mHalves[rhs];
+
+        double turn = orientation(mDirections[lhs], mDirections[rhs]);
+        if(turn != 0.0)
+            return turn > 0.0;
+
+        return lengthSqrd(mDirections[lhs]) < lengthSqrd(mDirections[rhs]);
+    });
+
+    // Start with the edges crossing the ray along the positive x axis.
+    mOrigin = origin;
+    mOpenEdges.clear();
+    mOpenEdgeSlots.assign(mPoints.size(), mOpenEdges.end());
+    const sf::Vector2f startDirection(1.f, 0.f);
+    for(unsigned int i = 0; i < mPoints.size(); i++)
+    {
+        sf::Vector2f a = mPoints[i].pos;
+        sf::Vector2f b = mPoints[mPoints[i].next].pos;
+
+        if(a == origin || b == origin || (a.y < origin.y) == (b.y < origin.y))
+            continue;
+
+        float x = a.x + (origin.y - a.y) * (b.x - a.x) / (b.y - a.y);
+        if(x > origin.x)
+        {
+            OpenEdge edge = {std::min<int>(i, mPoints[i].next), std::max<int>(i, mPoints[i].next)};
+            insertEdge(startDirection, edge);
+        }
+    }
+
+    int prev = -1;
+    for(int i : mOrder)
+    {
+        SweepPoint& point = mPoints[i];
+        const sf::Vector2f direction = mDirections[i];
+        const int neighbours[] = {point.prev, point.next};
+
+        // Close the edges of this point that the ray has now passed.
+        for(int neighbour : neighbours)
+            if(mPoints[neighbour].pos != origin && orientation(direction, mPoints[neighbour].pos - origin) < 0.0)
+                removeEdge({std::min(i, neighbour), std::max(i, neighbour)});
+
+        bool isVisible = true;
+        sf::Vector2f prevDirection = prev >= 0 ? mPoints[prev].pos - origin : sf::Vector2f();
+        if(prev >= 0 && orientation(prevDirection, direction) == 0.0 && dot(prevDirection, direction) > 0.f)
+        {
+            // Another point lies on the line of sight. Rare enough to test the slow way.
+            isVisible = !mEdgeIndex.isLineIntersecting(origin, point.pos);
+        }
+        else if(!mOpenEdges.empty())
+        {
+            const OpenEdge& closest = *mOpenEdges.begin();
+            isVisible = !intersects(origin, point.pos, mPoints[closest.a].pos, mPoints[closest.b].pos);
+        }
+
+        if(point.pPoint && point.pPoint->index > mPoints[source].pPoint->index)
+            connect(mPoints[source], point, isVisible);
+
+        // Open the edges of this point that the ray is about to cross.
+        for(int neighbour : neighbours)
+            if(mPoints[neighbour].pos != origin && orientation(direction, mPoints[neighbour].pos - origin) > 0.0)
+                insertEdge(direction, {std::min(i, neighbour), std::max(i, neighbour)});
+
+        prev = i;
+    }
+}
+
+void VisibilityGraphBuilder::connect(SweepPoint& from, SweepPoint& to, bool isVisible)
+{
+    if(isVisible)
+        connect(*from.pNode, *from.pPoint, *to.pNode, *to.pPoint);
+}
+
+void VisibilityGraphBuilder::connect(TerrainCollissionNode& fromNode, TerrainCollissionNode::Point& p1, TerrainCollissionNode& toNode, TerrainCollissionNode::Point& p2)
+{
+    bool isEdge = &fromNode == &toNode && (p2.pos == p1.next || p2.pos == p1.prev);
+
+    // A line of sight through the inside of either angle goes through the terrain.
+    if(!isEdge && (fromNode.convexAngleContains(p1.prev, p1.pos, p1.next, p2.pos) || toNode.convexAngleContains(p2.prev, p2.pos, p2.next, p1.pos)))
+        return;
+
+    fromNode.connectPoints(p1, p2, isEdge);
+    toNode.connectPoints(p2, p1, isEdge);
+}
+
+float VisibilityGraphBuilder::getRayDistance(sf::Vector2f origin, sf::Vector2f direction, const OpenEdge& edge) const
+{
+    sf::Vector2f a = mPoints[edge.a].pos;
+    sf::Vector2f b = mPoints[edge.b].pos;
+
+    double denominator = orientation(direction, b - a);
+    if(denominator == 0.0)
+        return std::min(dot(a - origin, direction), dot(b - origin, direction)) / lengthSqrd(direction);
+
+    return orientation(a - origin, b - a) / denominator;
+}
+
+bool VisibilityGraphBuilder::isCloser(sf::Vector2f origin, sf::Vector2f direction, const OpenEdge& lhs, const OpenEdge& rhs) const
+{
+    float lDistance = getRayDistance(origin, direction, lhs);
+    float rDistance = getRayDistance(origin, direction, rhs);
+
+    if(std::fabs(lDistance - rDistance) > 0.00001f * std::max(1.f, std::fabs(lDistance)))
+        return lDistance < rDistance;
+
+    /*
+     * Edges meeting where the ray crosses them. Just past the ray, the
+     * closer one is the one turning more towards the origin.
+     */
+    int shared;
+    if(lhs.a == rhs.a || lhs.a == rhs.b)
+        shared = lhs.a;
+    else if(lhs.b == rhs.a || lhs.b == rhs.b)
+        shared = lhs.b;
+    else
+        return lDistance < rDistance;
+
+    sf::Vector2f s = mPoints[shared].pos;
+    sf::Vector2f l = mPoints[lhs.a == shared ? lhs.b : lhs.a].pos - s;
+    sf::Vector2f r = mPoints[rhs.a == shared ? rhs.b : rhs.a].pos - s;
+    sf::Vector2f toOrigin = origin - s;
+
+    return dot(toOrigin, l) / length(l) > dot(toOrigin, r) / length(r);
+}
+
+int VisibilityGraphBuilder::getEdgeSlot(const OpenEdge& edge) const
+{
+    return mPoints[edge.a].next == edge.b ? edge.a : edge.b;
+}
+
+void VisibilityGraphBuilder::insertEdge(sf::Vector2f direction, OpenEdge edge)
+{
+    OpenEdges::iterator& slot = mOpenEdgeSlots[getEdgeSlot(edge)];
+    if(slot != mOpenEdges.end())
+        return;
+
+    mDirection = direction;
+    slot = mOpenEdges.insert(edge);
+}
+
+void VisibilityGraphBuilder::removeEdge(OpenEdge edge)
+{
+    // The edge ends where the ray does, so its distance no longer tells it apart. Erase it by position instead.
+    OpenEdges::iterator& slot = mOpenEdgeSlots[getEdgeSlot(edge)];
+    if(slot == mOpenEdges.end())
+        return;
+
+    mOpenEdges.erase(slot);
+    slot = mOpenEdges.end();
+}
+
+VisibilityGraphBuilder::CloserEdge::CloserEdge(const VisibilityGraphBuilder& builder)
+: pBuilder(&builder)
+{
+
+}
+
+bool VisibilityGraphBuilder::CloserEdge::operator()(const OpenEdge& lhs, const OpenEdge& rhs) const
+{
+    return pBuilder->isCloser(pBuilder->mOrigin, pBuilder->mDirection, lhs, rhs);
+}
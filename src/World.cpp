@@ -31,7 +31,7 @@
 #include "Team.hpp"
 #include "TIME_PER_FRAME.hpp"
 
-World::World(sf::RenderWindow& window)
+World::World(sf::RenderWindow& window, unsigned int threadCount)
 : mWindow(window)
 , mTarget(window)
 , mMap("assets/maps/2.png", sf::Vector2f(600, 500))
@@ -39,6 +39,7 @@ World::World(sf::RenderWindow& window)
 , mCamera(mWindow, mTarget)
 , mEntitiesManager(mMap, mCommandQueue)
 {
+    mEntitiesManager.setThreadCount(threadCount);
     buildWorld();
 }
 